@@ -0,0 +1,56 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __BLIT_KERNELS_H
+#define __BLIT_KERNELS_H
+
+#include "GAGSys.h"
+
+namespace GAGCore
+{
+	//! Row kernels blending 32 bits pixels with alpha in the high byte, used by the software path of DrawableSurface.
+	//! All implementations produce exactly the same pixels, SIMD ones process several pixels at once.
+	struct BlitKernels
+	{
+		//! Available implementations, in increasing order of speed
+		enum Implementation
+		{
+			SCALAR = 0,
+			SSE2,
+			AVX2,
+			IMPLEMENTATION_COUNT
+		};
+		
+		//! Blend w pixels of src over dest, the alpha of each src pixel being multiplied by alpha
+		void (*blendRow)(Uint32 *dest, const Uint32 *src, int w, Uint8 alpha);
+		//! Blend color, including its alpha byte, over w pixels of dest with a constant alpha
+		void (*blendColorRow)(Uint32 *dest, int w, Uint32 color, Uint8 alpha);
+		//! Blend color, including its alpha byte, over w pixels of dest with the alpha of each pixel taken from alphas
+		void (*blendColorAlphaRow)(Uint32 *dest, const Uint8 *alphas, int w, Uint32 color);
+		//! Name of the implementation, for logs and benchmarks
+		const char *name;
+		
+		//! Return the kernels of an implementation, or NULL if this build or this CPU does not support it
+		static const BlitKernels *get(Implementation implementation);
+		//! Return the fastest kernels supported by this CPU, detected on first call
+		static const BlitKernels *best(void);
+	};
+}
+
+#endif
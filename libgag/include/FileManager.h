@@ -91,6 +91,10 @@ namespace GAGCore
 		void remove(const std::string filename);
 		//! Returns true if filename is a directory
 		bool isDir(const std::string filename);
+		//! Returns true if path is an absolute path, which is not looked for in the search list
+		static bool isAbsolutePath(const std::string path);
+		//! Returns path made absolute using the working directory, if it is not already
+		static std::string absolutePath(const std::string path);
 		
 		//! Compress source to dest uzing gzip, returns true on success
 		bool gzip(const std::string &source, const std::string &dest);
@@ -124,6 +128,8 @@ namespace GAGCore
 		// FIXME : the following functions are not thread-safe :
 		//! must be call before directory listening, return true if success
 		bool initDirectoryListing(const std::string virtualDir, const std::string extension="", const bool dirs=false);
+		//! must be call before listing a directory of the filesystem instead of the search list, return true if success
+		bool initRealDirectoryListing(const std::string realDir, const std::string extension="", const bool dirs=false);
 		//! get the next name, return NULL if none
 		const std::string getNextDirectoryEntry(void);
 	};
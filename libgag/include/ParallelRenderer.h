@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __PARALLEL_RENDERER_H
+#define __PARALLEL_RENDERER_H
+
+#include "GraphicContext.h"
+#include <vector>
+#include <valarray>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+
+namespace GAGCore
+{
+	//! Renders software drawing commands of the graphic context with several threads.
+	//! Between begin() and end(), drawing commands issued on the graphic context are recorded instead of
+	//! being executed. At end(), the screen is split in horizontal bands and each band replays all the
+	//! commands in order, clipped to the band, in its own thread. Sources of the commands (surfaces,
+	//! sprites, fonts) must not be modified before end().
+	class ParallelRenderer
+	{
+	public:
+		//! Type of a recorded drawing command
+		enum CommandType
+		{
+			PIXEL = 0,
+			RECT,
+			FILLED_RECT,
+			HORZ_LINE,
+			VERT_LINE,
+			LINE,
+			CIRCLE,
+			SURFACE,
+			HUE_MASK,
+			ALPHA_MAP
+		};
+
+	protected:
+		//! A recorded drawing command, the meaning of the coordinates depends on type
+		struct Command
+		{
+			CommandType type;
+			SDL_Rect clipRect; //!< clip rect of the surface when the command was recorded
+			int x, y; //!< destination position
+			int w, h; //!< size, line length in w, circle radius in w, alpha map size
+			int sx, sy, sw, sh; //!< source rect of surfaces, end point of lines in sx, sy, cell size of alpha maps in sw, sh
+			Color color;
+			Uint8 alpha;
+			DrawableSurface *surface; //!< source of SURFACE commands
+			const HueMask *mask; //!< source of HUE_MASK commands
+			float hueShift; //!< hue shift of HUE_MASK commands
+			size_t alphaMap; //!< index in alphaMaps of ALPHA_MAP commands
+		};
+
+		//! number of bands, i.e. of threads including the calling one
+		unsigned bandCount;
+		//! the graphic context we are recording, NULL if we are not recording
+		GraphicContext *gfx;
+		//! commands recorded since begin()
+		std::vector<Command> commands;
+		//! copies of the alpha maps recorded since begin(), in alphaMapCount first elements
+		std::vector<std::valarray<unsigned char> > alphaMaps;
+		//! number of alpha maps used in alphaMaps
+		size_t alphaMapCount;
+		//! one surface per band, sharing the pixels of gfx
+		std::vector<DrawableSurface *> bands;
+
+		//! worker threads, drawing all bands but the first one
+		std::vector<boost::thread *> workers;
+		//! protect generation, pendingBands and quitting
+		boost::mutex mutex;
+		//! signaled when a new generation of commands is to be drawn
+		boost::condition startCondition;
+		//! signaled when all workers are done
+		boost::condition doneCondition;
+		//! incremented each time commands are to be drawn
+		unsigned generation;
+		//! number of bands drawn by the workers not finished yet
+		unsigned pendingBands;
+		//! true when the workers must terminate
+		bool quitting;
+
+		friend class DrawableSurface;
+		//! Add a command, clipped by the actual clip rect of surface
+		void record(DrawableSurface *surface, const Command &command);
+		//! Record a primitive, see Command for the meaning of parameters
+		void recordPrimitive(DrawableSurface *surface, CommandType type, int x, int y, int w, int h, int sx, int sy, const Color &color);
+		//! Record a blit of surface
+		void recordSurface(DrawableSurface *surface, int x, int y, DrawableSurface *source, int sx, int sy, int sw, int sh, Uint8 alpha);
+		//! Record a blit of a hue mask
+		void recordHueMask(DrawableSurface *surface, int x, int y, const HueMask *mask, float hueShift, Uint8 alpha);
+		//! Record an alpha map, the map is copied
+		void recordAlphaMap(DrawableSurface *surface, const std::valarray<float> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color);
+		//! Record an alpha map, the map is copied
+		void recordAlphaMap(DrawableSurface *surface, const std::valarray<unsigned char> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color);
+
+		//! Replay all commands clipped to the band of index band
+		void drawBand(unsigned band);
+		//! Main loop of the worker drawing band
+		void workerLoop(unsigned band);
+
+	public:
+		//! Constructor, bandCount being the number of threads to use, 0 for the number of cores
+		ParallelRenderer(unsigned bandCount = 0);
+		//! Destructor, stop the worker threads
+		virtual ~ParallelRenderer();
+
+		//! Start recording commands issued on gfx. If gfx uses the GPU or if there is a single band, commands are executed as usual
+		void begin(GraphicContext *gfx);
+		//! Stop recording and draw the recorded commands, return when all bands are drawn
+		void end(void);
+		//! Return the number of bands used to draw
+		unsigned getBandCount(void) const { return bandCount; }
+	};
+}
+
+#endif
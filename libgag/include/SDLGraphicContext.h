@@ -79,6 +79,23 @@ namespace GAGCore
 	typedef Color Color32;
 	
 	class Sprite;
+	class ParallelRenderer;
+	
+	//! An image split in hue, value, chroma and alpha planes, so that its hue can be rotated while it is blitted
+	struct HueMask
+	{
+		//! Number of hue units in a 60 degrees sector of the color wheel, hue is in [0, 6 * HUE_SECTOR)
+		enum { HUE_SECTOR = 256 };
+		
+		int w, h; //!< size of the planes
+		std::valarray<Uint16> hue; //!< hue of each pixel
+		std::valarray<Uint8> value; //!< value (max component) of each pixel
+		std::valarray<Uint8> chroma; //!< chroma (max - min component) of each pixel
+		std::valarray<Uint8> alpha; //!< alpha of each pixel
+		
+		//! Constructor, decompose a 32 bits surface in the screen format
+		HueMask(const SDL_Surface *source);
+	};
 	
 	//! Font with a given foundery, shape and color
 	class Font
@@ -156,6 +173,8 @@ namespace GAGCore
 	protected:
 		friend struct Color;
 		friend class GraphicContext;
+		friend class Sprite;
+		friend class ParallelRenderer;
 		//! the underlying software SDL surface
 		SDL_Surface *sdlsurface;
 		//! The clipping rect, we do not draw outside it
@@ -166,16 +185,22 @@ namespace GAGCore
 		unsigned int texture;
 		//! texture divisor
 		float texMultX, texMultY;
+		//! if not NULL, software drawing commands are recorded in it instead of being executed
+		ParallelRenderer *recorder;
 		
 	protected:
 		//! draw a vertical line. This function is private because it is only a helper one
 		void _drawVertLine(int x, int y, int l, const Color& color);
 		//! draw a horizontal line. This function is private because it is only a helper one
 		void _drawHorzLine(int x, int y, int l, const Color& color);
+		//! draw a hue mask rotated by hueShift degrees. This function is private because it is only a helper one for drawSprite
+		void _drawHueMask(int x, int y, const HueMask *mask, float hueShift, Uint8 alpha);
+		//! blend a part of surface in software, whatever alpha is. This function is private because it is only a helper one
+		void _blendSurface(int x, int y, DrawableSurface *surface, int sx, int sy, int sw, int sh, Uint8 alpha);
 		
 	protected:
 		//! Protectedconstructor, only called by GraphicContext
-		DrawableSurface() { sdlsurface = NULL; }
+		DrawableSurface() { sdlsurface = NULL; recorder = NULL; }
 		//! allocate textre in GPU for this surface
 		void allocateTexture(void);
 		//! reset the texture size upon changes
@@ -205,10 +230,14 @@ namespace GAGCore
 		virtual void nextFrame(void) { flushTextPictures(); }
 		virtual bool loadImage(const std::string name);
 		virtual void shiftHSV(float hue, float sat, float lum);
+		//! copy sourceSurface at (x, y), replacing pixels and alpha instead of blending
+		virtual void copySurface(int x, int y, const SDL_Surface *sourceSurface);
 		
 		// accessors
 		virtual int getW(void) { return sdlsurface->w; } 
 		virtual int getH(void) { return sdlsurface->h; }
+		//! Return true if the drawing commands on this surface are recorded by a ParallelRenderer, to be executed later
+		bool isRecording(void) const { return recorder != NULL; }
 		
 		// capability querying
 		virtual bool canDrawStretchedSprite(void) { return false; }
@@ -321,6 +350,9 @@ namespace GAGCore
 		//! option flags
 		Uint32 optionFlags;
 		
+		//! draw surface with its hue rotated by hueShift degrees using a GL shader, return false and draw nothing if shaders are not available
+		bool drawHueShiftedSurface(float x, float y, float w, float h, DrawableSurface *surface, float hueShift, Uint8 alpha);
+		
 	public:
 		//! Constructor. Create a new window of size (w,h). If useGPU is true, use GPU for accelerated 2D (OpenGL or DX)
 		GraphicContext(int w, int h, Uint32 flags, const std::string title = "", const std::string icon = "");
@@ -408,10 +440,13 @@ namespace GAGCore
 		struct RotatedImage
 		{
 			DrawableSurface *orig;
+			//! hue decomposition of orig, built on first software draw and shared by all colors
+			HueMask *mask;
 			typedef std::map<Color32, DrawableSurface *> RotationMap;
+			//! rotated copies of orig, only used by the GL path when shaders are not available
 			RotationMap rotationMap;
 	
-			RotatedImage(DrawableSurface *s) { orig = s; }
+			RotatedImage(DrawableSurface *s) { orig = s; mask = NULL; }
 			~RotatedImage();
 		};
 	
@@ -428,6 +463,10 @@ namespace GAGCore
 		bool checkBound(int index);
 		//! Return a rotated drawable surface for actColor, create it if necessary
 		virtual DrawableSurface *getRotatedSurface(int index);
+		//! Return the hue decomposition of the rotated image at index, create it if necessary
+		const HueMask *getRotatedMask(int index);
+		//! Return the hue shift in degrees to transform the base color into actColor
+		float getHueShift(void);
 	
 	public:
 		//! Constructor
@@ -26,7 +26,9 @@
 
 namespace GAGCore
 {
-	//! A stream is a high-level serialization structure, used to read/write structured datas
+	//! A stream is a high-level serialization structure, used to read/write structured datas.
+	//! Datas are named by plain C strings, usually literals. Only text streams use these names,
+	//! so binary streams do not pay for them.
 	class Stream
 	{
 	public:
@@ -46,20 +48,20 @@ namespace GAGCore
 	public:
 		virtual ~OutputStream() { }
 		
-		virtual void write(const void *data, const size_t size, const std::string name) = 0;
-		virtual void writeSint8(const Sint8 v, const std::string name) = 0;
-		virtual void writeUint8(const Uint8 v, const std::string name) = 0;
-		virtual void writeSint16(const Sint16 v, const std::string name) = 0;
-		virtual void writeUint16(const Uint16 v, const std::string name) = 0;
-		virtual void writeSint32(const Sint32 v, const std::string name) = 0;
-		virtual void writeUint32(const Uint32 v, const std::string name) = 0;
-		virtual void writeFloat(const float v, const std::string name) = 0;
-		virtual void writeDouble(const double v, const std::string name) = 0;
-		virtual void writeText(const std::string &v, const std::string name) = 0;
+		virtual void write(const void *data, const size_t size, const char *name) = 0;
+		virtual void writeSint8(const Sint8 v, const char *name) = 0;
+		virtual void writeUint8(const Uint8 v, const char *name) = 0;
+		virtual void writeSint16(const Sint16 v, const char *name) = 0;
+		virtual void writeUint16(const Uint16 v, const char *name) = 0;
+		virtual void writeSint32(const Sint32 v, const char *name) = 0;
+		virtual void writeUint32(const Uint32 v, const char *name) = 0;
+		virtual void writeFloat(const float v, const char *name) = 0;
+		virtual void writeDouble(const double v, const char *name) = 0;
+		virtual void writeText(const std::string &v, const char *name) = 0;
 		
 		virtual void flush(void) = 0;
 		
-		virtual void writeEnterSection(const std::string name) = 0;
+		virtual void writeEnterSection(const char *name) = 0;
 		virtual void writeEnterSection(unsigned id) = 0;
 		virtual void writeLeaveSection(size_t count = 1) = 0;
 	};
@@ -70,18 +72,18 @@ namespace GAGCore
 	public:
 		virtual ~InputStream() { }
 	
-		virtual void read(void *data, size_t size, const std::string name) = 0;
-		virtual Sint8 readSint8(const std::string name) = 0;
-		virtual Uint8 readUint8(const std::string name) = 0;
-		virtual Sint16 readSint16(const std::string name) = 0;
-		virtual Uint16 readUint16(const std::string name) = 0;
-		virtual Sint32 readSint32(const std::string name) = 0;
-		virtual Uint32 readUint32(const std::string name) = 0;
-		virtual float readFloat(const std::string name) = 0;
-		virtual double readDouble(const std::string name) = 0;
-		virtual std::string readText(const std::string name) = 0;
+		virtual void read(void *data, size_t size, const char *name) = 0;
+		virtual Sint8 readSint8(const char *name) = 0;
+		virtual Uint8 readUint8(const char *name) = 0;
+		virtual Sint16 readSint16(const char *name) = 0;
+		virtual Uint16 readUint16(const char *name) = 0;
+		virtual Sint32 readSint32(const char *name) = 0;
+		virtual Uint32 readUint32(const char *name) = 0;
+		virtual float readFloat(const char *name) = 0;
+		virtual double readDouble(const char *name) = 0;
+		virtual std::string readText(const char *name) = 0;
 		
-		virtual void readEnterSection(const std::string name) = 0;
+		virtual void readEnterSection(const char *name) = 0;
 		virtual void readEnterSection(unsigned id) = 0;
 		virtual void readLeaveSection(size_t count = 1) = 0;
 	};
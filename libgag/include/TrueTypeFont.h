@@ -26,6 +26,7 @@
 #include <stack>
 #include <map>
 #include <string>
+#include <vector>
 
 struct SDL_Surface;
 
@@ -60,10 +61,34 @@ namespace GAGCore
 		virtual void pushStyle(Style style);
 		virtual void popStyle(void);
 		
-		//! If text is cached, returns its surface. If it is not, create, cache and return surface
-		DrawableSurface *getStringCached(const std::string text);
+		//! A glyph rendered into one of the atlas pages
+		struct Glyph
+		{
+			unsigned page; //!< index of the atlas page holding the glyph
+			int sx, sy, w, h; //!< position and size in the page
+			int minx, maxy; //!< offset of the glyph bitmap relative to the pen and baseline
+			int advance; //!< horizontal advance of the pen
+		};
+		
+		//! A shaped string, a list of glyphs and their pen positions
+		struct TextLayout
+		{
+			std::vector<Uint16> chars; //!< the UCS-2 characters of the string
+			std::vector<int> positions; //!< the pen position of each character, including kerning
+			int width; //!< width of the string, as SDL_ttf would render it
+			unsigned lastAccessed;
+		};
+		
+		//! If text is cached, returns its layout. If it is not, shape, cache and return layout
+		TextLayout *getLayoutCached(const std::string text);
+		//! If glyph ch of the current style is in the atlas, return it. If it is not, render it into the atlas
+		const Glyph *getGlyph(Uint16 ch);
+		//! Return the kerning between left and right for the current shape
+		int getKerning(Uint16 left, Uint16 right);
 		//! If cache is too big, remove old entry
 		void cleanupCache(void);
+		//! Draw the layout of text at (x, y), glyph by glyph from the atlas
+		void drawLayout(DrawableSurface *surface, int x, int y, const std::string &text, Uint8 alpha);
 #ifdef HAVE_FRIBIDI 
 		char *getBIDIString (const std::string text);
 #endif		
@@ -79,15 +104,36 @@ namespace GAGCore
 			bool operator<(const CacheKey &o) const { if (text == o.text) return (style < o.style); else return (text < o.text);  }
 		};
 		
-		struct CacheData
+		struct GlyphKey
 		{
-			DrawableSurface *s;
-			unsigned lastAccessed;
+			Uint16 ch;
+			Style style;
+			
+			bool operator<(const GlyphKey &o) const { if (ch == o.ch) return (style < o.style); else return (ch < o.ch);  }
 		};
 		
+		//! the pages of the glyph atlas, filled row by row, at most MAX_ATLAS_PAGES
+		std::vector<DrawableSurface *> atlasPages;
+		//! the time at which each page was last drawn from, to reuse the least recently used one once all are full
+		std::vector<unsigned> atlasPageLastUsed;
+		//! for each page, true if a blit from it was recorded on pinningSurface, which then still has to draw it
+		std::vector<bool> atlasPagePinned;
+		//! the surface recording the blits that pinned pages, NULL if no page is pinned
+		DrawableSurface *pinningSurface;
+		//! the page being filled
+		unsigned atlasPage;
+		//! the position where the next glyph goes in the page being filled
+		int atlasX, atlasY;
+		//! the height of the highest glyph in the current row of the page being filled
+		int atlasRowH;
+		//! all glyphs rendered so far, by character and style
+		std::map<GlyphKey, Glyph> glyphs;
+		//! kerning between pairs of characters, by shape and pair
+		std::map<std::pair<int, Uint32>, int> kernings;
+		
 		unsigned now;
-		std::map<CacheKey, CacheData> cache;
-		std::map<unsigned, std::map<CacheKey, CacheData>::iterator> timeCache;
+		std::map<CacheKey, TextLayout> cache;
+		std::map<unsigned, std::map<CacheKey, TextLayout>::iterator> timeCache;
 		//! number of cache hit
 		unsigned cacheHit;
 		//! number of cache miss
@@ -0,0 +1,305 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <BlitKernels.h>
+#include <string.h>
+
+// SIMD kernels are built with per function target attributes, so that they do not require
+// the whole library to be compiled for a recent CPU; the right ones are selected at runtime.
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)) || defined(__clang__))
+	#define BLIT_SSE2_KERNELS
+	#define BLIT_AVX2_KERNELS
+	#define BLIT_TARGET(t) __attribute__((target(t)))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+	#define BLIT_SSE2_KERNELS
+	#define BLIT_TARGET(t)
+	#include <emmintrin.h>
+#endif
+
+namespace GAGCore
+{
+	// Scalar kernels, process two channels at once in 32 bits registers
+
+	#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	static const Uint32 alphaShift = 0;
+	#else
+	static const Uint32 alphaShift = 24;
+	#endif
+
+	static void blendRowScalar(Uint32 *dest, const Uint32 *src, int w, Uint8 alpha)
+	{
+		for (int i = 0; i < w; i++)
+		{
+			Uint32 srcValue = src[i];
+			Uint32 srcAlpha = (((srcValue >> alphaShift) & 0xFF) * alpha) >> 8;
+			Uint32 destAlpha = 255 - srcAlpha;
+			Uint32 srcPreMult0 =  (srcValue & 0x00FF00FF) * srcAlpha;
+			Uint32 srcPreMult1 = ((srcValue >> 8) & 0x00FF00FF) * srcAlpha;
+
+			Uint32 destValue = dest[i];
+			Uint32 destPreMult0 =  (destValue & 0x00FF00FF) * destAlpha;
+			Uint32 destPreMult1 = ((destValue >> 8) & 0x00FF00FF) * destAlpha;
+
+			destPreMult0 += srcPreMult0;
+			destPreMult1 += srcPreMult1;
+
+			dest[i] = ((destPreMult0 >> 8) & 0x00FF00FF) | (destPreMult1 & 0xFF00FF00);
+		}
+	}
+
+	static void blendColorRowScalar(Uint32 *dest, int w, Uint32 color, Uint8 alpha)
+	{
+		Uint32 na = 255 - alpha;
+		Uint32 colorPreMult0 = (color & 0x00FF00FF) * alpha;
+		Uint32 colorPreMult1 = ((color >> 8) & 0x00FF00FF) * alpha;
+		for (int i = 0; i < w; i++)
+		{
+			Uint32 surfaceValue = dest[i];
+			Uint32 surfacePreMult0 = (surfaceValue & 0x00FF00FF) * na;
+			Uint32 surfacePreMult1 = ((surfaceValue >> 8) & 0x00FF00FF) * na;
+			surfacePreMult0 += colorPreMult0;
+			surfacePreMult1 += colorPreMult1;
+			dest[i] = ((surfacePreMult0 >> 8) & 0x00FF00FF) | (surfacePreMult1 & 0xFF00FF00);
+		}
+	}
+
+	static void blendColorAlphaRowScalar(Uint32 *dest, const Uint8 *alphas, int w, Uint32 color)
+	{
+		Uint32 color0 = color & 0x00FF00FF;
+		Uint32 color1 = (color >> 8) & 0x00FF00FF;
+		for (int i = 0; i < w; i++)
+		{
+			Uint32 a = alphas[i];
+			Uint32 na = 255 - a;
+			Uint32 surfaceValue = dest[i];
+			Uint32 surfacePreMult0 = (surfaceValue & 0x00FF00FF) * na + color0 * a;
+			Uint32 surfacePreMult1 = ((surfaceValue >> 8) & 0x00FF00FF) * na + color1 * a;
+			dest[i] = ((surfacePreMult0 >> 8) & 0x00FF00FF) | (surfacePreMult1 & 0xFF00FF00);
+		}
+	}
+
+	#ifdef BLIT_SSE2_KERNELS
+	// SSE2 kernels, 4 pixels at a time with one channel per 16 bits lane.
+	// As with the scalar ones, each channel is (dest * (255 - a) + src * a) >> 8, which fits in 16 bits.
+
+	//! Blend 16 bits channels of s over d with weights a
+	static BLIT_TARGET("sse2") inline __m128i blendChannelsSSE2(__m128i d, __m128i s, __m128i a)
+	{
+		const __m128i full = _mm_set1_epi16(255);
+		return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(full, a)), _mm_mullo_epi16(s, a)), 8);
+	}
+
+	//! Return 16 bits channels with the alpha of each pixel of s copied in all of its channels
+	static BLIT_TARGET("sse2") inline __m128i broadcastAlphaSSE2(__m128i s)
+	{
+		return _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+	}
+
+	static BLIT_TARGET("sse2") void blendRowSSE2(Uint32 *dest, const Uint32 *src, int w, Uint8 alpha)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i globalAlpha = _mm_set1_epi16(alpha);
+		int i = 0;
+		for (; i + 4 <= w; i += 4)
+		{
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+			__m128i sLo = _mm_unpacklo_epi8(s, zero);
+			__m128i sHi = _mm_unpackhi_epi8(s, zero);
+			__m128i aLo = _mm_srli_epi16(_mm_mullo_epi16(broadcastAlphaSSE2(sLo), globalAlpha), 8);
+			__m128i aHi = _mm_srli_epi16(_mm_mullo_epi16(broadcastAlphaSSE2(sHi), globalAlpha), 8);
+			__m128i lo = blendChannelsSSE2(_mm_unpacklo_epi8(d, zero), sLo, aLo);
+			__m128i hi = blendChannelsSSE2(_mm_unpackhi_epi8(d, zero), sHi, aHi);
+			_mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(lo, hi));
+		}
+		blendRowScalar(dest + i, src + i, w - i, alpha);
+	}
+
+	static BLIT_TARGET("sse2") void blendColorRowSSE2(Uint32 *dest, int w, Uint32 color, Uint8 alpha)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i a = _mm_set1_epi16(alpha);
+		const __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+		int i = 0;
+		for (; i + 4 <= w; i += 4)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+			__m128i lo = blendChannelsSSE2(_mm_unpacklo_epi8(d, zero), c, a);
+			__m128i hi = blendChannelsSSE2(_mm_unpackhi_epi8(d, zero), c, a);
+			_mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(lo, hi));
+		}
+		blendColorRowScalar(dest + i, w - i, color, alpha);
+	}
+
+	static BLIT_TARGET("sse2") void blendColorAlphaRowSSE2(Uint32 *dest, const Uint8 *alphas, int w, Uint32 color)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+		int i = 0;
+		for (; i + 4 <= w; i += 4)
+		{
+			// spread the 4 alphas to the 4 bytes of their pixel
+			Sint32 packedAlphas;
+			memcpy(&packedAlphas, alphas + i, 4);
+			__m128i a = _mm_cvtsi32_si128(packedAlphas);
+			a = _mm_unpacklo_epi8(a, a);
+			a = _mm_unpacklo_epi16(a, a);
+
+			__m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+			__m128i lo = blendChannelsSSE2(_mm_unpacklo_epi8(d, zero), c, _mm_unpacklo_epi8(a, zero));
+			__m128i hi = blendChannelsSSE2(_mm_unpackhi_epi8(d, zero), c, _mm_unpackhi_epi8(a, zero));
+			_mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(lo, hi));
+		}
+		blendColorAlphaRowScalar(dest + i, alphas + i, w - i, color);
+	}
+	#endif
+
+	#ifdef BLIT_AVX2_KERNELS
+	// AVX2 kernels, same as SSE2 ones with 8 pixels at a time. Unpacks and packs work within each 128 bits
+	// half, so pixels 0-1 and 4-5 are in the low unpack, 2-3 and 6-7 in the high one, and the pack restores the order.
+
+	static BLIT_TARGET("avx2") inline __m256i blendChannelsAVX2(__m256i d, __m256i s, __m256i a)
+	{
+		const __m256i full = _mm256_set1_epi16(255);
+		return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(full, a)), _mm256_mullo_epi16(s, a)), 8);
+	}
+
+	static BLIT_TARGET("avx2") inline __m256i broadcastAlphaAVX2(__m256i s)
+	{
+		return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+	}
+
+	static BLIT_TARGET("avx2") void blendRowAVX2(Uint32 *dest, const Uint32 *src, int w, Uint8 alpha)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i globalAlpha = _mm256_set1_epi16(alpha);
+		int i = 0;
+		for (; i + 8 <= w; i += 8)
+		{
+			__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dest + i));
+			__m256i sLo = _mm256_unpacklo_epi8(s, zero);
+			__m256i sHi = _mm256_unpackhi_epi8(s, zero);
+			__m256i aLo = _mm256_srli_epi16(_mm256_mullo_epi16(broadcastAlphaAVX2(sLo), globalAlpha), 8);
+			__m256i aHi = _mm256_srli_epi16(_mm256_mullo_epi16(broadcastAlphaAVX2(sHi), globalAlpha), 8);
+			__m256i lo = blendChannelsAVX2(_mm256_unpacklo_epi8(d, zero), sLo, aLo);
+			__m256i hi = blendChannelsAVX2(_mm256_unpackhi_epi8(d, zero), sHi, aHi);
+			_mm256_storeu_si256((__m256i *)(dest + i), _mm256_packus_epi16(lo, hi));
+		}
+		blendRowSSE2(dest + i, src + i, w - i, alpha);
+	}
+
+	static BLIT_TARGET("avx2") void blendColorRowAVX2(Uint32 *dest, int w, Uint32 color, Uint8 alpha)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i a = _mm256_set1_epi16(alpha);
+		const __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero);
+		int i = 0;
+		for (; i + 8 <= w; i += 8)
+		{
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dest + i));
+			__m256i lo = blendChannelsAVX2(_mm256_unpacklo_epi8(d, zero), c, a);
+			__m256i hi = blendChannelsAVX2(_mm256_unpackhi_epi8(d, zero), c, a);
+			_mm256_storeu_si256((__m256i *)(dest + i), _mm256_packus_epi16(lo, hi));
+		}
+		blendColorRowSSE2(dest + i, w - i, color, alpha);
+	}
+
+	static BLIT_TARGET("avx2") void blendColorAlphaRowAVX2(Uint32 *dest, const Uint8 *alphas, int w, Uint32 color)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero);
+		int i = 0;
+		for (; i + 8 <= w; i += 8)
+		{
+			// spread the 8 alphas to the 4 bytes of their pixel, pixels 0-3 in the low half and 4-7 in the high one
+			__m128i a = _mm_loadl_epi64((const __m128i *)(alphas + i));
+			a = _mm_unpacklo_epi8(a, a);
+			__m256i spread = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(a, a)), _mm_unpackhi_epi16(a, a), 1);
+
+			__m256i d = _mm256_loadu_si256((const __m256i *)(dest + i));
+			__m256i lo = blendChannelsAVX2(_mm256_unpacklo_epi8(d, zero), c, _mm256_unpacklo_epi8(spread, zero));
+			__m256i hi = blendChannelsAVX2(_mm256_unpackhi_epi8(d, zero), c, _mm256_unpackhi_epi8(spread, zero));
+			_mm256_storeu_si256((__m256i *)(dest + i), _mm256_packus_epi16(lo, hi));
+		}
+		blendColorAlphaRowSSE2(dest + i, alphas + i, w - i, color);
+	}
+	#endif
+
+	static const BlitKernels kernels[BlitKernels::IMPLEMENTATION_COUNT] =
+	{
+		{ blendRowScalar, blendColorRowScalar, blendColorAlphaRowScalar, "scalar" },
+		#ifdef BLIT_SSE2_KERNELS
+		{ blendRowSSE2, blendColorRowSSE2, blendColorAlphaRowSSE2, "SSE2" },
+		#else
+		{ NULL, NULL, NULL, "SSE2" },
+		#endif
+		#ifdef BLIT_AVX2_KERNELS
+		{ blendRowAVX2, blendColorRowAVX2, blendColorAlphaRowAVX2, "AVX2" },
+		#else
+		{ NULL, NULL, NULL, "AVX2" },
+		#endif
+	};
+
+	//! Return true if the CPU running us supports an implementation
+	static bool isSupportedByCPU(BlitKernels::Implementation implementation)
+	{
+		switch (implementation)
+		{
+			case BlitKernels::SCALAR:
+				return true;
+			#if defined(BLIT_SSE2_KERNELS) && defined(__GNUC__)
+			case BlitKernels::SSE2:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("sse2");
+			#elif defined(BLIT_SSE2_KERNELS)
+			case BlitKernels::SSE2:
+				return true;
+			#endif
+			#ifdef BLIT_AVX2_KERNELS
+			case BlitKernels::AVX2:
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2");
+			#endif
+			default:
+				return false;
+		}
+	}
+
+	const BlitKernels *BlitKernels::get(Implementation implementation)
+	{
+		if ((implementation < 0) || (implementation >= IMPLEMENTATION_COUNT))
+			return NULL;
+		if (!kernels[implementation].blendRow || !isSupportedByCPU(implementation))
+			return NULL;
+		return &kernels[implementation];
+	}
+
+	const BlitKernels *BlitKernels::best(void)
+	{
+		static const BlitKernels *bestKernels = NULL;
+		if (!bestKernels)
+		{
+			for (int i = IMPLEMENTATION_COUNT - 1; (i >= 0) && !bestKernels; i--)
+				bestKernels = get(static_cast<Implementation>(i));
+		}
+		return bestKernels;
+	}
+}
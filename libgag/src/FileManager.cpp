@@ -52,6 +52,7 @@
 #	include <sys/types.h>
 #	include <dirent.h>
 #	include <sys/stat.h>
+#	include <unistd.h>
 #endif
 
 #ifndef WIN32
@@ -222,6 +223,8 @@ namespace GAGCore
 	
 	StreamBackend *FileManager::openInputStreamBackend(const std::string filename)
 	{	
+		if (isAbsolutePath(filename))
+			return new FileStreamBackend(fopen(filename.c_str(), "rb"));
 	
 		for (size_t i = 0; i < dirList.size(); ++i)
 		{
@@ -404,6 +407,34 @@ namespace GAGCore
 		return (s.st_mode & S_IFDIR) != 0;
 	}
 	
+	bool FileManager::isAbsolutePath(const std::string path)
+	{
+		#ifdef WIN32
+		if ((path.length() > 1) && (path[1] == ':'))
+			return true;
+		return !path.empty() && ((path[0] == '\\') || (path[0] == '/'));
+		#else
+		return !path.empty() && (path[0] == '/');
+		#endif
+	}
+	
+	std::string FileManager::absolutePath(const std::string path)
+	{
+		if (isAbsolutePath(path))
+			return path;
+		char cwd[4096];
+		#ifdef WIN32
+		if (_getcwd(cwd, sizeof(cwd)) == NULL)
+		#else
+		if (getcwd(cwd, sizeof(cwd)) == NULL)
+		#endif
+			return path;
+		std::string absolute(cwd);
+		absolute += DIR_SEPARATOR;
+		absolute += path;
+		return absolute;
+	}
+	
 	bool FileManager::gzip(const std::string &source, const std::string &dest)
 	{
 		// Open streams
@@ -555,6 +586,15 @@ namespace GAGCore
 		return result;
 	}
 	
+	bool FileManager::initRealDirectoryListing(const std::string realDir, const std::string extension, const bool dirs)
+	{
+		clearFileList();
+		bool result = addListingForDir(realDir, extension, dirs);
+		if (result)
+			fileListIndex=0;
+		return result;
+	}
+	
 	const std::string FileManager::getNextDirectoryEntry(void)
 	{
 		if ((fileListIndex >= 0) && (fileListIndex < (int)fileList.size()))
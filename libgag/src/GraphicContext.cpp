@@ -21,6 +21,8 @@
 #include <Toolkit.h>
 #include <FileManager.h>
 #include <SupportFunctions.h>
+#include <BlitKernels.h>
+#include <ParallelRenderer.h>
 #include <assert.h>
 #include <string>
 #include <sstream>
@@ -31,6 +33,10 @@
 #include <string.h>
 #include <valarray>
 #include <cstdlib>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -105,6 +111,114 @@ namespace GAGCore
 	Color Color::black = Color(0, 0, 0);
 	Color Color::white = Color(255,255,255);
 
+	// HueMask
+	HueMask::HueMask(const SDL_Surface *source)
+	{
+		w = source->w;
+		h = source->h;
+		hue.resize(w * h);
+		value.resize(w * h);
+		chroma.resize(w * h);
+		alpha.resize(w * h);
+		for (int y = 0; y < h; y++)
+		{
+			const Uint32 *src = ((const Uint32 *)source->pixels) + y*(source->pitch>>2);
+			for (int x = 0; x < w; x++)
+			{
+				Color c;
+				c.unpack(*src++);
+				int max = std::max(c.r, std::max(c.g, c.b));
+				int min = std::min(c.r, std::min(c.g, c.b));
+				int delta = max - min;
+				int pixelHue;
+				if (delta == 0)
+					pixelHue = 0;
+				else if (max == c.r)
+					pixelHue = ((c.g - c.b) * HUE_SECTOR) / delta;
+				else if (max == c.g)
+					pixelHue = ((c.b - c.r) * HUE_SECTOR) / delta + 2 * HUE_SECTOR;
+				else
+					pixelHue = ((c.r - c.g) * HUE_SECTOR) / delta + 4 * HUE_SECTOR;
+				if (pixelHue < 0)
+					pixelHue += 6 * HUE_SECTOR;
+
+				size_t index = y * w + x;
+				hue[index] = static_cast<Uint16>(pixelHue);
+				value[index] = static_cast<Uint8>(max);
+				chroma[index] = static_cast<Uint8>(delta);
+				alpha[index] = c.a;
+			}
+		}
+	}
+
+	//! Return the weight of chroma to remove from value for a channel at k sector units from the hue, see HSV to RGB conversion
+	static inline int hueChannelWeight(int k)
+	{
+		k %= 6 * HueMask::HUE_SECTOR;
+		int t = std::min(k, 4 * HueMask::HUE_SECTOR - k);
+		return std::max(0, std::min(static_cast<int>(HueMask::HUE_SECTOR), t));
+	}
+
+	//! Rebuild w pixels from hue mask planes with hue rotated by shift units, packed in the screen format
+	static void hueShiftRow(Uint32 *dest, const Uint16 *hue, const Uint8 *value, const Uint8 *chroma, const Uint8 *alpha, int w, int shift)
+	{
+		const int rOffset = 5 * HueMask::HUE_SECTOR;
+		const int gOffset = 3 * HueMask::HUE_SECTOR;
+		const int bOffset = 1 * HueMask::HUE_SECTOR;
+		int i = 0;
+
+		#ifdef __SSE2__
+		// 8 pixels at a time, all computations fit in 16 bits lanes
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i shiftV = _mm_set1_epi16(static_cast<short>(shift));
+		const __m128i wheel = _mm_set1_epi16(6 * HueMask::HUE_SECTOR);
+		const __m128i wheelMax = _mm_set1_epi16(6 * HueMask::HUE_SECTOR - 1);
+		const __m128i four = _mm_set1_epi16(4 * HueMask::HUE_SECTOR);
+		const __m128i one = _mm_set1_epi16(HueMask::HUE_SECTOR);
+		const __m128i offsets[3] = { _mm_set1_epi16(rOffset), _mm_set1_epi16(gOffset), _mm_set1_epi16(bOffset) };
+		const __m128i shifts[4] = { _mm_cvtsi32_si128(_glFormat.Rshift), _mm_cvtsi32_si128(_glFormat.Gshift), _mm_cvtsi32_si128(_glFormat.Bshift), _mm_cvtsi32_si128(_glFormat.Ashift) };
+		for (; i + 8 <= w; i += 8)
+		{
+			__m128i h = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(hue + i)), shiftV);
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(value + i)), zero);
+			__m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(chroma + i)), zero);
+			__m128i channels[4];
+			for (int j = 0; j < 3; j++)
+			{
+				// k = (h + offset) mod wheel, h + offset is below three turns
+				__m128i k = _mm_add_epi16(h, offsets[j]);
+				k = _mm_sub_epi16(k, _mm_and_si128(_mm_cmpgt_epi16(k, wheelMax), wheel));
+				k = _mm_sub_epi16(k, _mm_and_si128(_mm_cmpgt_epi16(k, wheelMax), wheel));
+				__m128i t = _mm_min_epi16(k, _mm_sub_epi16(four, k));
+				t = _mm_min_epi16(_mm_max_epi16(t, zero), one);
+				channels[j] = _mm_sub_epi16(v, _mm_srli_epi16(_mm_mullo_epi16(c, t), 8));
+			}
+			channels[3] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(alpha + i)), zero);
+
+			__m128i lo = zero;
+			__m128i hi = zero;
+			for (int j = 0; j < 4; j++)
+			{
+				lo = _mm_or_si128(lo, _mm_sll_epi32(_mm_unpacklo_epi16(channels[j], zero), shifts[j]));
+				hi = _mm_or_si128(hi, _mm_sll_epi32(_mm_unpackhi_epi16(channels[j], zero), shifts[j]));
+			}
+			_mm_storeu_si128((__m128i *)(dest + i), lo);
+			_mm_storeu_si128((__m128i *)(dest + i + 4), hi);
+		}
+		#endif
+
+		for (; i < w; i++)
+		{
+			int h = hue[i] + shift;
+			int v = value[i];
+			int c = chroma[i];
+			Uint32 r = v - ((c * hueChannelWeight(h + rOffset)) >> 8);
+			Uint32 g = v - ((c * hueChannelWeight(h + gOffset)) >> 8);
+			Uint32 b = v - ((c * hueChannelWeight(h + bOffset)) >> 8);
+			dest[i] = (r << _glFormat.Rshift) | (g << _glFormat.Gshift) | (b << _glFormat.Bshift) | (static_cast<Uint32>(alpha[i]) << _glFormat.Ashift);
+		}
+	}
+
 	#ifdef HAVE_OPENGL
 	// Cache for GL state, call gl only if necessary. GL optimisations
 	static struct GLState
@@ -235,6 +349,137 @@ namespace GAGCore
 			_dfactor = dfactor;
 		}
 	} glState;
+
+	#ifndef APIENTRY
+		#define APIENTRY
+	#endif
+	#ifndef GL_FRAGMENT_SHADER
+		#define GL_FRAGMENT_SHADER 0x8B30
+	#endif
+	#ifndef GL_COMPILE_STATUS
+		#define GL_COMPILE_STATUS 0x8B81
+	#endif
+	#ifndef GL_LINK_STATUS
+		#define GL_LINK_STATUS 0x8B82
+	#endif
+
+	// GLSL program rotating the hue of textures while drawing them, used for team colors.
+	// GL 2.0 entry points are fetched through SDL, so that we do not depend on GL headers or libraries being recent.
+	static struct HueShader
+	{
+		static const bool verbose = false;
+		typedef GLuint (APIENTRY *CreateShaderFunc)(GLenum type);
+		typedef void (APIENTRY *ShaderSourceFunc)(GLuint shader, GLsizei count, const char **string, const GLint *length);
+		typedef void (APIENTRY *CompileShaderFunc)(GLuint shader);
+		typedef void (APIENTRY *GetShaderivFunc)(GLuint shader, GLenum pname, GLint *params);
+		typedef GLuint (APIENTRY *CreateProgramFunc)(void);
+		typedef void (APIENTRY *AttachShaderFunc)(GLuint program, GLuint shader);
+		typedef void (APIENTRY *LinkProgramFunc)(GLuint program);
+		typedef void (APIENTRY *GetProgramivFunc)(GLuint program, GLenum pname, GLint *params);
+		typedef void (APIENTRY *UseProgramFunc)(GLuint program);
+		typedef GLint (APIENTRY *GetUniformLocationFunc)(GLuint program, const char *name);
+		typedef void (APIENTRY *Uniform1fFunc)(GLint location, GLfloat v0);
+
+		CreateShaderFunc createShader;
+		ShaderSourceFunc shaderSource;
+		CompileShaderFunc compileShader;
+		GetShaderivFunc getShaderiv;
+		CreateProgramFunc createProgram;
+		AttachShaderFunc attachShader;
+		LinkProgramFunc linkProgram;
+		GetProgramivFunc getProgramiv;
+		UseProgramFunc useProgram;
+		GetUniformLocationFunc getUniformLocation;
+		Uniform1fFunc uniform1f;
+
+		//! the linked program, 0 if shaders are not available
+		GLuint program;
+		//! location of the hue shift uniform, in sectors of 60 degrees
+		GLint hueShiftLocation;
+
+		HueShader(void)
+		{
+			program = 0;
+			hueShiftLocation = -1;
+		}
+
+		//! Compile the program for the current GL context, textures being rectangle ones if isTextureSRectangle
+		void init(bool isTextureSRectangle)
+		{
+			program = 0;
+			createShader = (CreateShaderFunc)SDL_GL_GetProcAddress("glCreateShader");
+			shaderSource = (ShaderSourceFunc)SDL_GL_GetProcAddress("glShaderSource");
+			compileShader = (CompileShaderFunc)SDL_GL_GetProcAddress("glCompileShader");
+			getShaderiv = (GetShaderivFunc)SDL_GL_GetProcAddress("glGetShaderiv");
+			createProgram = (CreateProgramFunc)SDL_GL_GetProcAddress("glCreateProgram");
+			attachShader = (AttachShaderFunc)SDL_GL_GetProcAddress("glAttachShader");
+			linkProgram = (LinkProgramFunc)SDL_GL_GetProcAddress("glLinkProgram");
+			getProgramiv = (GetProgramivFunc)SDL_GL_GetProcAddress("glGetProgramiv");
+			useProgram = (UseProgramFunc)SDL_GL_GetProcAddress("glUseProgram");
+			getUniformLocation = (GetUniformLocationFunc)SDL_GL_GetProcAddress("glGetUniformLocation");
+			uniform1f = (Uniform1fFunc)SDL_GL_GetProcAddress("glUniform1f");
+			if (!(createShader && shaderSource && compileShader && getShaderiv && createProgram && attachShader && linkProgram && getProgramiv && useProgram && getUniformLocation && uniform1f))
+			{
+				if (verbose)
+					std::cout << "Toolkit : GLSL not present, team colors will be cached per color" << std::endl;
+				return;
+			}
+
+			// same HSV rotation as Color::setHSV, using HSV to RGB formula without branches
+			std::string source;
+			if (isTextureSRectangle)
+				source = "#extension GL_ARB_texture_rectangle : enable\n"
+					"uniform sampler2DRect tex;\n"
+					"#define TEXTURE texture2DRect\n";
+			else
+				source = "uniform sampler2D tex;\n"
+					"#define TEXTURE texture2D\n";
+			source +=
+				"uniform float hueShift;\n"
+				"void main()\n"
+				"{\n"
+				"	vec4 c = TEXTURE(tex, gl_TexCoord[0].st);\n"
+				"	float v = max(c.r, max(c.g, c.b));\n"
+				"	float chroma = v - min(c.r, min(c.g, c.b));\n"
+				"	float h = 0.0;\n"
+				"	if (chroma > 0.0)\n"
+				"	{\n"
+				"		if (v == c.r)\n"
+				"			h = (c.g - c.b) / chroma;\n"
+				"		else if (v == c.g)\n"
+				"			h = (c.b - c.r) / chroma + 2.0;\n"
+				"		else\n"
+				"			h = (c.r - c.g) / chroma + 4.0;\n"
+				"	}\n"
+				"	vec3 k = mod(vec3(5.0, 3.0, 1.0) + h + hueShift + 6.0, 6.0);\n"
+				"	vec3 rgb = v - chroma * clamp(min(k, 4.0 - k), 0.0, 1.0);\n"
+				"	gl_FragColor = vec4(rgb, c.a) * gl_Color;\n"
+				"}\n";
+
+			GLint status;
+			const char *sourcePtr = source.c_str();
+			GLuint shader = createShader(GL_FRAGMENT_SHADER);
+			shaderSource(shader, 1, &sourcePtr, NULL);
+			compileShader(shader);
+			getShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				std::cerr << "Toolkit : can't compile hue shader, team colors will be cached per color" << std::endl;
+				return;
+			}
+			GLuint newProgram = createProgram();
+			attachShader(newProgram, shader);
+			linkProgram(newProgram);
+			getProgramiv(newProgram, GL_LINK_STATUS, &status);
+			if (!status)
+			{
+				std::cerr << "Toolkit : can't link hue shader, team colors will be cached per color" << std::endl;
+				return;
+			}
+			program = newProgram;
+			hueShiftLocation = getUniformLocation(program, "hueShift");
+		}
+	} hueShader;
 	#endif
 
 	SDL_Surface *DrawableSurface::convertForUpload(SDL_Surface *source)
@@ -256,6 +501,7 @@ namespace GAGCore
 	DrawableSurface::DrawableSurface(const std::string &imageFileName)
 	{
 		sdlsurface = NULL;
+		recorder = NULL;
 		if (!loadImage(imageFileName))
 			setRes(0, 0);
 		allocateTexture();
@@ -264,6 +510,7 @@ namespace GAGCore
 	DrawableSurface::DrawableSurface(int w, int h)
 	{
 		sdlsurface = NULL;
+		recorder = NULL;
 		setRes(w, h);
 		allocateTexture();
 	}
@@ -273,6 +520,7 @@ namespace GAGCore
 		assert(sourceSurface);
 		// beurk, const cast here becasue SDL API sucks
 		sdlsurface = convertForUpload(const_cast<SDL_Surface *>(sourceSurface));
+		recorder = NULL;
 		assert(sdlsurface);
 		setClipRect();
 		allocateTexture();
@@ -504,8 +752,35 @@ namespace GAGCore
 		dirty = true;
 	}
 
+	void DrawableSurface::copySurface(int x, int y, const SDL_Surface *sourceSurface)
+	{
+		assert(sourceSurface);
+		SDL_Surface *converted = convertForUpload(const_cast<SDL_Surface *>(sourceSurface));
+
+		// clip to this surface
+		int sx = std::max(0, -x);
+		int sy = std::max(0, -y);
+		int w = std::min(converted->w, sdlsurface->w - x) - sx;
+		int h = std::min(converted->h, sdlsurface->h - y) - sy;
+		for (int dy = 0; dy < h; dy++)
+		{
+			Uint32 *memSrc = ((Uint32 *)converted->pixels) + (sy + dy)*(converted->pitch>>2) + sx;
+			Uint32 *memDest = ((Uint32 *)sdlsurface->pixels) + (y + sy + dy)*(sdlsurface->pitch>>2) + x + sx;
+			memcpy(memDest, memSrc, std::max(w, 0) * sizeof(Uint32));
+		}
+
+		SDL_FreeSurface(converted);
+		dirty = true;
+	}
+
 	void DrawableSurface::drawPixel(int x, int y, const Color& color)
 	{
+		if (recorder)
+		{
+			recorder->recordPrimitive(this, ParallelRenderer::PIXEL, x, y, 0, 0, 0, 0, color);
+			return;
+		}
+
 		// clip
 		if ((x<clipRect.x) || (x>=clipRect.x+clipRect.w) || (y<clipRect.y) || (y>=clipRect.y+clipRect.h))
 			return;
@@ -550,6 +825,12 @@ namespace GAGCore
 
 	void DrawableSurface::drawRect(int x, int y, int w, int h, const Color& color)
 	{
+		if (recorder)
+		{
+			recorder->recordPrimitive(this, ParallelRenderer::RECT, x, y, w, h, 0, 0, color);
+			return;
+		}
+
 		_drawHorzLine(x, y, w, color);
 		_drawHorzLine(x, y+h-1, w, color);
 		_drawVertLine(x, y, h, color);
@@ -569,13 +850,19 @@ namespace GAGCore
 
 	void DrawableSurface::drawFilledRect(int x, int y, int w, int h, const Color& color)
 	{
+		if (recorder)
+		{
+			recorder->recordPrimitive(this, ParallelRenderer::FILLED_RECT, x, y, w, h, 0, 0, color);
+			return;
+		}
+
 		// clip
 		if (x < clipRect.x)
 		{
 			w -= clipRect.x - x;
 			x = clipRect.x;
 		}
-		if (y < 0)
+		if (y < clipRect.y)
 		{
 			h -= clipRect.y - y;
 			y = clipRect.y;
@@ -608,26 +895,12 @@ namespace GAGCore
 		}
 		else
 		{
-			Uint32 a = color.a;
-			Uint32 na = 255 - a;
+			const BlitKernels *kernels = BlitKernels::best();
 			Uint32 colorValue = color.applyAlpha(Color::ALPHA_OPAQUE).pack();
-			Uint32 colorPreMult0 = (colorValue & 0x00FF00FF) * a;
-			Uint32 colorPreMult1 = ((colorValue >> 8) & 0x00FF00FF) * a;
-
 			for (int dy = y; dy < y + h; dy++)
 			{
 				Uint32 *mem = ((Uint32 *)sdlsurface->pixels) + dy*(sdlsurface->pitch>>2) + x;
-				int dw = w;
-				do
-				{
-					Uint32 surfaceValue = *mem;
-					Uint32 surfacePreMult0 = (surfaceValue & 0x00FF00FF) * na;
-					Uint32 surfacePreMult1 = ((surfaceValue >> 8) & 0x00FF00FF) * na;
-					surfacePreMult0 += colorPreMult0;
-					surfacePreMult1 += colorPreMult1;
-					*mem++ = ((surfacePreMult0 >> 8) & 0x00FF00FF) | (surfacePreMult1 & 0xFF00FF00);
-				}
-				while (--dw);
+				kernels->blendColorRow(mem, w, colorValue, color.a);
 			}
 		}
 		dirty = true;
@@ -711,6 +984,64 @@ namespace GAGCore
 		dirty = true;
 	}
 
+	void DrawableSurface::_drawHueMask(int x, int y, const HueMask *mask, float hueShift, Uint8 alpha)
+	{
+		if (recorder)
+		{
+			recorder->recordHueMask(this, x, y, mask, hueShift, alpha);
+			return;
+		}
+
+		int sx = 0;
+		int sy = 0;
+		int sw = mask->w;
+		int sh = mask->h;
+
+		// clip
+		if (x < clipRect.x)
+		{
+			int diff = clipRect.x - x;
+			sw -= diff;
+			sx += diff;
+			x = clipRect.x;
+		}
+		if (y < clipRect.y)
+		{
+			int diff = clipRect.y - y;
+			sh -= diff;
+			sy += diff;
+			y = clipRect.y;
+		}
+		if (x + sw >= clipRect.x + clipRect.w)
+		{
+			sw = clipRect.x + clipRect.w - x;
+		}
+		if (y + sh >= clipRect.y + clipRect.h)
+		{
+			sh = clipRect.y + clipRect.h - y;
+		}
+		if ((sw <= 0) || (sh <= 0))
+			return;
+
+		// convert shift from degrees to hue units in [0, 6 * HUE_SECTOR)
+		const int wheel = 6 * HueMask::HUE_SECTOR;
+		int shift = static_cast<int>(floorf(hueShift * static_cast<float>(HueMask::HUE_SECTOR) / 60.0f + 0.5f)) % wheel;
+		if (shift < 0)
+			shift += wheel;
+
+		// draw, rebuilding each row in the screen format before blending it
+		const BlitKernels *kernels = BlitKernels::best();
+		std::valarray<Uint32> row(sw);
+		for (int dy = 0; dy < sh; dy++)
+		{
+			size_t srcIndex = (sy + dy) * mask->w + sx;
+			Uint32 *memDest = ((Uint32 *)sdlsurface->pixels) + (y + dy)*(sdlsurface->pitch>>2) + x;
+			hueShiftRow(&row[0], &mask->hue[srcIndex], &mask->value[srcIndex], &mask->chroma[srcIndex], &mask->alpha[srcIndex], sw, shift);
+			kernels->blendRow(memDest, &row[0], sw, alpha);
+		}
+		dirty = true;
+	}
+
 	void DrawableSurface::_drawHorzLine(int x, int y, int l, const Color& color)
 	{
 		// clip
@@ -778,6 +1109,12 @@ namespace GAGCore
 
 	void DrawableSurface::drawLine(int x1, int y1, int x2, int y2, const Color& _color)
 	{
+		if (recorder)
+		{
+			recorder->recordPrimitive(this, ParallelRenderer::LINE, x1, y1, 0, 0, x2, y2, _color);
+			return;
+		}
+
 		// we want to modify the color
 		Color color = _color;
 
@@ -964,23 +1301,29 @@ namespace GAGCore
 
 	void DrawableSurface::drawVertLine(int x, int y, int l, const Color& color)
 	{
-		 _drawVertLine(x, y, l, color);
+		if (recorder)
+			recorder->recordPrimitive(this, ParallelRenderer::VERT_LINE, x, y, l, 0, 0, 0, color);
+		else
+			_drawVertLine(x, y, l, color);
 	}
 	
 	void DrawableSurface::drawHorzLine(int x, int y, int l, const Color& color)
 	{
-		_drawHorzLine(x, y, l, color);
+		if (recorder)
+			recorder->recordPrimitive(this, ParallelRenderer::HORZ_LINE, x, y, l, 0, 0, 0, color);
+		else
+			_drawHorzLine(x, y, l, color);
 	}
 	
 	// compat
 	void DrawableSurface::drawVertLine(int x, int y, int l, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 	{
-		 _drawVertLine(x, y, l, Color(r, g, b, a));
+		drawVertLine(x, y, l, Color(r, g, b, a));
 	}
 	// compat
 	void DrawableSurface::drawHorzLine(int x, int y, int l, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 	{
-		_drawHorzLine(x, y, l, Color(r, g, b, a));
+		drawHorzLine(x, y, l, Color(r, g, b, a));
 	}
 	// compat
 	void DrawableSurface::drawLine(int x1, int y1, int x2, int y2, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
@@ -990,6 +1333,12 @@ namespace GAGCore
 
 	void DrawableSurface::drawCircle(int x, int y, int radius, const Color& _color)
 	{
+		if (recorder)
+		{
+			recorder->recordPrimitive(this, ParallelRenderer::CIRCLE, x, y, radius, 0, 0, 0, _color);
+			return;
+		}
+
 		// we want to modify the color
 		Color color = _color;
 
@@ -1068,6 +1417,12 @@ namespace GAGCore
 
 	void DrawableSurface::drawSurface(int x, int y, DrawableSurface *surface, int sx, int sy, int sw, int sh, Uint8 alpha)
 	{
+		if (recorder)
+		{
+			recorder->recordSurface(this, x, y, surface, sx, sy, sw, sh, alpha);
+			return;
+		}
+
 		if (alpha == Color::ALPHA_OPAQUE)
 		{
 			#ifdef HAVE_OPENGL
@@ -1128,69 +1483,52 @@ namespace GAGCore
 				std::cerr << "Blitting with alphablending from framebuffer in GL is forbidden" << std::endl;
 				assert(false);
 			}
+			_blendSurface(x, y, surface, sx, sy, sw, sh, alpha);
+		}
+		dirty = true;
+	}
 
-			// check we assume the source rect is within the source surface
-			assert((sx >= 0) && (sx < surface->getW()));
-			assert((sy >= 0) && (sy < surface->getH()));
-			assert((sw > 0) && (sx + sw <= surface->getW()));
-			assert((sh > 0) && (sy + sh <= surface->getH()));
-
-			// clip
-			if (x < clipRect.x)
-			{
-				int diff = clipRect.x - x;
-				sw -= diff;
-				sx += diff;
-				x = clipRect.x;
-			}
-			if (y < 0)
-			{
-				int diff = clipRect.y - y;
-				sh -= diff;
-				sy += diff;
-				y = clipRect.y;
-			}
-			if (x + sw >= clipRect.x + clipRect.w)
-			{
-				sw = clipRect.x + clipRect.w - x;
-			}
-			if (y + sh >= clipRect.y + clipRect.h)
-			{
-				sh = clipRect.y + clipRect.h - y;
-			}
-			if ((sw <= 0) || (sh <= 0))
-				return;
-
-			// draw
-			#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			Uint32 alphaShift = 0;
-			#else
-			Uint32 alphaShift = 24;
-			#endif
-			for (int dy = 0; dy < sh; dy++)
-			{
-				Uint32 *memSrc = ((Uint32 *)surface->sdlsurface->pixels) + (sy + dy)*(surface->sdlsurface->pitch>>2) + sx;
-				Uint32 *memDest = ((Uint32 *)sdlsurface->pixels) + (y + dy)*(sdlsurface->pitch>>2) + x;
-				int dw = sw;
-				do
-				{
-					Uint32 srcValue = *memSrc++;
-					Uint32 srcAlpha = (((srcValue >> alphaShift) & 0xFF) * alpha) >> 8;
-					Uint32 destAlpha = 255 - srcAlpha;
-					Uint32 srcPreMult0 =  (srcValue & 0x00FF00FF) * srcAlpha;
-					Uint32 srcPreMult1 = ((srcValue >> 8) & 0x00FF00FF) * srcAlpha;
-
-					Uint32 destValue = *memDest;
-					Uint32 destPreMult0 =  (destValue & 0x00FF00FF) * destAlpha;
-					Uint32 destPreMult1 = ((destValue >> 8) & 0x00FF00FF) * destAlpha;
+	void DrawableSurface::_blendSurface(int x, int y, DrawableSurface *surface, int sx, int sy, int sw, int sh, Uint8 alpha)
+	{
+		// check we assume the source rect is within the source surface
+		assert((sx >= 0) && (sx < surface->getW()));
+		assert((sy >= 0) && (sy < surface->getH()));
+		assert((sw > 0) && (sx + sw <= surface->getW()));
+		assert((sh > 0) && (sy + sh <= surface->getH()));
 
-					destPreMult0 += srcPreMult0;
-					destPreMult1 += srcPreMult1;
+		// clip
+		if (x < clipRect.x)
+		{
+			int diff = clipRect.x - x;
+			sw -= diff;
+			sx += diff;
+			x = clipRect.x;
+		}
+		if (y < clipRect.y)
+		{
+			int diff = clipRect.y - y;
+			sh -= diff;
+			sy += diff;
+			y = clipRect.y;
+		}
+		if (x + sw >= clipRect.x + clipRect.w)
+		{
+			sw = clipRect.x + clipRect.w - x;
+		}
+		if (y + sh >= clipRect.y + clipRect.h)
+		{
+			sh = clipRect.y + clipRect.h - y;
+		}
+		if ((sw <= 0) || (sh <= 0))
+			return;
 
-					*memDest++ = ((destPreMult0 >> 8) & 0x00FF00FF) | (destPreMult1 & 0xFF00FF00);
-				}
-				while (--dw);
-			}
+		// draw
+		const BlitKernels *kernels = BlitKernels::best();
+		for (int dy = 0; dy < sh; dy++)
+		{
+			Uint32 *memSrc = ((Uint32 *)surface->sdlsurface->pixels) + (sy + dy)*(surface->sdlsurface->pitch>>2) + sx;
+			Uint32 *memDest = ((Uint32 *)sdlsurface->pixels) + (y + dy)*(sdlsurface->pitch>>2) + x;
+			kernels->blendRow(memDest, memSrc, sw, alpha);
 		}
 		dirty = true;
 	}
@@ -1223,7 +1561,18 @@ namespace GAGCore
 
 		// draw rotation
 		if (sprite->rotated[index])
-			drawSurface(x, y, sprite->getRotatedSurface(index), alpha);
+		{
+			#ifdef HAVE_OPENGL
+			if ((this == _gc) && (_gc->optionFlags & GraphicContext::USEGPU))
+			{
+				DrawableSurface *orig = sprite->rotated[index]->orig;
+				if (!_gc->drawHueShiftedSurface(x, y, orig->getW(), orig->getH(), orig, sprite->getHueShift(), alpha))
+					drawSurface(x, y, sprite->getRotatedSurface(index), alpha);
+			}
+			else
+			#endif
+				_drawHueMask(static_cast<int>(x), static_cast<int>(y), sprite->getRotatedMask(index), sprite->getHueShift(), alpha);
+		}
 	}
 
 	void DrawableSurface::drawSprite(float x, float y, Sprite *sprite, unsigned index,  Uint8 alpha)
@@ -1239,7 +1588,18 @@ namespace GAGCore
 
 		// draw rotation
 		if (sprite->rotated[index])
-			drawSurface(x, y, sprite->getRotatedSurface(index), alpha);
+		{
+			#ifdef HAVE_OPENGL
+			if ((this == _gc) && (_gc->optionFlags & GraphicContext::USEGPU))
+			{
+				DrawableSurface *orig = sprite->rotated[index]->orig;
+				if (!_gc->drawHueShiftedSurface(x, y, orig->getW(), orig->getH(), orig, sprite->getHueShift(), alpha))
+					drawSurface(x, y, sprite->getRotatedSurface(index), alpha);
+			}
+			else
+			#endif
+				_drawHueMask(static_cast<int>(x), static_cast<int>(y), sprite->getRotatedMask(index), sprite->getHueShift(), alpha);
+		}
 	}
 
 	void DrawableSurface::drawSprite(int x, int y, int w, int h, Sprite *sprite, unsigned index, Uint8 alpha)
@@ -1253,9 +1613,14 @@ namespace GAGCore
 		if (sprite->images[index])
 			drawSurface(x, y, w, h, sprite->images[index], alpha);
 
-		// draw rotation
-		if (sprite->rotated[index])
-			drawSurface(x, y, w, h, sprite->getRotatedSurface(index), alpha);
+		// draw rotation, stretched blits are only available on GL, see canDrawStretchedSprite
+		#ifdef HAVE_OPENGL
+		if (sprite->rotated[index] && (this == _gc) && (_gc->optionFlags & GraphicContext::USEGPU))
+		{
+			if (!_gc->drawHueShiftedSurface(x, y, w, h, sprite->rotated[index]->orig, sprite->getHueShift(), alpha))
+				drawSurface(x, y, w, h, sprite->getRotatedSurface(index), alpha);
+		}
+		#endif
 	}
 
 	void DrawableSurface::drawSprite(float x, float y, float w, float h, Sprite *sprite, unsigned index, Uint8 alpha)
@@ -1269,9 +1634,14 @@ namespace GAGCore
 		if (sprite->images[index])
 			drawSurface(x, y, w, h, sprite->images[index], alpha);
 
-		// draw rotation
-		if (sprite->rotated[index])
-			drawSurface(x, y, w, h, sprite->getRotatedSurface(index), alpha);
+		// draw rotation, stretched blits are only available on GL, see canDrawStretchedSprite
+		#ifdef HAVE_OPENGL
+		if (sprite->rotated[index] && (this == _gc) && (_gc->optionFlags & GraphicContext::USEGPU))
+		{
+			if (!_gc->drawHueShiftedSurface(x, y, w, h, sprite->rotated[index]->orig, sprite->getHueShift(), alpha))
+				drawSurface(x, y, w, h, sprite->getRotatedSurface(index), alpha);
+		}
+		#endif
 	}
 
 	void DrawableSurface::drawString(int x, int y, Font *font, const std::string &msg, int w, Uint8 alpha)
@@ -1338,22 +1708,81 @@ namespace GAGCore
 
 	}
 
+	//! Return the alpha of a cell of an alpha map
+	static inline Uint8 alphaMapValue(float value) { return (Uint8)(255.0f * value); }
+	static inline Uint8 alphaMapValue(unsigned char value) { return value; }
+
+	//! Software drawing of an alpha map, cells are expanded to a row of alphas which is blended for each line of the cells
+	template<typename T>
+	static void drawAlphaMapSoftware(SDL_Surface *surface, const SDL_Rect &clipRect, const std::valarray<T> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
+	{
+		// the last row and column of the map are not drawn
+		int x0 = std::max(x, static_cast<int>(clipRect.x));
+		int y0 = std::max(y, static_cast<int>(clipRect.y));
+		int x1 = std::min(x + (mapW - 1) * cellW, clipRect.x + clipRect.w);
+		int y1 = std::min(y + (mapH - 1) * cellH, clipRect.y + clipRect.h);
+		if ((x0 >= x1) || (y0 >= y1))
+			return;
+
+		const BlitKernels *kernels = BlitKernels::best();
+		Uint32 colorValue = color.applyAlpha(Color::ALPHA_OPAQUE).pack();
+		std::valarray<Uint8> alphas(x1 - x0);
+		int lastCellY = -1;
+		for (int dy = y0; dy < y1; dy++)
+		{
+			int cellY = (dy - y) / cellH;
+			if (cellY != lastCellY)
+			{
+				for (int dx = x0; dx < x1; dx++)
+					alphas[dx - x0] = alphaMapValue(map[mapW * cellY + (dx - x) / cellW]);
+				lastCellY = cellY;
+			}
+			// opaque cells are filled as drawFilledRect does, the others are blended
+			Uint32 *mem = ((Uint32 *)surface->pixels) + dy*(surface->pitch>>2) + x0;
+			int w = x1 - x0;
+			for (int i = 0; i < w;)
+			{
+				int j = i;
+				if (alphas[i] == Color::ALPHA_OPAQUE)
+				{
+					while ((j < w) && (alphas[j] == Color::ALPHA_OPAQUE))
+						mem[j++] = colorValue;
+				}
+				else
+				{
+					while ((j < w) && (alphas[j] != Color::ALPHA_OPAQUE))
+						j++;
+					kernels->blendColorAlphaRow(mem + i, &alphas[i], j - i, colorValue);
+				}
+				i = j;
+			}
+		}
+	}
+
 	void DrawableSurface::drawAlphaMap(const std::valarray<float> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
 	{
 		assert(mapW * mapH <= static_cast<int>(map.size()));
+		if (recorder)
+		{
+			recorder->recordAlphaMap(this, map, mapW, mapH, x, y, cellW, cellH, color);
+			return;
+		}
 
-		for (int dy=0; dy < mapH-1; dy++)
-			for (int dx=0; dx < mapW-1; dx++)
-				drawFilledRect(x + dx * cellW, y + dy * cellH, cellW, cellH, color.applyMultiplyAlpha((Uint8)(255.0f * map[mapW * dy + dx])));
+		drawAlphaMapSoftware(sdlsurface, clipRect, map, mapW, mapH, x, y, cellW, cellH, color);
+		dirty = true;
 	}
 
 	void DrawableSurface::drawAlphaMap(const std::valarray<unsigned char> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
 	{
 		assert(mapW * mapH <= static_cast<int>(map.size()));
+		if (recorder)
+		{
+			recorder->recordAlphaMap(this, map, mapW, mapH, x, y, cellW, cellH, color);
+			return;
+		}
 
-		for (int dy=0; dy < mapH-1; dy++)
-			for (int dx=0; dx < mapW-1; dx++)
-				drawFilledRect(x + dx * cellW, y + dy * cellH, cellW, cellH, color.applyMultiplyAlpha(map[mapW * dy + dx]));
+		drawAlphaMapSoftware(sdlsurface, clipRect, map, mapW, mapH, x, y, cellW, cellH, color);
+		dirty = true;
 	}
 
 	// compat
@@ -1697,6 +2126,22 @@ namespace GAGCore
 			DrawableSurface::drawSurface(static_cast<int>(x), static_cast<int>(y), static_cast<int>(w), static_cast<int>(h), surface, sx, sy, sw, sh, alpha);
 	}
 
+	bool GraphicContext::drawHueShiftedSurface(float x, float y, float w, float h, DrawableSurface *surface, float hueShift, Uint8 alpha)
+	{
+	#ifdef HAVE_OPENGL
+		if (!hueShader.program)
+			return false;
+
+		hueShader.useProgram(hueShader.program);
+		hueShader.uniform1f(hueShader.hueShiftLocation, hueShift / 60.0f);
+		drawSurface(x, y, w, h, surface, 0, 0, surface->getW(), surface->getH(), alpha);
+		hueShader.useProgram(0);
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
 	void GraphicContext::drawAlphaMap(const std::valarray<float> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
 	{
 	#ifdef HAVE_OPENGL
@@ -2094,7 +2539,10 @@ namespace GAGCore
 
 			#ifdef HAVE_OPENGL
 			if (optionFlags & USEGPU)
+			{
 				glState.checkExtensions();
+				hueShader.init(glState.isTextureSRectangle);
+			}
 			#endif // HAVE_OPENGL
 
 			setClipRect();
@@ -0,0 +1,291 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <ParallelRenderer.h>
+#include <BlitKernels.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <assert.h>
+
+namespace GAGCore
+{
+	//! Bands smaller than this number of lines are not worth a thread
+	static const int MIN_BAND_HEIGHT = 32;
+
+	ParallelRenderer::ParallelRenderer(unsigned bandCount)
+	{
+		if (bandCount == 0)
+			bandCount = boost::thread::hardware_concurrency();
+		this->bandCount = std::max(1u, bandCount);
+		gfx = NULL;
+		alphaMapCount = 0;
+		generation = 0;
+		pendingBands = 0;
+		quitting = false;
+	}
+
+	ParallelRenderer::~ParallelRenderer()
+	{
+		assert(gfx == NULL);
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			quitting = true;
+		}
+		startCondition.notify_all();
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i]->join();
+			delete workers[i];
+		}
+		for (size_t i = 0; i < bands.size(); i++)
+			delete bands[i];
+	}
+
+	void ParallelRenderer::begin(GraphicContext *gfx)
+	{
+		assert(this->gfx == NULL);
+		if ((bandCount <= 1) || (gfx->getOptionFlags() & GraphicContext::USEGPU))
+			return;
+		if (gfx->getH() < 2 * MIN_BAND_HEIGHT)
+			return;
+		// detect the blending kernels now, not concurrently in the workers
+		BlitKernels::best();
+		this->gfx = gfx;
+		gfx->recorder = this;
+	}
+
+	void ParallelRenderer::end(void)
+	{
+		if (!gfx)
+			return;
+		gfx->recorder = NULL;
+
+		if (!commands.empty())
+		{
+			// create band surfaces sharing the pixels of gfx, and the workers drawing them
+			SDL_Surface *screen = gfx->sdlsurface;
+			unsigned activeBands = std::min(bandCount, static_cast<unsigned>(screen->h / MIN_BAND_HEIGHT));
+			for (unsigned i = 0; i < bandCount; i++)
+			{
+				if (i >= bands.size())
+				{
+					DrawableSurface *band = new DrawableSurface();
+					band->texture = 0;
+					bands.push_back(band);
+				}
+				DrawableSurface *band = bands[i];
+				if ((band->sdlsurface == NULL) || (band->sdlsurface->pixels != screen->pixels) || (band->sdlsurface->w != screen->w) || (band->sdlsurface->h != screen->h) || (band->sdlsurface->pitch != screen->pitch))
+				{
+					if (band->sdlsurface)
+						SDL_FreeSurface(band->sdlsurface);
+					band->sdlsurface = SDL_CreateRGBSurfaceFrom(screen->pixels, screen->w, screen->h, 32, screen->pitch, screen->format->Rmask, screen->format->Gmask, screen->format->Bmask, screen->format->Amask);
+				}
+				int top = (screen->h * i) / activeBands;
+				int bottom = (screen->h * (i + 1)) / activeBands;
+				band->clipRect.x = 0;
+				band->clipRect.y = static_cast<Sint16>(top);
+				band->clipRect.w = static_cast<Uint16>(screen->w);
+				band->clipRect.h = static_cast<Uint16>(i < activeBands ? bottom - top : 0);
+			}
+			while (workers.size() + 1 < bandCount)
+				workers.push_back(new boost::thread(boost::bind(&ParallelRenderer::workerLoop, this, static_cast<unsigned>(workers.size() + 1))));
+
+			// draw first band here and the others in the workers
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				pendingBands = bandCount - 1;
+				generation++;
+			}
+			startCondition.notify_all();
+			drawBand(0);
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				while (pendingBands > 0)
+					doneCondition.wait(lock);
+			}
+			gfx->dirty = true;
+		}
+
+		commands.clear();
+		alphaMapCount = 0;
+		gfx = NULL;
+	}
+
+	void ParallelRenderer::workerLoop(unsigned band)
+	{
+		unsigned drawnGeneration = 0;
+		while (true)
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				while ((generation == drawnGeneration) && !quitting)
+					startCondition.wait(lock);
+				if (quitting)
+					return;
+				drawnGeneration = generation;
+			}
+			drawBand(band);
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				pendingBands--;
+				if (pendingBands == 0)
+					doneCondition.notify_one();
+			}
+		}
+	}
+
+	void ParallelRenderer::drawBand(unsigned bandIndex)
+	{
+		DrawableSurface *band = bands[bandIndex];
+		const SDL_Rect bandRect = band->clipRect;
+		if (bandRect.h == 0)
+			return;
+
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			const Command &command = commands[i];
+
+			// clip to the band
+			int top = std::max(command.clipRect.y, bandRect.y);
+			int bottom = std::min(command.clipRect.y + command.clipRect.h, bandRect.y + bandRect.h);
+			if (top >= bottom)
+				continue;
+			band->clipRect.x = command.clipRect.x;
+			band->clipRect.y = static_cast<Sint16>(top);
+			band->clipRect.w = command.clipRect.w;
+			band->clipRect.h = static_cast<Uint16>(bottom - top);
+
+			// draw, band has no recorder so its functions execute directly
+			switch (command.type)
+			{
+				case PIXEL:
+					band->drawPixel(command.x, command.y, command.color);
+					break;
+				case RECT:
+					band->drawRect(command.x, command.y, command.w, command.h, command.color);
+					break;
+				case FILLED_RECT:
+					band->drawFilledRect(command.x, command.y, command.w, command.h, command.color);
+					break;
+				case HORZ_LINE:
+					band->drawHorzLine(command.x, command.y, command.w, command.color);
+					break;
+				case VERT_LINE:
+					band->drawVertLine(command.x, command.y, command.w, command.color);
+					break;
+				case LINE:
+					band->drawLine(command.x, command.y, command.sx, command.sy, command.color);
+					break;
+				case CIRCLE:
+					band->drawCircle(command.x, command.y, command.w, command.color);
+					break;
+				case SURFACE:
+					band->_blendSurface(command.x, command.y, command.surface, command.sx, command.sy, command.sw, command.sh, command.alpha);
+					break;
+				case HUE_MASK:
+					band->_drawHueMask(command.x, command.y, command.mask, command.hueShift, command.alpha);
+					break;
+				case ALPHA_MAP:
+					band->drawAlphaMap(alphaMaps[command.alphaMap], command.w, command.h, command.x, command.y, command.sw, command.sh, command.color);
+					break;
+				default:
+					assert(false);
+			}
+		}
+		band->clipRect = bandRect;
+	}
+
+	void ParallelRenderer::record(DrawableSurface *surface, const Command &command)
+	{
+		commands.push_back(command);
+		commands.back().clipRect = surface->clipRect;
+	}
+
+	void ParallelRenderer::recordPrimitive(DrawableSurface *surface, CommandType type, int x, int y, int w, int h, int sx, int sy, const Color &color)
+	{
+		Command command;
+		command.type = type;
+		command.x = x;
+		command.y = y;
+		command.w = w;
+		command.h = h;
+		command.sx = sx;
+		command.sy = sy;
+		command.color = color;
+		record(surface, command);
+	}
+
+	void ParallelRenderer::recordSurface(DrawableSurface *surface, int x, int y, DrawableSurface *source, int sx, int sy, int sw, int sh, Uint8 alpha)
+	{
+		Command command;
+		command.type = SURFACE;
+		command.x = x;
+		command.y = y;
+		command.surface = source;
+		command.sx = sx;
+		command.sy = sy;
+		command.sw = sw;
+		command.sh = sh;
+		command.alpha = alpha;
+		record(surface, command);
+	}
+
+	void ParallelRenderer::recordHueMask(DrawableSurface *surface, int x, int y, const HueMask *mask, float hueShift, Uint8 alpha)
+	{
+		Command command;
+		command.type = HUE_MASK;
+		command.x = x;
+		command.y = y;
+		command.mask = mask;
+		command.hueShift = hueShift;
+		command.alpha = alpha;
+		record(surface, command);
+	}
+
+	void ParallelRenderer::recordAlphaMap(DrawableSurface *surface, const std::valarray<float> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
+	{
+		std::valarray<unsigned char> converted(map.size());
+		for (size_t i = 0; i < map.size(); i++)
+			converted[i] = (unsigned char)(255.0f * map[i]);
+		recordAlphaMap(surface, converted, mapW, mapH, x, y, cellW, cellH, color);
+	}
+
+	void ParallelRenderer::recordAlphaMap(DrawableSurface *surface, const std::valarray<unsigned char> &map, int mapW, int mapH, int x, int y, int cellW, int cellH, const Color &color)
+	{
+		// reuse the copies of previous frames to avoid allocations
+		if (alphaMapCount >= alphaMaps.size())
+			alphaMaps.resize(alphaMapCount + 1);
+		std::valarray<unsigned char> &copy = alphaMaps[alphaMapCount];
+		if (copy.size() != map.size())
+			copy.resize(map.size());
+		copy = map;
+
+		Command command;
+		command.type = ALPHA_MAP;
+		command.x = x;
+		command.y = y;
+		command.w = mapW;
+		command.h = mapH;
+		command.sw = cellW;
+		command.sh = cellH;
+		command.color = color;
+		command.alphaMap = alphaMapCount++;
+		record(surface, command);
+	}
+}
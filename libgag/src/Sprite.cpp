@@ -32,6 +32,7 @@ namespace GAGCore
 	Sprite::RotatedImage::~RotatedImage()
 	{
 		delete orig;
+		delete mask;
 		for (RotationMap::iterator it = rotationMap.begin(); it != rotationMap.end(); ++it)
 		{
 			delete it->second;
@@ -71,22 +72,23 @@ namespace GAGCore
 		return getFrameCount() > 0;
 	}
 	
+	float Sprite::getHueShift(void)
+	{
+		float baseHue, actHue, lum, sat;
+		Color(51, 255, 153).getHSV(&baseHue, &sat, &lum);
+		actColor.getHSV(&actHue, &sat, &lum);
+		return actHue - baseHue;
+	}
+	
 	DrawableSurface *Sprite::getRotatedSurface(int index)
 	{
 		RotatedImage::RotationMap::const_iterator it = rotated[index]->rotationMap.find(actColor);
 		DrawableSurface *ds;
 		if (it == rotated[index]->rotationMap.end())
 		{
-			// compute hue shift
-			float baseHue, actHue, lum, sat;
-			float hueShift;
-			Color(51, 255, 153).getHSV(&baseHue, &sat, &lum);
-			actColor.getHSV(&actHue, &sat, &lum);
-			hueShift = actHue - baseHue;
-			
 			// rotate image
 			ds = rotated[index]->orig->clone();
-			ds->shiftHSV(hueShift, 0.0f, 0.0f);
+			ds->shiftHSV(getHueShift(), 0.0f, 0.0f);
 			
 			// write back
 			rotated[index]->rotationMap[actColor] = ds;
@@ -98,6 +100,14 @@ namespace GAGCore
 		return ds;
 	}
 	
+	const HueMask *Sprite::getRotatedMask(int index)
+	{
+		RotatedImage *image = rotated[index];
+		if (!image->mask)
+			image->mask = new HueMask(image->orig->sdlsurface);
+		return image->mask;
+	}
+	
 	Sprite::~Sprite()
 	{
 		for (std::vector <DrawableSurface *>::iterator imagesIt = images.begin(); imagesIt != images.end(); ++imagesIt)
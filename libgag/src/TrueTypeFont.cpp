@@ -22,6 +22,7 @@
 #include <SupportFunctions.h>
 #include <FileManager.h>
 #include <assert.h>
+#include <algorithm>
 #include <iostream>
 
 #ifdef HAVE_FRIBIDI 
@@ -30,9 +31,49 @@
 
 using namespace std;
 #define MAX_CACHE_SIZE 128
+#define ATLAS_PAGE_SIZE 512
+#define MAX_ATLAS_PAGES 4
 
 namespace GAGCore
 {
+	//! Decode an UTF-8 string into UCS-2, the same way SDL_ttf does before rendering
+	static void UTF8toUCS2(const char *utf8, std::vector<Uint16> &ucs2)
+	{
+		const Uint8 *p = reinterpret_cast<const Uint8 *>(utf8);
+		while (*p)
+		{
+			Uint16 ch = *p++;
+			int continuationBytes = 0;
+			if (ch >= 0xF0)
+			{
+				// outside of UCS-2, only the low 16 bits are kept
+				ch = 0;
+				continuationBytes = 3;
+			}
+			else if (ch >= 0xE0)
+			{
+				ch &= 0x0F;
+				continuationBytes = 2;
+			}
+			else if (ch >= 0xC0)
+			{
+				ch &= 0x1F;
+				continuationBytes = 1;
+			}
+			for (; continuationBytes > 0; continuationBytes--)
+			{
+				// a truncated sequence, possibly at the end of the string, is replaced and its next byte kept
+				if ((*p & 0xC0) != 0x80)
+				{
+					ch = 0xFFFD;
+					break;
+				}
+				ch = (ch << 6) | (*p++ & 0x3F);
+			}
+			ucs2.push_back(ch);
+		}
+	}
+	
 	TrueTypeFont::TrueTypeFont()
 	{
 		init();
@@ -47,6 +88,11 @@ namespace GAGCore
 	void TrueTypeFont::init(void)
 	{
 		font = NULL;
+		atlasX = 0;
+		atlasY = 0;
+		atlasRowH = 0;
+		atlasPage = 0;
+		pinningSurface = NULL;
 		now = 0;
 		cacheHit = 0;
 		cacheMiss = 0;
@@ -69,9 +115,9 @@ namespace GAGCore
 						cacheHit << " hits (" << static_cast<float>(cacheHit)/cacheTotal << "), " <<
 						cacheMiss << " misses (" << static_cast<float>(cacheMiss)/cacheTotal << ")" << std::endl;
 			}
-			// free cache
-			for (std::map<CacheKey, CacheData>::iterator it = cache.begin(); it != cache.end(); ++it)
-				delete it->second.s;
+			// free atlas
+			for (size_t i = 0; i < atlasPages.size(); i++)
+				delete atlasPages[i];
 			// close font
 			TTF_CloseFont(font);
 		}
@@ -94,37 +140,16 @@ namespace GAGCore
 	
 	int TrueTypeFont::getStringWidth(const std::string string)
 	{
-		DrawableSurface *s = getStringCached(string);
-		int w;
-		if (s)
-		{
-			w = s->getW();
-			cleanupCache();
-		}
-		else
-			w = 0;
+		TextLayout *layout = getLayoutCached(string);
+		int w = layout->width;
+		cleanupCache();
 		return w;
 	}
 	
 	int TrueTypeFont::getStringHeight(const std::string string)
 	{
-		int h;
-		if (!string.empty())
-		{
-			DrawableSurface *s = getStringCached(string);
-			if (s)
-			{
-				h = s->getH();
-				cleanupCache();
-			}
-			else
-				h = 0;
-		}
-		else
-		{
-			h = TTF_FontHeight(font);
-		}
-		return h;
+		// all glyphs are positioned within the font height
+		return TTF_FontHeight(font);
 	}
 	
 	void TrueTypeFont::setStyle(Style style)
@@ -141,7 +166,8 @@ namespace GAGCore
 		assert(font);
 		
 		styleStack.push(style);
-		TTF_SetFontStyle(font, style.shape);
+		// underline is drawn over the whole string, not per glyph
+		TTF_SetFontStyle(font, style.shape & ~STYLE_UNDERLINE);
 	}
 	
 	void TrueTypeFont::popStyle(void)
@@ -151,7 +177,7 @@ namespace GAGCore
 		if (styleStack.size() > 1)
 		{
 			styleStack.pop();
-			TTF_SetFontStyle(font, styleStack.top().shape);
+			TTF_SetFontStyle(font, styleStack.top().shape & ~STYLE_UNDERLINE);
 		}
 	}
 	
@@ -162,7 +188,7 @@ namespace GAGCore
 		return styleStack.top();
 	}
 	
-	DrawableSurface *TrueTypeFont::getStringCached(const std::string text)
+	TrueTypeFont::TextLayout *TrueTypeFont::getLayoutCached(const std::string text)
 	{
 		assert(font);
 		assert(styleStack.size()>0);
@@ -171,54 +197,165 @@ namespace GAGCore
 		key.text = text;
 		key.style = styleStack.top();
 		
-		CacheData data;
-		DrawableSurface *s;
+		TextLayout *layout;
 		
-		std::map<CacheKey, CacheData>::iterator keyIt = cache.find(key);
+		std::map<CacheKey, TextLayout>::iterator keyIt = cache.find(key);
 		if (keyIt == cache.end())
 		{
-			// create bitmap
-			SDL_Color c;
-			c.r = styleStack.top().color.r;
-			c.g = styleStack.top().color.g;
-			c.b = styleStack.top().color.b;
-			c.unused = styleStack.top().color.a;
+			// shape the string
+			keyIt = cache.insert(std::make_pair(key, TextLayout())).first;
+			layout = &keyIt->second;
 #ifdef HAVE_FRIBIDI 
 			char *bidiStr = getBIDIString(text);
-			SDL_Surface *temp = TTF_RenderUTF8_Blended(font, bidiStr, c);
+			UTF8toUCS2(bidiStr, layout->chars);
 			delete []bidiStr;
 #else		
-			SDL_Surface *temp = TTF_RenderUTF8_Blended(font, text.c_str(), c);
+			UTF8toUCS2(text.c_str(), layout->chars);
 #endif
-			if (temp == NULL)
-				return NULL;
+			int pen = 0;
+			for (size_t i = 0; i < layout->chars.size(); i++)
+			{
+				const Glyph *glyph = getGlyph(layout->chars[i]);
+				if (i > 0)
+					pen += getKerning(layout->chars[i-1], layout->chars[i]);
+				else if (glyph && glyph->minx < 0)
+					pen = -glyph->minx; // like SDL_ttf, do not start left of the string
+				layout->positions.push_back(pen);
+				if (glyph)
+					pen += glyph->advance;
+			}
 			
-			// create key
-			data.lastAccessed = now;
-			data.s = s = new DrawableSurface(temp);
-			assert(s);
-			SDL_FreeSurface(temp);
+			// the width is what SDL_ttf would have rendered
+			std::vector<Uint16> zeroTerminated(layout->chars);
+			zeroTerminated.push_back(0);
+			int h;
+			if (TTF_SizeUNICODE(font, &zeroTerminated[0], &layout->width, &h) < 0)
+				layout->width = pen;
 			
-			// store in cache
-			cache[key] = data;
-			timeCache[now] = cache.find(key);
+			layout->lastAccessed = now;
+			timeCache[now] = keyIt;
 			cacheMiss++;
 		}
 		else
 		{
-			// get surface
-			s = keyIt->second.s;
+			// get layout
+			layout = &keyIt->second;
 			// erase old time association
-			timeCache.erase(keyIt->second.lastAccessed);
+			timeCache.erase(layout->lastAccessed);
 			// set new time
-			keyIt->second.lastAccessed = now;
+			layout->lastAccessed = now;
 			// add new time association
 			timeCache[now] = keyIt;
 			cacheHit++;
 		}
 		now++;
-		return s;
+		return layout;
+	}
+	
+	const TrueTypeFont::Glyph *TrueTypeFont::getGlyph(Uint16 ch)
+	{
+		GlyphKey key;
+		key.ch = ch;
+		key.style = styleStack.top();
+		
+		std::map<GlyphKey, Glyph>::const_iterator glyphIt = glyphs.find(key);
+		if (glyphIt != glyphs.end())
+		{
+			atlasPageLastUsed[glyphIt->second.page] = now;
+			return &glyphIt->second;
+		}
+		
+		// render the glyph
+		Glyph glyph;
+		int maxx, miny;
+		if (TTF_GlyphMetrics(font, ch, &glyph.minx, &maxx, &miny, &glyph.maxy, &glyph.advance) < 0)
+			return NULL;
+		SDL_Color c;
+		c.r = key.style.color.r;
+		c.g = key.style.color.g;
+		c.b = key.style.color.b;
+		c.unused = key.style.color.a;
+		SDL_Surface *temp = TTF_RenderGlyph_Blended(font, ch, c);
+		if (temp == NULL)
+			return NULL;
+		glyph.w = std::min(temp->w, ATLAS_PAGE_SIZE);
+		glyph.h = std::min(temp->h, ATLAS_PAGE_SIZE);
+		
+		// find room in the atlas, row by row, and open a new page when the last one is full
+		if (atlasX + glyph.w > ATLAS_PAGE_SIZE)
+		{
+			atlasX = 0;
+			atlasY += atlasRowH;
+			atlasRowH = 0;
+		}
+		if (atlasPages.empty() || (atlasY + glyph.h > ATLAS_PAGE_SIZE))
+		{
+			// the pages pinned by recorded blits are free again once the recording has been drawn
+			if (pinningSurface && !pinningSurface->isRecording())
+			{
+				std::fill(atlasPagePinned.begin(), atlasPagePinned.end(), false);
+				pinningSurface = NULL;
+			}
+			
+			// every style has its own glyphs, so the atlas is bounded by reusing the least recently used page,
+			// unless it has to be drawn by a recording, in which case the atlas grows for now
+			unsigned leastUsedPage = atlasPages.size();
+			for (unsigned i = 0; i < atlasPages.size(); i++)
+				if (!atlasPagePinned[i] && ((leastUsedPage == atlasPages.size()) || (atlasPageLastUsed[i] < atlasPageLastUsed[leastUsedPage])))
+					leastUsedPage = i;
+			if ((atlasPages.size() < MAX_ATLAS_PAGES) || (leastUsedPage == atlasPages.size()))
+			{
+				atlasPages.push_back(new DrawableSurface(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE));
+				atlasPageLastUsed.push_back(now);
+				atlasPagePinned.push_back(false);
+				atlasPage = atlasPages.size() - 1;
+			}
+			else
+			{
+				atlasPage = leastUsedPage;
+				for (std::map<GlyphKey, Glyph>::iterator it = glyphs.begin(); it != glyphs.end();)
+				{
+					if (it->second.page == atlasPage)
+						glyphs.erase(it++);
+					else
+						++it;
+				}
+			}
+			atlasX = 0;
+			atlasY = 0;
+			atlasRowH = 0;
+		}
+		glyph.page = atlasPage;
+		glyph.sx = atlasX;
+		glyph.sy = atlasY;
+		atlasPages[glyph.page]->copySurface(glyph.sx, glyph.sy, temp);
+		SDL_FreeSurface(temp);
+		atlasX += glyph.w;
+		atlasRowH = std::max(atlasRowH, glyph.h);
+		atlasPageLastUsed[glyph.page] = now;
+		
+		return &(glyphs[key] = glyph);
 	}
+	
+	int TrueTypeFont::getKerning(Uint16 left, Uint16 right)
+	{
+		std::pair<int, Uint32> key(styleStack.top().shape, (static_cast<Uint32>(left) << 16) | right);
+		std::map<std::pair<int, Uint32>, int>::const_iterator kerningIt = kernings.find(key);
+		if (kerningIt != kernings.end())
+			return kerningIt->second;
+		
+		// SDL_ttf does not expose kerning, so measure the pair against the right character alone
+		Uint16 pair[3] = { left, right, 0 };
+		int pairW, rightW, h, advance, minx, maxx, miny, maxy;
+		int kerning = 0;
+		if ((TTF_SizeUNICODE(font, pair, &pairW, &h) == 0) &&
+			(TTF_SizeUNICODE(font, pair + 1, &rightW, &h) == 0) &&
+			(TTF_GlyphMetrics(font, left, &minx, &maxx, &miny, &maxy, &advance) == 0))
+			kerning = pairW - rightW - advance;
+		kernings[key] = kerning;
+		return kerning;
+	}
+	
 #ifdef HAVE_FRIBIDI 
 	char *TrueTypeFont::getBIDIString (const std::string text)
 	{
@@ -245,19 +382,40 @@ namespace GAGCore
 		// when cache is too big, remove the first element
 		if (cache.size() >= MAX_CACHE_SIZE)
 		{
-			delete timeCache.begin()->second->second.s;
 			cache.erase(timeCache.begin()->second);
 			timeCache.erase(timeCache.begin());
 		}
 	}
 	
-	void TrueTypeFont::drawString(DrawableSurface *surface, int x, int y, int w, const std::string text, Uint8 alpha)
+	void TrueTypeFont::drawLayout(DrawableSurface *surface, int x, int y, const std::string &text, Uint8 alpha)
 	{
-		// get
-		DrawableSurface *s = getStringCached(text);
-		if (s == NULL)
-			return;
+		TextLayout *layout = getLayoutCached(text);
+		const int ascent = TTF_FontAscent(font);
+		
+		// draw the string as a batch of atlas quads
+		for (size_t i = 0; i < layout->chars.size(); i++)
+		{
+			const Glyph *glyph = getGlyph(layout->chars[i]);
+			if ((glyph == NULL) || (glyph->w == 0) || (glyph->h == 0))
+				continue;
+			// a recorded blit reads the page when the recording is drawn, the page must not be reused before
+			if (surface->isRecording())
+			{
+				if (pinningSurface != surface)
+					std::fill(atlasPagePinned.begin(), atlasPagePinned.end(), false);
+				pinningSurface = surface;
+				atlasPagePinned[glyph->page] = true;
+			}
+			surface->drawSurface(x + layout->positions[i] + glyph->minx, y + ascent - glyph->maxy, atlasPages[glyph->page], glyph->sx, glyph->sy, glyph->w, glyph->h, alpha);
+		}
 		
+		const Style &style = styleStack.top();
+		if (style.shape & STYLE_UNDERLINE)
+			surface->drawHorzLine(x, y + ascent + 1, layout->width, style.color.applyAlpha((style.color.a * alpha) / 255));
+	}
+	
+	void TrueTypeFont::drawString(DrawableSurface *surface, int x, int y, int w, const std::string text, Uint8 alpha)
+	{
 		// render
 		if (w)
 		{
@@ -265,12 +423,12 @@ namespace GAGCore
 			surface->getClipRect(&rx, &ry, &rw, &rh);
 			int nrw = std::min(rw, x + w - rx);
 			surface->setClipRect(rx, ry, nrw, rh);
-			surface->drawSurface(x, y, s, alpha);
+			drawLayout(surface, x, y, text, alpha);
 			surface->setClipRect(rx, ry, rw, rh);
 			
 		}
 		else
-			surface->drawSurface(x, y, s, alpha);
+			drawLayout(surface, x, y, text, alpha);
 		
 		// cleanup
 		cleanupCache();
@@ -278,11 +436,6 @@ namespace GAGCore
 	
 	void TrueTypeFont::drawString(DrawableSurface *surface, float x, float y, float w, const std::string text, Uint8 alpha)
 	{
-		// get
-		DrawableSurface *s = getStringCached(text);
-		if (s == NULL)
-			return;
-		
 		// render
 		if (w != 0.0f)
 		{
@@ -290,12 +443,12 @@ namespace GAGCore
 			surface->getClipRect(&rx, &ry, &rw, &rh);
 			int nrw = std::min(rw, (int)x + (int)w - rx);
 			surface->setClipRect(rx, ry, nrw, rh);
-			surface->drawSurface(x, y, s, alpha);
+			drawLayout(surface, (int)x, (int)y, text, alpha);
 			surface->setClipRect(rx, ry, rw, rh);
 			
 		}
 		else
-			surface->drawSurface(x, y, s, alpha);
+			drawLayout(surface, (int)x, (int)y, text, alpha);
 		
 		// cleanup
 		cleanupCache();
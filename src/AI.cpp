@@ -23,7 +23,9 @@
 #include "Game.h"
 #include "Order.h"
 #include <assert.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <Stream.h>
+#include <time.h>
 
 #include "StringTable.h"
 
@@ -37,6 +39,20 @@
 
 using namespace boost;
 
+namespace
+{
+	//! Returns the CPU time used by the calling thread, in seconds, or 0 where it can't be measured
+	double getThreadCpuTime()
+	{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+		timespec time;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+			return time.tv_sec + time.tv_nsec / 1000000000.;
+#endif
+		return 0;
+	}
+}
+
 /*AI::AI(Player *player)
 {
 	aiImplementation=new AICastor(player);
@@ -78,6 +94,8 @@ AI::AI(ImplementitionID implementitionID, Player *player)
 	
 	this->implementitionID=implementitionID;
 	this->player=player;
+	computationTime=0;
+	computationCpuTime=0;
 }
 
 AI::AI(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
@@ -85,6 +103,8 @@ AI::AI(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 	aiImplementation=NULL;
 	implementitionID=NONE;
 	this->player=player;
+	computationTime=0;
+	computationCpuTime=0;
 	bool goodLoad=load(stream, versionMinor);
 	assert(goodLoad);
 }
@@ -102,7 +122,38 @@ boost::shared_ptr<Order> AI::getOrder(bool paused)
 	if (paused || !player->team->isAlive)
 		return shared_ptr<Order>(new NullOrder());
 	assert(aiImplementation);
-	return aiImplementation->getOrder();
+	scheduler.beginStep();
+	posix_time::ptime start=posix_time::microsec_clock::universal_time();
+	double cpuStart=getThreadCpuTime();
+	boost::shared_ptr<Order> order=aiImplementation->getOrder();
+	computationCpuTime+=getThreadCpuTime()-cpuStart;
+	Uint32 microseconds=(posix_time::microsec_clock::universal_time()-start).total_microseconds();
+	computationTime+=microseconds/1000000.;
+	scheduler.addTime(microseconds);
+	scheduler.endStep();
+	return order;
+}
+
+bool AI::canPlan(bool paused)
+{
+	assert(player);
+	if (paused || !player->team->isAlive)
+		return false;
+	assert(aiImplementation);
+	return aiImplementation->canPlan();
+}
+
+void AI::plan(void)
+{
+	assert(aiImplementation);
+	scheduler.beginStep();
+	posix_time::ptime start=posix_time::microsec_clock::universal_time();
+	double cpuStart=getThreadCpuTime();
+	aiImplementation->plan();
+	computationCpuTime+=getThreadCpuTime()-cpuStart;
+	Uint32 microseconds=(posix_time::microsec_clock::universal_time()-start).total_microseconds();
+	computationTime+=microseconds/1000000.;
+	scheduler.addTime(microseconds);
 }
 
 bool AI::load(GAGCore::InputStream *stream, Sint32 versionMinor)
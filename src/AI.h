@@ -23,6 +23,7 @@
 #include <SDL_rwops.h>
 
 #include <boost/shared_ptr.hpp>
+#include "AIScheduler.h"
 namespace GAGCore
 {
 	class InputStream;
@@ -77,8 +78,19 @@ public:
 
 	static std::string getAIText(int id);
 
+	///Returns true if plan has to be called before getOrder at this step
+	bool canPlan(bool paused);
+	///Does the planning of the AI, may be called on another thread, see AIImplementation::plan
+	void plan(void);
 	boost::shared_ptr<Order> getOrder(bool paused);
 
+	///Time spent in plan and getOrder, in seconds, for the AI tournaments
+	double computationTime;
+	///CPU time used by plan and getOrder, in seconds, or 0 where it can't be measured
+	double computationCpuTime;
+	///Shares the work of the AI between steps, the implementations reach it through player->ai
+	AIScheduler scheduler;
+
 //	Uint32 step;
 };
 
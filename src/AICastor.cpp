@@ -22,7 +22,9 @@
 #include <Toolkit.h>
 #include <Stream.h>
 
+#include "AI.h"
 #include "AICastor.h"
+#include "BuildingPlacement.h"
 #include "Game.h"
 #include "GlobalContainer.h"
 #include "LogFileManager.h"
@@ -99,13 +101,33 @@ AICastor::Strategy::Strategy()
 	maxAmountGoal=0;
 };
 
+// AICastor::SharedMaps part:
+
+AICastor::SharedMaps::SharedMaps(size_t size)
+{
+	hydratationMap=new Uint8[size];
+	notGrassMap=new Uint8[size];
+	hydratationMapComputed=false;
+	notGrassMapComputed=false;
+	
+	obstacleBuildingMap=new Uint8[size];
+	obstacleBuildingStamp=0;
+	obstacleBuildingUpdates=0;
+}
+
+AICastor::SharedMaps::~SharedMaps()
+{
+	delete[] hydratationMap;
+	delete[] notGrassMap;
+	delete[] obstacleBuildingMap;
+}
+
 // AICastor main class part:
 
 void AICastor::firstInit()
 {
 	obstacleUnitMap=NULL;
 	obstacleBuildingMap=NULL;
-	spaceForBuildingMap=NULL;
 	buildingNeighbourMap=NULL;
 	
 	workPowerMap=NULL;
@@ -126,6 +148,16 @@ void AICastor::firstInit()
 	enemyRangeMap=NULL;
 	
 	ressourcesCluster=NULL;
+	
+	planned=false;
+	booting=false;
+	wheatCareTasks=0;
+	oldWarLevel=-1;
+	oldWarPowerSum=-1;
+	
+	obstacleUnitStamp=0;
+	obstacleUnitUpdates=0;
+	obstacleUnitCanSwim=false;
 }
 
 AICastor::AICastor(Player *player)
@@ -212,13 +244,24 @@ void AICastor::init(Player *player)
 		delete[] obstacleUnitMap;
 	obstacleUnitMap=new Uint8[size];
 	
-	if (obstacleBuildingMap!=NULL)
-		delete[] obstacleBuildingMap;
-	obstacleBuildingMap=new Uint8[size];
+	obstacleUnitStamp=0;
 	
-	if (spaceForBuildingMap!=NULL)
-		delete[] spaceForBuildingMap;
-	spaceForBuildingMap=new Uint8[size];
+	// We share the maps which don't depend on the team with the other AICastor:
+	sharedMaps.reset();
+	for (int i=0; i<game->gameHeader.getNumberOfPlayers() && !sharedMaps; i++)
+	{
+		Player *p=game->players[i];
+		if (p && p!=player && p->ai && p->ai->implementitionID==AI::CASTOR)
+		{
+			AICastor *other=dynamic_cast<AICastor *>(p->ai->aiImplementation);
+			if (other && other->sharedMaps)
+				sharedMaps=other->sharedMaps;
+		}
+	}
+	if (!sharedMaps)
+		sharedMaps.reset(new SharedMaps(size));
+	obstacleBuildingMap=sharedMaps->obstacleBuildingMap;
+	buildingPlacement=BuildingPlacement::get(map);
 	
 	if (buildingNeighbourMap!=NULL)
 		delete[] buildingNeighbourMap;
@@ -237,13 +280,8 @@ void AICastor::init(Player *player)
 		delete[] workAbilityMap;
 	workAbilityMap=new Uint8[size];
 	
-	if (hydratationMap!=NULL)
-		delete[] hydratationMap;
-	hydratationMap=new Uint8[size];
-
-	if (notGrassMap!=NULL)
-		delete[] notGrassMap;
-	notGrassMap=new Uint8[size];
+	hydratationMap=sharedMaps->hydratationMap;
+	notGrassMap=sharedMaps->notGrassMap;
 	
 	if (wheatGrowthMap!=NULL)
 		delete[] wheatGrowthMap;
@@ -289,12 +327,6 @@ AICastor::~AICastor()
 	if (obstacleUnitMap!=NULL)
 		delete[] obstacleUnitMap;
 	
-	if (obstacleBuildingMap!=NULL)
-		delete[] obstacleBuildingMap;
-	
-	if (spaceForBuildingMap!=NULL)
-		delete[] spaceForBuildingMap;
-	
 	if (buildingNeighbourMap!=NULL)
 		delete[] buildingNeighbourMap;
 	
@@ -308,12 +340,6 @@ AICastor::~AICastor()
 	if (workAbilityMap!=NULL)
 		delete[] workAbilityMap;
 	
-	if (hydratationMap!=NULL)
-		delete[] hydratationMap;
-	
-	if (notGrassMap!=NULL)
-		delete[] notGrassMap;
-	
 	if (wheatGrowthMap!=NULL)
 		delete[] wheatGrowthMap;
 	
@@ -380,8 +406,11 @@ void AICastor::save(GAGCore::OutputStream *stream)
 	stream->writeLeaveSection();
 }
 
-boost::shared_ptr<Order>AICastor::getOrder()
+void AICastor::plan()
 {
+	// Only the AI's own maps are computed here, other AICastor may be planning at the same time
+	planned=true;
+	booting=true;
 	timer++;
 	
 	if (!strategy.defined)
@@ -390,9 +419,13 @@ boost::shared_ptr<Order>AICastor::getOrder()
 	if (computeBoot<32)
 	{
 		computeBoot++;
-		return shared_ptr<Order>(new NullOrder());
+		return;
 	}
-	else if (computeBoot<17+32)
+	
+	// The maps are computed one after the other, as many at each step as the budget of the AI allows
+	AIScheduler &scheduler=player->ai->scheduler;
+	Uint32 mapCost=AIScheduler::mapPassCost(map->w, map->h);
+	while (computeBoot<17+32 && scheduler.canRun(mapCost))
 	{
 		switch (computeBoot-32)
 		{
@@ -459,10 +492,17 @@ boost::shared_ptr<Order>AICastor::getOrder()
 			assert(false);
 		}
 		computeBoot++;
-		return shared_ptr<Order>(new NullOrder());
+		scheduler.spend(mapCost);
 	}
+	if (computeBoot<17+32)
+		return;
 	
+	booting=false;
+	
+	// The wheat care map is updated in two tasks, which may run at different steps
 	if ((timer&511)==0)
+		wheatCareTasks=2;
+	if (wheatCareTasks==2 && scheduler.canRun(mapCost))
 	{
 		Uint8 *temp=oldWheatGradient[3];
 		for (int i=3; i>0; i--)
@@ -471,8 +511,24 @@ boost::shared_ptr<Order>AICastor::getOrder()
 		Uint8 *wheatGradient=map->ressourcesGradient[team->teamNumber][CORN][canSwim];
 		memcpy(oldWheatGradient[0], wheatGradient, map->w*map->h);
 		computeObstacleUnitMap();
+		scheduler.spend(mapCost);
+		wheatCareTasks--;
+	}
+	if (wheatCareTasks==1 && scheduler.canRun(mapCost))
+	{
 		computeWheatCareMap();
+		scheduler.spend(mapCost);
+		wheatCareTasks--;
 	}
+}
+
+boost::shared_ptr<Order>AICastor::getOrder()
+{
+	if (!planned)
+		plan();
+	planned=false;
+	if (booting)
+		return shared_ptr<Order>(new NullOrder());
 	
 	/*// Defense, we check it first, because it will only return true if there is an attack and free warriors
 	{
@@ -846,7 +902,6 @@ boost::shared_ptr<Order>AICastor::expandFood()
 	
 	computeCanSwim();
 	computeObstacleBuildingMap();
-	computeSpaceForBuildingMap(bw);
 	computeBuildingNeighbourMap(bw, bh);
 	computeObstacleUnitMap();
 	computeWheatGrowthMap();
@@ -1508,7 +1563,6 @@ boost::shared_ptr<Order>AICastor::continueProject(Project *project)
 		
 		computeCanSwim();
 		computeObstacleBuildingMap();
-		computeSpaceForBuildingMap(bw);
 		computeBuildingNeighbourMap(bw, bh);
 		computeObstacleUnitMap();
 		computeWheatGrowthMap();
@@ -1951,7 +2005,6 @@ void AICastor::computeWarLevel()
 		warAmountTriggerLevel=0;
 	warLevel=warTimeTriggerLevelUse+warLevelTriggerLevel+warAmountTriggerLevel;
 	
-	static int oldWarLevel=-1;
 	if (oldWarLevel!=warLevel)
 	{
 		fprintf(logFile,  "warLevel=%d, warTimeTriggerLevelUse=%d, warLevelTriggerLevel=%d, warAmountTriggerLevel=%d\n",
@@ -1970,7 +2023,6 @@ void AICastor::computeWarLevel()
 		if (u && u->medical==Unit::MED_FREE && u->typeNum==WARRIOR)
 			warPowerSum+=u->performance[ATTACK_SPEED]*u->performance[ATTACK_STRENGTH];
 	}
-	static int oldWarPowerSum=-1;
 	if (oldWarPowerSum!=warPowerSum)
 	{
 		fprintf(logFile,  "warPowerSum=%d\n", warPowerSum);
@@ -1995,100 +2047,125 @@ void AICastor::computeWarLevel()
 	}
 }
 
-void AICastor::computeObstacleUnitMap()
+namespace
 {
-	//printf("computeObstacleUnitMap()...\n");
-	int w=map->w;
-	int h=map->h;
-	//int wMask=map->wMask;
-	//int hMask=map->hMask;
-	size_t size=w*h;
-	Case *cases=map->cases;
-	Uint32 teamMask=team->me;
-	for (size_t i=0; i<size; i++)
+	// The value of obstacleUnitMap for a case
+	struct ObstacleUnitValue
+	{
+		ObstacleUnitValue(Uint32 teamMask, bool canSwim) : teamMask(teamMask), canSwim(canSwim) {}
+		Uint8 operator()(const Case &c) const
+		{
+			if (c.building!=NOGBID)
+				return 0;
+			else if (c.ressource.type!=NO_RES_TYPE)
+				return 0;
+			else if (c.forbidden&teamMask)
+				return 0;
+			else if (!canSwim && (c.terrain>=256) && (c.terrain<256+16)) // !canSwim && isWatter ?
+				return 0;
+			else
+				return 1;
+		}
+		Uint32 teamMask;
+		bool canSwim;
+	};
+	
+	// The value of obstacleBuildingMap for a case
+	struct ObstacleBuildingValue
 	{
-		Case c=cases[i];
-		if (c.building!=NOGBID)
-			obstacleUnitMap[i]=0;
-		else if (c.ressource.type!=NO_RES_TYPE)
-			obstacleUnitMap[i]=0;
-		else if (c.forbidden&teamMask)
-			obstacleUnitMap[i]=0;
-		else if (!canSwim && (c.terrain>=256) && (c.terrain<256+16)) // !canSwim && isWatter ?
-			obstacleUnitMap[i]=0;
-		else
-			obstacleUnitMap[i]=1;
-	}
-	//printf("...computeObstacleUnitMap() done\n");
+		Uint8 operator()(const Case &c) const
+		{
+			if (c.building!=NOGBID)
+				return 0;
+			else  if (c.terrain>=16) // if (!isGrass)
+				return 0;
+			else if (c.ressource.type!=NO_RES_TYPE)
+				return 0;
+			else
+				return 1;
+		}
+	};
 }
 
-
-void AICastor::computeObstacleBuildingMap()
+// Updates a map whose values only depend on the case at the same place. A stamp of 0 means
+// the map was never computed. Otherwise only the blocks of the map whose cases changed since
+// the stamp was taken are recomputed. Every FULL_CHECK_PERIOD updates, the whole map is
+// recomputed, and the differences, from changes that didn't go through the Map mutators, logged.
+template<typename CaseValue>
+void AICastor::updateCaseMap(Uint8 *caseMap, const CaseValue &value, Uint32 &stamp, int &updates, const char *name)
 {
-	//printf("computeObstacleBuildingMap()...\n");
-	int w=map->w;
-	int h=map->h;
-	//int wMask=map->wMask;
-	//int hMask=map->hMask;
-	//int hDec=map->hDec;
-	//int wDec=map->wDec;
-	size_t size=w*h;
+	size_t size=map->w*map->h;
 	Case *cases=map->cases;
-	for (size_t i=0; i<size; i++)
+	
+	Uint32 since=stamp;
 	{
-		Case c=cases[i];
-		if (c.building!=NOGBID)
-			obstacleBuildingMap[i]=0;
-		else  if (c.terrain>=16) // if (!isGrass)
-			obstacleBuildingMap[i]=0;
-		else if (c.ressource.type!=NO_RES_TYPE)
-			obstacleBuildingMap[i]=0;
-		else
-			obstacleBuildingMap[i]=1;
+		boost::mutex::scoped_lock lock(sharedMaps->stampMutex);
+		stamp=map->takeCaseChangeStamp();
 	}
-	//printf("...computeObstacleBuildingMap() done\n");
-}
-
-void AICastor::computeSpaceForBuildingMap(int max)
-{
-	//printf("computeSpaceForBuildingMap()...\n");
-	int w=map->w;
-	int h=map->h;
-	int wMask=map->wMask;
-	int hMask=map->hMask;
-	//int hDec=map->hDec;
-	//int wDec=map->wDec;
-	size_t size=w*h;
 	
-	memcpy(spaceForBuildingMap, obstacleBuildingMap, size);
-	
-	for (int i=1; i<max; i++)
+	if (since==0)
+	{
+		for (size_t i=0; i<size; i++)
+			caseMap[i]=value(cases[i]);
+		updates=0;
+	}
+	else if (++updates>=FULL_CHECK_PERIOD)
 	{
-		for (int y=0; y<h; y++)
+		size_t wrong=0;
+		for (size_t i=0; i<size; i++)
 		{
-			int wy0=w*y;
-			int wy1=w*((y+1)&hMask);
-			
-			for (int x=0; x<w; x++)
+			Uint8 v=value(cases[i]);
+			if (caseMap[i]!=v)
 			{
-				int wyx[4];
-				wyx[0]=wy0+x+0;
-				wyx[1]=wy0+((x+1)&wMask);
-				wyx[2]=wy1+x+0;
-				wyx[3]=wy1+((x+1)&wMask);
-				Uint8 obs[4];
-				for (int i=0; i<4; i++)
-					obs[i]=spaceForBuildingMap[wyx[i]];
-				Uint8 min=255;
-				for (int i=0; i<4; i++)
-					if (min>obs[i])
-						min=obs[i];
-				if (min!=0)
-					spaceForBuildingMap[wyx[0]]=min+1;
+				caseMap[i]=v;
+				wrong++;
 			}
 		}
+		if (wrong)
+			fprintf(logFile, "%s: %d cases were not up to date\n", name, (int)wrong);
+		updates=0;
+	}
+	else
+	{
+		int wDec=map->wDec;
+		const int blockSize=(1<<Map::CHANGE_BLOCK_SHIFT);
+		for (int by=0; by<map->getChangeBlockH(); by++)
+			for (int bx=0; bx<map->getChangeBlockW(); bx++)
+				if (map->hasBlockChangedSince(bx, by, since))
+					for (int y=by*blockSize; y<(by+1)*blockSize; y++)
+					{
+						size_t row=(y<<wDec)+bx*blockSize;
+						for (size_t i=row; i<row+blockSize; i++)
+							caseMap[i]=value(cases[i]);
+					}
+	}
+}
+
+void AICastor::computeObstacleUnitMap()
+{
+	if (obstacleUnitCanSwim!=canSwim)
+	{
+		// Every case may change, we have to recompute it all
+		obstacleUnitStamp=0;
+		obstacleUnitCanSwim=canSwim;
 	}
-	//printf("...computeSpaceForBuildingMap() done\n");
+	updateCaseMap(obstacleUnitMap, ObstacleUnitValue(team->me, canSwim), obstacleUnitStamp, obstacleUnitUpdates, "obstacleUnitMap");
+}
+
+
+void AICastor::computeObstacleBuildingMap()
+{
+	// Shared with the other AICastor, whoever needs it first brings it up to date
+	boost::mutex::scoped_lock lock(sharedMaps->mapsMutex);
+	updateCaseMap(obstacleBuildingMap, ObstacleBuildingValue(), sharedMaps->obstacleBuildingStamp, sharedMaps->obstacleBuildingUpdates, "obstacleBuildingMap");
+}
+
+void AICastor::copyObstacleBuildingMap(Uint8 *dest)
+{
+	// Another AICastor may be updating it in plan(), so we bring it up to date and copy it at once
+	boost::mutex::scoped_lock lock(sharedMaps->mapsMutex);
+	updateCaseMap(obstacleBuildingMap, ObstacleBuildingValue(), sharedMaps->obstacleBuildingStamp, sharedMaps->obstacleBuildingUpdates, "obstacleBuildingMap");
+	memcpy(dest, obstacleBuildingMap, map->w*map->h);
 }
 
 void AICastor::computeBuildingNeighbourMapOfBuilding(int bx, int by, int bw, int bh, int dw, int dh)
@@ -2425,6 +2502,11 @@ void AICastor::computeWorkAbilityMap()
 
 void AICastor::computeHydratationMap()
 {
+	// Shared with the other AICastor, and the terrain doesn't change during a game
+	boost::mutex::scoped_lock lock(sharedMaps->mapsMutex);
+	if (sharedMaps->hydratationMapComputed)
+		return;
+	
 fprintf(logFile,  "computeHydratationMap()...\n");
 	int w=map->w;
 	int h=map->h;
@@ -2476,11 +2558,17 @@ fprintf(logFile,  "computeHydratationMap()...\n");
 			hydratationMap[i]=255;
 	}
 	free(gradient);
+	sharedMaps->hydratationMapComputed=true;
 	fprintf(logFile,  "...computeHydratationMap() done\n");
 }
 
 void AICastor::computeNotGrassMap()
 {
+	// Shared with the other AICastor, and the terrain doesn't change during a game
+	boost::mutex::scoped_lock lock(sharedMaps->mapsMutex);
+	if (sharedMaps->notGrassMapComputed)
+		return;
+	
 	fprintf(logFile,  "computeNotGrassMap()...\n");
 	int w=map->w;
 	int h=map->h;
@@ -2499,6 +2587,7 @@ void AICastor::computeNotGrassMap()
 	}
 	
 	updateGlobalGradientNoObstacle(notGrassMap);
+	sharedMaps->notGrassMapComputed=true;
 	fprintf(logFile,  "...computeNotGrassMap() done\n");
 }
 
@@ -2548,7 +2637,7 @@ void AICastor::computeWheatGrowthMap()
 	size_t size=w*h;
 	Uint8 *wheatGradient=map->ressourcesGradient[team->teamNumber][CORN][canSwim];
 	
-	memcpy(wheatGrowthMap, obstacleBuildingMap, size);
+	copyObstacleBuildingMap(wheatGrowthMap);
 	
 	for (size_t i=0; i<size; i++)
 		if (wheatGradient[i]==255)
@@ -2793,6 +2882,7 @@ boost::shared_ptr<Order>AICastor::findGoodBuilding(Sint32 typeNum, bool food, bo
 	
 	Uint8 *wheatGradientMap=map->ressourcesGradient[team->teamNumber][CORN][canSwim];
 	memset(goodBuildingMap, 0, size);
+	buildingPlacement->update(game->stepCounter);
 	
 	for (int y=0; y<h; y++)
 		for (int x=0; x<w; x++)
@@ -2810,8 +2900,7 @@ boost::shared_ptr<Order>AICastor::findGoodBuilding(Sint32 typeNum, bool food, bo
 				continue;
 			//goodBuildingMap[corner0]=1;
 			
-			Uint8 space=spaceForBuildingMap[corner0];
-			if (space<bw)
+			if (!buildingPlacement->isHardSpace(x, y, bw, bw))
 				continue;
 			//goodBuildingMap[corner0]=2;
 			
@@ -27,6 +27,7 @@
 #include "AIImplementation.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 class Case;
 class Game;
@@ -35,6 +36,7 @@ class Order;
 class Player;
 class Team;
 class Building;
+class BuildingPlacement;
 
 class AICastor : public AIImplementation
 {
@@ -117,6 +119,27 @@ public:
 		Sint32 maxAmountGoal;
 	};
 	
+	///The maps that don't depend on the team, shared by all the AICastor of a game
+	class SharedMaps
+	{
+	public:
+		explicit SharedMaps(size_t size);
+		~SharedMaps();
+		
+		// The terrain doesn't change during a game, so these are only computed once:
+		Uint8 *hydratationMap;
+		Uint8 *notGrassMap;
+		bool hydratationMapComputed;
+		bool notGrassMapComputed;
+		
+		Uint8 *obstacleBuildingMap;
+		Uint32 obstacleBuildingStamp; // see updateCaseMap()
+		int obstacleBuildingUpdates;
+		
+		boost::mutex mapsMutex; // held while computing the maps, several AICastor may plan() at once
+		boost::mutex stampMutex; // held while taking a stamp from the Map
+	};
+	
 private:
 	void firstInit();
 public:
@@ -133,6 +156,8 @@ public:
 	void save(GAGCore::OutputStream *stream);
 	
 	boost::shared_ptr<Order>getOrder(void);
+	bool canPlan(void) { return true; }
+	void plan(void);
 	
 private:
 	void init(Player *player);
@@ -160,7 +185,7 @@ private:
 	
 	void computeObstacleUnitMap();
 	void computeObstacleBuildingMap();
-	void computeSpaceForBuildingMap(int max);
+	void copyObstacleBuildingMap(Uint8 *dest);
 	void computeBuildingNeighbourMap(int dw, int dh);
 	void computeBuildingNeighbourMapOfBuilding(int bx, int by, int bw, int bh, int dw, int dh);
 	
@@ -180,6 +205,9 @@ private:
 	
 	void computeRessourcesCluster();
 	
+	template<typename CaseValue>
+	void updateCaseMap(Uint8 *caseMap, const CaseValue &value, Uint32 &stamp, int &updates, const char *name);
+	
 public:
 	void updateGlobalGradientNoObstacle(Uint8 *gradient);
 	void updateGlobalGradient(Uint8 *gradient);
@@ -229,17 +257,31 @@ public:
 	
 	int computeBoot;
 	
+private:
+	bool planned; // plan() was called for the next getOrder()
+	bool booting; // the maps are being computed, getOrder() has nothing else to do
+	int wheatCareTasks; // tasks left of the periodic update of the wheat care map
+	int oldWarLevel; // only used for logs
+	int oldWarPowerSum; // only used for logs
+	
+	boost::shared_ptr<SharedMaps> sharedMaps;
+	boost::shared_ptr<BuildingPlacement> buildingPlacement; // where buildings of a given size fit, shared with all the AIs
+	Uint32 obstacleUnitStamp; // see updateCaseMap()
+	int obstacleUnitUpdates;
+	bool obstacleUnitCanSwim; // canSwim when obstacleUnitMap was computed
+	// The maps updated from the changes of the cases are fully recomputed and checked every FULL_CHECK_PERIOD updates:
+	static const int FULL_CHECK_PERIOD=32;
+	
 public:
 	Uint8 *obstacleUnitMap; // where units can go. included in {0, 1}
-	Uint8 *obstacleBuildingMap; // where buildings can be built. included in {0, 1}
-	Uint8 *spaceForBuildingMap; // where building can be built, of size X*X. included in {0, 1, 2}. More iterations can provide arbitrary size.
+	Uint8 *obstacleBuildingMap; // where buildings can be built. included in {0, 1}. In sharedMaps
 	Uint8 *buildingNeighbourMap; // bit 0: bad flag, bits [1, 3]: direct neighbours count, bit 4: zero, bits [5, 7]; far neighbours count.
 	
 	Uint8 *workPowerMap;
 	Uint8 *workRangeMap;
 	Uint8 *workAbilityMap;
-	Uint8 *hydratationMap;
-	Uint8 *notGrassMap;
+	Uint8 *hydratationMap; // in sharedMaps
+	Uint8 *notGrassMap; // in sharedMaps
 	Uint8 *wheatGrowthMap;
 	Uint8 *oldWheatGradient[4];  // [0] is the most recent
 	Uint8 *wheatCareMap[2];
@@ -16,7 +16,10 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#include "AI.h"
 #include "AIEcho.h"
+#include "BinaryStream.h"
+#include "StreamBackend.h"
 #include "Building.h"
 #include <stack>
 #include <queue>
@@ -628,6 +631,8 @@ void Entities::Sand::save(GAGCore::OutputStream *stream)
 GradientInfo::GradientInfo()
 {
 	needs_updated=indeterminate;
+	hash_value=0;
+	hash_valid=false;
 }
 
 
@@ -640,12 +645,14 @@ GradientInfo::~GradientInfo()
 void GradientInfo::add_source(Entities::Entity* source)
 {
 	sources.push_back(boost::shared_ptr<Entities::Entity>(source));
+	hash_valid=false;
 }
 
 
 void GradientInfo::add_obstacle(Entities::Entity* obstacle)
 {
 	obstacles.push_back(boost::shared_ptr<Entities::Entity>(obstacle));
+	hash_valid=false;
 }
 
 
@@ -687,6 +694,23 @@ bool GradientInfo::operator==(const GradientInfo& rhs) const
 
 
 
+Uint32 GradientInfo::hash() const
+{
+	if(!hash_valid)
+	{
+		//The entities are hashed as they are saved, which is the same on every computer
+		HashStreamBackend* backend=new HashStreamBackend;
+		BinaryOutputStream* stream=new BinaryOutputStream(backend);
+		const_cast<GradientInfo*>(this)->save(stream);
+		hash_value=backend->getHash();
+		hash_valid=true;
+		delete stream;
+	}
+	return hash_value;
+}
+
+
+
 bool GradientInfo::needs_updating() const
 {
 	if(needs_updated)
@@ -746,6 +770,7 @@ bool GradientInfo::load(GAGCore::InputStream *stream, Player *player, Sint32 ver
 	stream->readLeaveSection();
 
 	stream->readLeaveSection();
+	hash_valid=false;
 	return true;
 }
 
@@ -828,6 +853,67 @@ Gradient::Gradient(const GradientInfo& gi)
 
 
 void Gradient::recalculate(Map* map)
+{
+	width=map->getW();
+	const int wMask=map->getMaskW();
+	const int hMask=map->getMaskH();
+	const int wShift=map->getShiftW();
+	const int size=map->getW()*map->getH();
+
+	gradient.resize(size);
+
+	//A case is set before it is pushed and never pushed again, so the queue fits in a flat array of the size of the map
+	std::vector<int> positions(size);
+	int head=0;
+	int tail=0;
+
+	//Seeds in the order of the memory, row by row
+	for(int y=0; y<map->getH(); ++y)
+	{
+		const int row=y<<wShift;
+		for(int x=0; x<map->getW(); ++x)
+		{
+			if(gradient_info.match_source(map, x, y))
+			{
+				gradient[row|x]=2;
+				positions[tail++]=row|x;
+			}
+			else if(gradient_info.match_obstacle(map, x, y))
+				gradient[row|x]=1;
+			else
+				gradient[row|x]=0;
+		}
+	}
+
+	//The sizes of the maps are powers of two, so wrapping around is a mask
+	while(head!=tail)
+	{
+		const int p=positions[head++];
+		const int x=p&wMask;
+		const int center=p&~wMask;
+		const int up=(center-(1<<wShift))&(hMask<<wShift);
+		const int down=(center+(1<<wShift))&(hMask<<wShift);
+		const int left=(x-1)&wMask;
+		const int right=(x+1)&wMask;
+		const Sint16 n=gradient[p]+1;
+
+		//Same order as recalculate_reference, the gradient is the same
+		const int neighbours[8]={up|left, up|x, up|right, center|left, center|right, down|left, down|x, down|right};
+		for(int i=0; i<8; ++i)
+		{
+			const int q=neighbours[i];
+			if(gradient[q]==0)
+			{
+				gradient[q]=n;
+				positions[tail++]=q;
+			}
+		}
+	}
+}
+
+
+
+void Gradient::recalculate_reference(Map* map)
 {
 	width=map->getW();
 //	if(gradient==NULL)
@@ -924,6 +1010,45 @@ void Gradient::recalculate(Map* map)
 }
 
 
+bool Gradient::benchmark(Map* map, std::ostream& out)
+{
+	const int iterations=10;
+
+	std::vector<GradientInfo> infos;
+	for(int r=0; r<MAX_RESSOURCES; ++r)
+		infos.push_back(make_gradient_info(new Entities::Ressource(r)));
+	infos.push_back(make_gradient_info(new Entities::AnyRessource));
+	infos.push_back(make_gradient_info(new Entities::Water));
+	infos.push_back(make_gradient_info_obstacle(new Entities::Ressource(WOOD), new Entities::Water));
+
+	bool same=true;
+	Uint32 referenceTime=0;
+	Uint32 time=0;
+	for(unsigned i=0; i<infos.size(); ++i)
+	{
+		Gradient reference(infos[i]);
+		Uint32 start=SDL_GetTicks();
+		for(int n=0; n<iterations; ++n)
+			reference.recalculate_reference(map);
+		referenceTime+=SDL_GetTicks()-start;
+
+		Gradient gradient(infos[i]);
+		start=SDL_GetTicks();
+		for(int n=0; n<iterations; ++n)
+			gradient.recalculate(map);
+		time+=SDL_GetTicks()-start;
+
+		if(gradient.gradient!=reference.gradient)
+		{
+			out<<"gradient "<<i<<" differs from the reference"<<std::endl;
+			same=false;
+		}
+	}
+	out<<infos.size()*iterations<<" gradients of "<<map->getW()<<"x"<<map->getH()<<" computed in "<<time<<" ms, "<<referenceTime<<" ms for the reference"<<std::endl;
+	return same;
+}
+
+
 int Gradient::get_height(int posx, int posy) const
 {
 	return gradient[get_pos(posx, posy)]-2;
@@ -931,28 +1056,39 @@ int Gradient::get_height(int posx, int posy) const
 
 
 
-GradientManager::GradientManager(Map* map) : map(map), cur_update(0), timer(0)
+GradientManager::GradientManager(Map* map) : last_update_step(-1), map(map), cur_update(0), timer(0)
 {
 }
 
 
+int GradientManager::find_gradient(const GradientInfo& gi) const
+{
+	std::pair<std::multimap<Uint32, int>::const_iterator, std::multimap<Uint32, int>::const_iterator> range=gradients_by_hash.equal_range(gi.hash());
+	for(std::multimap<Uint32, int>::const_iterator i=range.first; i!=range.second; ++i)
+	{
+		if(gradients[i->second]->get_gradient_info() == gi)
+			return i->second;
+	}
+	return -1;
+}
+
+
 Gradient& GradientManager::get_gradient(const GradientInfo& gi)
 {
-	for(std::vector<boost::shared_ptr<Gradient> >::iterator i=gradients.begin(); i!=gradients.end(); ++i)
+	int g=find_gradient(gi);
+	if(g!=-1)
 	{
-		if((*i)->get_gradient_info() == gi)
+		if(ticks_since_update[g]>150)
 		{
-			if(ticks_since_update[i-gradients.begin()]>150)
-			{
-				ticks_since_update[i-gradients.begin()]=0;
-				(*i)->recalculate(map);
-			}
-			return **i;
+			ticks_since_update[g]=0;
+			gradients[g]->recalculate(map);
 		}
+		return *gradients[g];
 	}
 
 	//Did not find a matching gradient
 	gradients.push_back(boost::shared_ptr<Gradient>(new Gradient(gi)));
+	gradients_by_hash.insert(std::make_pair(gi.hash(), int(gradients.size()-1)));
 	(*(gradients.end()-1))->recalculate(map);
 	ticks_since_update.push_back(0);
 	return **(gradients.end()-1);
@@ -961,19 +1097,18 @@ Gradient& GradientManager::get_gradient(const GradientInfo& gi)
 
 void GradientManager::queue_gradient(const GradientInfo& gi)
 {
-	for(unsigned i=0; i<gradients.size(); ++i)
+	int g=find_gradient(gi);
+	if(g!=-1)
 	{
-		if(gradients[i]->get_gradient_info() == gi)
+		if(gi.needs_updating())
 		{
-			if(gi.needs_updating())
-			{
-				queuedGradients.push(i);
-			}
-			return;
+			queuedGradients.push(g);
 		}
+		return;
 	}
 	//Did not find a matching gradient
 	gradients.push_back(boost::shared_ptr<Gradient>(new Gradient(gi)));
+	gradients_by_hash.insert(std::make_pair(gi.hash(), int(gradients.size()-1)));
 	ticks_since_update.push_back(200);
 	queuedGradients.push(gradients.size()-1);
 }
@@ -981,16 +1116,14 @@ void GradientManager::queue_gradient(const GradientInfo& gi)
 
 bool GradientManager::is_updated(const GradientInfo& gi)
 {
-	for(std::vector<boost::shared_ptr<Gradient> >::iterator i=gradients.begin(); i!=gradients.end(); ++i)
+	int g=find_gradient(gi);
+	if(g!=-1)
 	{
-		if((*i)->get_gradient_info() == gi)
+		if(ticks_since_update[g]>150 && gradients[g]->get_gradient_info().needs_updating())
 		{
-			if(ticks_since_update[i-gradients.begin()]>150 && (*i)->get_gradient_info().needs_updating())
-			{
-				return false;
-			}
-			return true;
+			return false;
 		}
+		return true;
 	}
 	//If the gradient hasn't been queued to be updated, consider it updated,
 	//and it will be calculated on request
@@ -998,21 +1131,31 @@ bool GradientManager::is_updated(const GradientInfo& gi)
 }
 
 
-void GradientManager::update()
+void GradientManager::update(Uint32 step, AIScheduler& scheduler)
 {
+	//Every AI sharing this manager calls this each step, only the first call does something
+	if(last_update_step==Sint32(step))
+		return;
+	last_update_step=step;
+
 	timer++;
 	std::transform(ticks_since_update.begin(), ticks_since_update.end(), ticks_since_update.begin(), increment);
 
-	if((timer%1)==0 && !queuedGradients.empty())
+	//The queued gradients are recalculated while the budget of the AI allows, at least one per step.
+	//Spreading the distances costs a few passes over the map.
+	const Uint32 cost=AIScheduler::mapPassCost(map->w, map->h, 4);
+	while(!queuedGradients.empty())
 	{
 		int g=queuedGradients.front();
 		if(ticks_since_update[g]>50)
 		{
+			if(!scheduler.canRun(cost))
+				break;
 			gradients[g]->recalculate(map);
 			ticks_since_update[g]=0;
+			scheduler.spend(cost);
 		}
 		queuedGradients.pop();
-		return;
 	}
 }
 
@@ -1464,7 +1607,7 @@ void BuildingOrder::add_condition(Condition* condition)
 
 
 
-position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& manager)
+position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& manager, const BuildingPlacement& placement)
 {
 	position best(0,0);
 	Player* player=echo.player;
@@ -1482,7 +1625,7 @@ position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& man
 	{
 		for(int y=0; y<map->getH(); ++y)
 		{
-			if(!check_flag && !map->isHardSpaceForBuilding(x, y, type->width, type->height))
+			if(!check_flag && !placement.isHardSpace(x, y, type->width, type->height))
 				continue;
 
 			if(check_flag && echo.get_flag_map().get_flag(x, y)!=NOGBID)
@@ -1645,7 +1788,7 @@ void BuildingRegister::initiate()
 		Building* b=player->team->myBuildings[i];
 		if(b!=NULL)
 		{
-			found_buildings[building_id++]=boost::make_tuple(b->posX, b->posY, b->type->shortTypeNum, b->gid, false);
+			found_buildings[building_id++]=boost::make_tuple(b->posX, b->posY, b->type->shortTypeNum, b->gid, false, 0, 0);
 		}
 	}
 }
@@ -1711,7 +1854,7 @@ bool BuildingRegister::load(GAGCore::InputStream *stream, Player *player, Sint32
 			t=true;
 		else
 			t=indeterminate;
-		found_buildings[id]=boost::make_tuple(xpos, ypos, building_type, gid, t);
+		found_buildings[id]=boost::make_tuple(xpos, ypos, building_type, gid, t, 0, 0);
 		stream->readLeaveSection();
 	}
 	stream->readLeaveSection();
@@ -1774,6 +1917,7 @@ void BuildingRegister::save(GAGCore::OutputStream *stream)
 void BuildingRegister::set_upgrading(unsigned int id)
 {
 	found_buildings[id].get<4>()=indeterminate;
+	found_buildings[id].get<5>()=0;
 }
 
 
@@ -1810,7 +1954,7 @@ void BuildingRegister::tick()
 				{
 					echo.get_flag_map().set_flag(i->second.get<0>(), i->second.get<1>(), gbid);
 				}
-				found_buildings[i->first]=boost::make_tuple(i->second.get<0>(), i->second.get<1>(), i->second.get<2>(), gbid, false);
+				found_buildings[i->first]=boost::make_tuple(i->second.get<0>(), i->second.get<1>(), i->second.get<2>(), gbid, false, 0, 0);
 				pending_iterator current=i;
 				++i;
 				pending_buildings.erase(current);
@@ -1865,6 +2009,7 @@ void BuildingRegister::tick()
 				if(b->constructionResultState==::Building::NO_CONSTRUCTION)
 				{
 					i->second.get<4>()=false;
+					i->second.get<5>()=0;
 				}
 			}
 			//False
@@ -1878,6 +2023,7 @@ void BuildingRegister::tick()
 				if(b->constructionResultState!=::Building::NO_CONSTRUCTION)
 				{
 					i->second.get<4>()=true;
+					i->second.get<5>()=0;
 				}
 			}
 		}
@@ -1947,6 +2093,50 @@ BuildingType* BuildingRegister::get_building_type(unsigned int id)
 
 
 
+Uint32 BuildingRegister::get_state(found_iterator building)
+{
+	const Uint32 stamp=player->team->game->stepCounter+1;
+	if(building->second.get<5>()==stamp)
+		return building->second.get<6>();
+
+	Uint32 state=0;
+	const int type=building->second.get<2>();
+	if(type>=0 && type<STATE_TYPE_MASK)
+		state|=type;
+	else
+		state|=STATE_TYPE_MASK;
+	const tribool upgrading=building->second.get<4>();
+	if(upgrading || indeterminate(upgrading))
+		state|=STATE_UPGRADING;
+
+	int level=-1;
+	int upgrade_level=-1;
+	Building* b=player->team->myBuildings[::Building::GIDtoID(building->second.get<3>())];
+	if(b)
+	{
+		level=b->type->level;
+		upgrade_level=b->type->isBuildingSite ? level+1 : level+2;
+		if(b->constructionResultState!=::Building::NO_CONSTRUCTION)
+			state|=STATE_UNDER_CONSTRUCTION;
+		if(b->buildingState==::Building::ALIVE)
+			state|=STATE_ALIVE;
+	}
+	if(level>=0 && level<3)
+		state|=level<<STATE_LEVEL_SHIFT;
+	else
+		state|=STATE_LEVEL_MASK;
+	if(upgrade_level>=0 && upgrade_level<7)
+		state|=upgrade_level<<STATE_UPGRADE_LEVEL_SHIFT;
+	else
+		state|=STATE_UPGRADE_LEVEL_MASK;
+
+	building->second.get<5>()=stamp;
+	building->second.get<6>()=state;
+	return state;
+}
+
+
+
 int BuildingRegister::get_type(unsigned int id)
 {
 	if(found_buildings.find(id)==found_buildings.end())
@@ -2554,6 +2744,16 @@ bool NotUnderConstruction::passes(Echo& echo, int id)
 
 
 
+bool NotUnderConstruction::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	mask=BuildingRegister::STATE_UNDER_CONSTRUCTION | BuildingRegister::STATE_UPGRADING;
+	value=0;
+	negate=false;
+	return true;
+}
+
+
+
 bool NotUnderConstruction::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("NotUnderConstruction");
@@ -2580,6 +2780,16 @@ bool UnderConstruction::passes(Echo& echo, int id)
 
 
 
+bool UnderConstruction::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	mask=BuildingRegister::STATE_UNDER_CONSTRUCTION | BuildingRegister::STATE_ALIVE;
+	value=mask;
+	negate=false;
+	return true;
+}
+
+
+
 bool UnderConstruction::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("UnderConstruction");
@@ -2611,6 +2821,18 @@ bool SpecificBuildingType::passes(Echo& echo, int id)
 	return false;
 }
 
+
+
+bool SpecificBuildingType::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	if(building_type<0 || building_type>=BuildingRegister::STATE_TYPE_MASK)
+		return false;
+	mask=BuildingRegister::STATE_TYPE_MASK;
+	value=building_type;
+	negate=false;
+	return true;
+}
+
 bool SpecificBuildingType::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("SpecificBuildingType");
@@ -2646,6 +2868,18 @@ bool NotSpecificBuildingType::passes(Echo& echo, int id)
 	return false;
 }
 
+
+
+bool NotSpecificBuildingType::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	if(building_type<0 || building_type>=BuildingRegister::STATE_TYPE_MASK)
+		return false;
+	mask=BuildingRegister::STATE_TYPE_MASK;
+	value=building_type;
+	negate=true;
+	return true;
+}
+
 bool NotSpecificBuildingType::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("NotSpecificBuildingType");
@@ -2672,6 +2906,16 @@ bool BeingUpgraded::passes(Echo& echo, int id)
 	return echo.get_building_register().is_building_upgrading(id);
 }
 
+
+
+bool BeingUpgraded::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	mask=BuildingRegister::STATE_UPGRADING;
+	value=mask;
+	negate=false;
+	return true;
+}
+
 bool BeingUpgraded::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("BeingUpgraded");
@@ -2717,6 +2961,18 @@ bool BeingUpgradedTo::passes(Echo& echo, int id)
 }
 
 
+
+bool BeingUpgradedTo::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	if(level<0 || level>=7)
+		return false;
+	mask=BuildingRegister::STATE_UPGRADING | BuildingRegister::STATE_UPGRADE_LEVEL_MASK;
+	value=BuildingRegister::STATE_UPGRADING | (level<<BuildingRegister::STATE_UPGRADE_LEVEL_SHIFT);
+	negate=false;
+	return true;
+}
+
+
 bool BeingUpgradedTo::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("BeingUpgradedTo");
@@ -2753,6 +3009,18 @@ bool BuildingLevel::passes(Echo& echo, int id)
 }
 
 
+
+bool BuildingLevel::compile(Uint32& mask, Uint32& value, bool& negate)
+{
+	if(building_level<1 || building_level>3)
+		return false;
+	mask=BuildingRegister::STATE_LEVEL_MASK;
+	value=(building_level-1)<<BuildingRegister::STATE_LEVEL_SHIFT;
+	negate=false;
+	return true;
+}
+
+
 bool BuildingLevel::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("BuildingLevel");
@@ -2925,6 +3193,63 @@ void RessourceTrackerAge::save(GAGCore::OutputStream *stream)
 
 
 
+CompiledBuildingConditions::CompiledBuildingConditions() : mask(0), value(0), never(false)
+{
+
+}
+
+
+
+void CompiledBuildingConditions::add_condition(BuildingCondition* condition)
+{
+	Uint32 condition_mask=0;
+	Uint32 condition_value=0;
+	bool negate=false;
+	if(!condition->compile(condition_mask, condition_value, negate))
+	{
+		others.push_back(condition);
+	}
+	else if(negate)
+	{
+		excluded.push_back(std::make_pair(condition_mask, condition_value));
+	}
+	else
+	{
+		//Two conditions requiring different values for the same bits can't both pass
+		if((mask & condition_mask & (value ^ condition_value)) != 0)
+			never=true;
+		mask|=condition_mask;
+		value|=condition_value;
+	}
+}
+
+
+
+bool CompiledBuildingConditions::passes(Echo& echo, BuildingRegister::found_iterator building)
+{
+	if(never)
+		return false;
+	if(mask!=0 || !excluded.empty())
+	{
+		const Uint32 state=echo.get_building_register().get_state(building);
+		if((state & mask)!=value)
+			return false;
+		for(std::vector<std::pair<Uint32, Uint32> >::iterator i=excluded.begin(); i!=excluded.end(); ++i)
+		{
+			if((state & i->first)==i->second)
+				return false;
+		}
+	}
+	for(std::vector<BuildingCondition*>::iterator i=others.begin(); i!=others.end(); ++i)
+	{
+		if(!(*i)->passes(echo, building->first))
+			return false;
+	}
+	return true;
+}
+
+
+
 bool ManagementOrder::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("ManagementOrder");
@@ -4186,7 +4511,7 @@ void building_search_iterator::set_to_next()
 	}
 	else
 		position++;
-	for(; position!=search->echo.get_building_register().end() && !search->passes_conditions(position->first); position++)
+	for(; position!=search->echo.get_building_register().end() && !search->passes_conditions(position); position++)
 	{
 	}
 	if(position==search->echo.get_building_register().end())
@@ -4214,6 +4539,7 @@ BuildingSearch::BuildingSearch(Echo& echo) : echo(echo)
 void BuildingSearch::add_condition(Conditions::BuildingCondition* condition)
 {
 	conditions.push_back(boost::shared_ptr<Conditions::BuildingCondition>(condition));
+	compiled_conditions.add_condition(condition);
 }
 
 
@@ -4223,7 +4549,7 @@ int BuildingSearch::count_buildings()
 	int count=0;
 	for(Construction::BuildingRegister::found_iterator i=echo.get_building_register().begin(); i!=echo.get_building_register().end(); ++i)
 	{
-		if(passes_conditions(i->first))
+		if(passes_conditions(i))
 		{
 			count++;
 		}
@@ -4247,14 +4573,9 @@ building_search_iterator BuildingSearch::end()
 
 
 
-bool BuildingSearch::passes_conditions(int b)
+bool BuildingSearch::passes_conditions(Construction::BuildingRegister::found_iterator b)
 {
-	for(std::vector<boost::shared_ptr<Conditions::BuildingCondition> >::iterator i = conditions.begin();  i!=conditions.end(); ++i)
-	{
-		if(!(*i)->passes(echo, b))
-			return false;
-	}
-	return true;
+	return compiled_conditions.passes(echo, b);
 }
 
 
@@ -4560,7 +4881,7 @@ int MapInfo::get_ammount_ressource(int x, int y)
 
 
 
-Echo::Echo(EchoAI* echoai, Player* player) : player(player), echoai(echoai), gm(), br(player, *this), fm(*this), timer(0)
+Echo::Echo(EchoAI* echoai, Player* player) : player(player), echoai(echoai), gm(), placement(BuildingPlacement::get(player->map)), br(player, *this), fm(*this), timer(0)
 {
 	previous_building_id=-1;
 	from_load_timer=0;
@@ -4674,7 +4995,8 @@ void Echo::update_building_orders()
 		{
 			if(!(previous_building_id==-1 || br.is_building_found(previous_building_id) || !br.is_building_pending(previous_building_id)))
 				break;
-			position p=(*i)->find_location(*this, player->map, *gm);
+			placement->update(player->team->game->stepCounter);
+			position p=(*i)->find_location(*this, player->map, *gm, *placement);
 			if(p.x != 0 || p.y != 0)
 			{
 				br.issue_order((*i)->id, p.x, p.y, (*i)->get_building_type());
@@ -5000,27 +5322,25 @@ boost::shared_ptr<Order> Echo::getOrder(void)
 */
 	if(!gm)
 	{
-		gm.reset(new GradientManager(player->map));
-		update_gm=true;
-		for(int x=0; x<player->team->game->gameHeader.getNumberOfPlayers(); ++x)
+		//Use the GradientManager of another Echo AI if there is one, so that all of them share it
+		for(int x=0; x<player->team->game->gameHeader.getNumberOfPlayers() && !gm; ++x)
 		{
 			if(player->team->game->players[x]!=NULL)
 			{
 				if(player->team->game->players[x]->type>=BasePlayer::P_AI)
 				{
 					Echo* other=dynamic_cast<Echo*>(player->team->game->players[x]->ai->aiImplementation);
-					if(other)
+					if(other && other->gm)
 					{
-						if(!other->gm)
-						{
-							other->gm=gm;
-							other->update_gm=false;
-//							std::cout<<"Linked with another AI, number "<<x<<std::endl;
-						}
+						gm=other->gm;
+//						std::cout<<"Linked with another AI, number "<<x<<std::endl;
 					}
 				}
 			}
 		}
+		if(!gm)
+			gm.reset(new GradientManager(player->map));
+		update_gm=true;
 	}
 
 	if(from_load_timer==0)
@@ -5045,8 +5365,7 @@ boost::shared_ptr<Order> Echo::getOrder(void)
 		orders.erase(orders.begin());
 		return order;
 	}
-	if(update_gm)
-		gm->update();
+	gm->update(player->team->game->stepCounter, player->ai->scheduler);
 	br.tick();
 	update_ressource_trackers();
 	update_management_orders();
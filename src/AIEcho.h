@@ -22,6 +22,8 @@
 
 #include "Map.h"
 #include "AIImplementation.h"
+#include "AIScheduler.h"
+#include "BuildingPlacement.h"
 #include "BuildingType.h"
 #include "Player.h"
 #include "TeamStat.h"
@@ -33,8 +35,10 @@
 #include <boost/logic/tribool.hpp>
 
 #include <vector>
+#include <ostream>
 #include <queue>
 #include <iterator>
+#include <map>
 #include <set>
 
 namespace AIEcho
@@ -90,6 +94,7 @@ namespace AIEcho
 		class BuildingLevel;
 		class Upgradable;
 		class TicksPassed;
+		class CompiledBuildingConditions;
 	};
 
 	namespace Management
@@ -355,9 +360,13 @@ namespace AIEcho
 			bool needs_updating() const;
 
 			bool operator==(const GradientInfo& rhs) const;
+			///Returns a hash of the sources and obstacles, equal GradientInfo have equal hashes
+			Uint32 hash() const;
 			std::vector<boost::shared_ptr<Entities::Entity> > sources;
 			std::vector<boost::shared_ptr<Entities::Entity> > obstacles;
 			mutable boost::logic::tribool needs_updated;
+			mutable Uint32 hash_value;
+			mutable bool hash_valid;
 		};
 
 		///Heres a few convience functions for creating a Gradient Info
@@ -379,11 +388,16 @@ namespace AIEcho
 			explicit Gradient(const GradientInfo& gi);
 			///Gets the distance of the provided position from the nearest source
 			int get_height(int posx, int posy) const;
+			///Computes a few common gradients on the map with recalculate and recalculate_reference, prints
+			///how long it took and returns true if both gave the same gradients
+			static bool benchmark(Map* map, std::ostream& out);
 		private:
 			friend class AIEcho::Gradients::GradientManager;
 
 			///Causes the gradient to be updated
 			void recalculate(Map* map);
+			///The straightforward way of updating the gradient, kept to check and measure recalculate
+			void recalculate_reference(Map* map);
 			///Returns the gradient info for comparison
 			const GradientInfo& get_gradient_info() const { return gradient_info; }
 			int width;
@@ -397,6 +411,8 @@ namespace AIEcho
 		///of managing and updating various gradients in the game. It returns a matching gradient when provided a GradientInfo.
 		///This object is shared among all Echo AI's, which means gradients that aren't specific to a particular team (such as most Ressource
 		///gradients) don't have to be recalculated for every Echo AI seperately. This saves allot of cpu time when their are multiple Echo AI's.
+		///Gradients are found by the hash of their GradientInfo, and updated once per game step whichever AI asks for it first, so that
+		///the AI's make the same decisions on every computer of a network game.
 		class GradientManager
 		{
 		public:
@@ -412,9 +428,16 @@ namespace AIEcho
 			bool is_updated(const GradientInfo& gi);
 		private:
 			friend class AIEcho::Echo;
-			void update();
+			///Updates the queued gradients, only once for a given game step, within the budget of the AI of the scheduler
+			void update(Uint32 step, AIScheduler& scheduler);
+			///Returns the index of the gradient matching the GradientInfo, or -1 if there is none
+			int find_gradient(const GradientInfo& gi) const;
 			static int increment(const int x) { return x+1; }
 			std::vector<boost::shared_ptr<Gradient> > gradients;
+			///The indexes of the gradients, by the hash of their GradientInfo
+			std::multimap<Uint32, int> gradients_by_hash;
+			///The step of the last update, or -1
+			Sint32 last_update_step;
 			std::queue<int> queuedGradients;
 			std::vector<int> ticks_since_update;
 			Map* map;
@@ -600,8 +623,8 @@ namespace AIEcho
 			BuildingOrder() {}
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
-			///An internal function used to find the location to place the building
-			position find_location(Echo& echo, Map* map, Gradients::GradientManager& manager);
+			///An internal function used to find the location to place the building, placement must be up to date
+			position find_location(Echo& echo, Map* map, Gradients::GradientManager& manager, const BuildingPlacement& placement);
 			boost::logic::tribool passes_conditions(Echo& echo);
 			///An internal function that has all of the constraints register their respective Gradients with the GradientManager
 			void queue_gradients(Gradients::GradientManager& manager);
@@ -661,6 +684,21 @@ namespace AIEcho
 			int get_assigned(unsigned int id);
 			Building* get_building(unsigned int id);
 			BuildingType* get_building_type(unsigned int id);
+
+			///The bits of the state of a found building returned by get_state. The type is the one of IntBuildingType.h,
+			///the level is the one of the BuildingType, and the upgrade level is the level the building is being upgraded to
+			///if it is upgrading. A value too big for its bits is replaced by all its bits set, which no condition matches.
+			enum BuildingState
+			{
+				STATE_TYPE_MASK=0xFF,
+				STATE_LEVEL_SHIFT=8,
+				STATE_LEVEL_MASK=0x3<<STATE_LEVEL_SHIFT,
+				STATE_UPGRADE_LEVEL_SHIFT=10,
+				STATE_UPGRADE_LEVEL_MASK=0x7<<STATE_UPGRADE_LEVEL_SHIFT,
+				STATE_UNDER_CONSTRUCTION=1<<13,
+				STATE_ALIVE=1<<14,
+				STATE_UPGRADING=1<<15,
+			};
 		private:
 			friend class AIEcho::SearchTools::building_search_iterator;
 			friend class AIEcho::SearchTools::BuildingSearch;
@@ -677,6 +715,7 @@ namespace AIEcho
 			friend class AIEcho::Conditions::Upgradable;
 			friend class AIEcho::Conditions::EnemyBuildingDestroyed;
 			friend class AIEcho::Conditions::TicksPassed;
+			friend class AIEcho::Conditions::CompiledBuildingConditions;
 
 			friend class AIEcho::Management::AssignWorkers;
 			friend class AIEcho::Management::ChangeSwarm;
@@ -709,16 +748,20 @@ namespace AIEcho
 			void tick();
 
 			typedef std::map<int, boost::tuple<int, int, int, int> >::iterator pending_iterator;
-			typedef std::map<int, boost::tuple<int, int, int, int, boost::logic::tribool> >::iterator found_iterator;
+			typedef std::map<int, boost::tuple<int, int, int, int, boost::logic::tribool, Uint32, Uint32> >::iterator found_iterator;
 
 			found_iterator begin() { return found_buildings.begin(); }
 			found_iterator end() { return found_buildings.end(); }
+			///Returns the state of a found building as a set of BuildingState bits. It is computed once per step and kept
+			///with the building, the building can only change between steps, or when its upgrading state changes here.
+			Uint32 get_state(found_iterator building);
 			///The last variables in both of these is simply a "this exists" variable. Its used to combat the fact
 			///that pending_buildings[id] may create a new object, and the system can't tell the difference between it and something
 			///real. So bassically, the last variable is set to true when the object is supposed to be there, false is
-			///the default value if its accidentilly created.
+			///the default value if its accidentilly created. The found buildings also keep the state returned by get_state,
+			///and the step it was computed at plus one, 0 when it has to be computed again.
 			std::map<int, boost::tuple<int, int, int, int> > pending_buildings;
-			std::map<int, boost::tuple<int, int, int, int, boost::logic::tribool> > found_buildings;
+			std::map<int, boost::tuple<int, int, int, int, boost::logic::tribool, Uint32, Uint32> > found_buildings;
 			unsigned int building_id;
 			Player* player;
 			Echo& echo;
@@ -909,8 +952,12 @@ namespace AIEcho
 			friend class AIEcho::Construction::BuildingOrder;
 			friend class AIEcho::SearchTools::BuildingSearch;
 			friend class ParticularBuilding;
+			friend class CompiledBuildingConditions;
 		protected:
 			virtual bool passes(Echo& echo, int id)=0;
+			///Gives the condition as the BuildingRegister::BuildingState bits in mask that have to be equal to value, or different
+			///from it if negate is set. Returns false if the condition depends on anything else, then passes is used instead.
+			virtual bool compile(Uint32& mask, Uint32& value, bool& negate) { return false; }
 			virtual BuildingConditionType get_type()=0;
 			virtual bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)=0;
 			virtual void save(GAGCore::OutputStream *stream)=0;
@@ -924,6 +971,7 @@ namespace AIEcho
 		public:
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -935,6 +983,7 @@ namespace AIEcho
 		public:
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -946,6 +995,7 @@ namespace AIEcho
 		public:
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -960,6 +1010,7 @@ namespace AIEcho
 			explicit BeingUpgradedTo(int level);
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -975,6 +1026,7 @@ namespace AIEcho
 			explicit SpecificBuildingType(int building_type);
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -990,6 +1042,7 @@ namespace AIEcho
 			explicit NotSpecificBuildingType(int building_type);
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -1005,6 +1058,7 @@ namespace AIEcho
 			explicit BuildingLevel(int building_level);
 		protected:
 			bool passes(Echo& echo, int id);
+			bool compile(Uint32& mask, Uint32& value, bool& negate);
 			BuildingConditionType get_type();
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
@@ -1082,6 +1136,28 @@ namespace AIEcho
 		private:
 			int num;
 		};
+
+		///This checks that a building passes all of a list of conditions. The conditions that can be compiled are checked
+		///together, with a few operations on the state the BuildingRegister keeps for the building, before the others are
+		///checked with passes, in the order they were added. This is used when going over all the buildings.
+		class CompiledBuildingConditions
+		{
+		public:
+			CompiledBuildingConditions();
+			///Adds a condition, which is not owned
+			void add_condition(BuildingCondition* condition);
+			bool passes(Echo& echo, Construction::BuildingRegister::found_iterator building);
+		private:
+			///The bits of the state that have to be equal to value for all the compiled conditions to pass
+			Uint32 mask;
+			Uint32 value;
+			///Set when two compiled conditions contradict each other
+			bool never;
+			///The masks and values that the state must not match
+			std::vector<std::pair<Uint32, Uint32> > excluded;
+			///The conditions that could not be compiled
+			std::vector<BuildingCondition*> others;
+		};
 	};
 
 	///This namespace stores anything related to managing you're buildings, flags and areas.
@@ -1493,8 +1569,9 @@ namespace AIEcho
 		private:
 			friend class AIEcho::SearchTools::building_search_iterator;
 			Echo& echo;
-			bool passes_conditions(int b);
+			bool passes_conditions(Construction::BuildingRegister::found_iterator b);
 			std::vector<boost::shared_ptr<Conditions::BuildingCondition> > conditions;
+			Conditions::CompiledBuildingConditions compiled_conditions;
 		};
 
 		///This class is a standard iterator that is used to iterate over teams that qualify as "enemies".
@@ -1673,6 +1750,8 @@ namespace AIEcho
 		std::list<boost::shared_ptr<Order> > orders;
 		boost::shared_ptr<EchoAI> echoai;
 		boost::shared_ptr<Gradients::GradientManager> gm;
+		///Where buildings fit, shared with all the AIs
+		boost::shared_ptr<BuildingPlacement> placement;
 		Construction::BuildingRegister br;
 		Construction::FlagMap fm;
 		std::vector<boost::shared_ptr<Construction::BuildingOrder> > building_orders;
@@ -1685,6 +1764,7 @@ namespace AIEcho
 		///Before the next building is constructed, the previous building must be
 		///found on the BuildingRegister
 		int previous_building_id;
+		///Kept for the save format, the GradientManager now takes care of updating itself once per step
 		bool update_gm;
 		bool is_fruit;
 
@@ -50,6 +50,10 @@ You have to understand how the Order class is used.
 Never use rand(), always syncRand().
 (because the AI need to behave exactly the same on every computer.)
 Be sure to return at least a *NullOrder, not NULL.
+If your AI implements plan(), it runs on its own thread while other AIs plan: it must not
+modify the game, use syncRand() or share data with other AIs.
+Cut long computations in tasks run within the budget of player->ai->scheduler, see AIScheduler.
+The budget counts estimated costs, never decide what to do from the time really spent.
 
 Idea:
 You can access usefull data this way:
@@ -80,6 +84,13 @@ public:
 	virtual void save(GAGCore::OutputStream *stream)=0;
 	
 	virtual boost::shared_ptr<Order> getOrder(void)=0;
+
+	///Returns true if the AI does part of the work of getOrder in plan
+	virtual bool canPlan(void) { return false; }
+	///Does the part of the work of the next getOrder that only reads the game and writes the AI's own data.
+	///It is called at the same time, on several threads, for all the AIs that need an order at this step,
+	///then their getOrder are called one after the other, so every computer gets the same orders.
+	virtual void plan(void) {}
 };
 
 #endif
@@ -0,0 +1,116 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include <boost/bind.hpp>
+
+#include "AI.h"
+#include "AIPlanner.h"
+
+AIPlanner::AIPlanner()
+{
+	nextAI = 0;
+	pendingAIs = 0;
+	quitting = false;
+}
+
+AIPlanner::~AIPlanner()
+{
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		quitting = true;
+	}
+	startCondition.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i]->join();
+		delete workers[i];
+	}
+}
+
+void AIPlanner::plan(const std::vector<AI *> &ais)
+{
+	if (ais.empty())
+		return;
+	if (ais.size() == 1)
+	{
+		ais[0]->plan();
+		return;
+	}
+
+	// the calling thread plans too, so one worker less than AIs is enough
+	while (workers.size() + 1 < ais.size())
+		workers.push_back(new boost::thread(boost::bind(&AIPlanner::workerLoop, this)));
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		this->ais = ais;
+		nextAI = 0;
+		pendingAIs = ais.size();
+	}
+	startCondition.notify_all();
+
+	while (true)
+	{
+		AI *ai;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			ai = takeAI();
+		}
+		if (!ai)
+			break;
+		ai->plan();
+		finishAI();
+	}
+
+	boost::mutex::scoped_lock lock(mutex);
+	while (pendingAIs > 0)
+		doneCondition.wait(lock);
+	this->ais.clear();
+}
+
+void AIPlanner::workerLoop(void)
+{
+	while (true)
+	{
+		AI *ai;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			while (((ai = takeAI()) == NULL) && !quitting)
+				startCondition.wait(lock);
+			if (!ai)
+				return;
+		}
+		ai->plan();
+		finishAI();
+	}
+}
+
+AI *AIPlanner::takeAI(void)
+{
+	if (nextAI >= ais.size())
+		return NULL;
+	return ais[nextAI++];
+}
+
+void AIPlanner::finishAI(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	pendingAIs--;
+	if (pendingAIs == 0)
+		doneCondition.notify_one();
+}
@@ -0,0 +1,68 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef __AIPlanner_h
+#define __AIPlanner_h
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <vector>
+
+class AI;
+
+///Runs AI::plan for several AIs at once, within the step. The worker threads are kept from one
+///step to the next and wait for the AIs to plan; plan() returns once all of them are done, so the
+///game is not modified while they plan and their orders are still taken in the order of the players.
+class AIPlanner
+{
+public:
+	AIPlanner();
+	///Stops the worker threads
+	~AIPlanner();
+
+	///Plans all of ais, on the calling thread and the workers, and returns when they are all done
+	void plan(const std::vector<AI *> &ais);
+
+private:
+	///Main loop of a worker
+	void workerLoop(void);
+	///Returns the next AI to plan, or NULL if they are all taken. mutex must be held
+	AI *takeAI(void);
+	///Marks an AI as planned, and signals doneCondition if it was the last one
+	void finishAI(void);
+
+	///worker threads, planning all AIs but those the calling thread takes
+	std::vector<boost::thread *> workers;
+	///protect ais, nextAI, pendingAIs and quitting
+	boost::mutex mutex;
+	///signaled when there are AIs to plan
+	boost::condition startCondition;
+	///signaled when all AIs are planned
+	boost::condition doneCondition;
+	///the AIs to plan at this step
+	std::vector<AI *> ais;
+	///index in ais of the next AI to plan
+	size_t nextAI;
+	///number of AIs not planned yet
+	size_t pendingAIs;
+	///true when the workers must terminate
+	bool quitting;
+};
+
+#endif
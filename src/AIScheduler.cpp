@@ -0,0 +1,94 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "AIScheduler.h"
+
+AIScheduler::AIScheduler()
+{
+	budget = DEFAULT_BUDGET;
+	stepStarted = false;
+	spent = 0;
+	tasksRun = 0;
+	stepTime = 0;
+	stepCount = 0;
+	overrunCount = 0;
+	maxStepTime = 0;
+}
+
+
+
+void AIScheduler::beginStep(void)
+{
+	if (stepStarted)
+		return;
+	stepStarted = true;
+	spent = 0;
+	tasksRun = 0;
+	stepTime = 0;
+}
+
+
+
+bool AIScheduler::canRun(Uint32 cost) const
+{
+	return tasksRun == 0 || spent + cost <= budget;
+}
+
+
+
+void AIScheduler::spend(Uint32 cost)
+{
+	spent += cost;
+	tasksRun++;
+}
+
+
+
+void AIScheduler::addTime(Uint32 microseconds)
+{
+	stepTime += microseconds;
+}
+
+
+
+void AIScheduler::endStep(void)
+{
+	if (!stepStarted)
+		return;
+	stepStarted = false;
+	stepCount++;
+	if (stepTime > budget)
+		overrunCount++;
+	if (stepTime > maxStepTime)
+		maxStepTime = stepTime;
+}
+
+
+
+Uint32 AIScheduler::mapPassCost(int w, int h, Uint32 weight)
+{
+	return ((Uint32)(w * h) / CASES_PER_MICROSECOND) * weight;
+}
+
+
+
+void AIScheduler::format(std::ostream &out) const
+{
+	out << stepCount << " steps, " << overrunCount << " over the budget of " << budget << " us, longest " << maxStepTime << " us";
+}
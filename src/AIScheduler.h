@@ -0,0 +1,84 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __AIScheduler_h
+#define __AIScheduler_h
+
+#include <ostream>
+#include "Types.h"
+
+///This shares the work of an AI between the steps of the game. At each step the AI gets a budget,
+///and its long computations are cut into tasks of estimated cost. The AI runs the tasks while
+///they fit in the budget, and resumes at the next step where it stopped, so the cost of the AI
+///per step stays even and many AIs slow down their thinking rather than the game.
+///The budget counts the estimated costs of the tasks and not the time really spent, because
+///every computer of a network game must run the same tasks at the same step to get the same
+///orders. The time really spent is measured, and the steps that went over the budget reported.
+class AIScheduler
+{
+public:
+	///The budget of an AI per step, in microseconds, unless it was changed for a local game
+	static const Uint32 DEFAULT_BUDGET = 2000;
+	///Estimated number of cases of the map handled per microsecond by a simple pass over the map
+	static const Uint32 CASES_PER_MICROSECOND = 128;
+
+	AIScheduler();
+
+	///Sets the budget per step, in estimated microseconds
+	void setBudget(Uint32 budget) { this->budget = budget; }
+	Uint32 getBudget(void) const { return budget; }
+
+	///Starts a step of the AI, if it is not started yet
+	void beginStep(void);
+	///Returns true if a task of the given estimated cost fits in what is left of the budget of this step.
+	///The first task of a step always fits, so that tasks costing more than the budget still progress.
+	bool canRun(Uint32 cost) const;
+	///Records that a task of the given estimated cost has been run in this step
+	void spend(Uint32 cost);
+	///Adds time really spent by the AI in this step, in microseconds
+	void addTime(Uint32 microseconds);
+	///Ends the step, counting it as an overrun if the time really spent was over the budget
+	void endStep(void);
+
+	///Returns the estimated cost of weight passes over a map of w*h cases
+	static Uint32 mapPassCost(int w, int h, Uint32 weight=1);
+
+	Uint32 getStepCount(void) const { return stepCount; }
+	Uint32 getOverrunCount(void) const { return overrunCount; }
+	///Returns the longest time really spent in a step, in microseconds
+	Uint32 getMaxStepTime(void) const { return maxStepTime; }
+	///Writes the number of steps, of overruns and the longest step on one line
+	void format(std::ostream &out) const;
+
+private:
+	Uint32 budget;
+	bool stepStarted;
+	///Estimated cost of the tasks run in this step
+	Uint32 spent;
+	///Number of tasks run in this step
+	Uint32 tasksRun;
+	///Time really spent in this step, in microseconds
+	Uint32 stepTime;
+
+	Uint32 stepCount;
+	Uint32 overrunCount;
+	Uint32 maxStepTime;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <FileManager.h>
+#include <Toolkit.h>
+
+#include "AINames.h"
+#include "AITournament.h"
+#include "Engine.h"
+#include "Game.h"
+#include "GlobalContainer.h"
+#include "Player.h"
+#include "Team.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <boost/thread/thread.hpp>
+
+#ifndef WIN32
+#	include <unistd.h>
+#	include <sys/resource.h>
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#endif
+
+AITournament::GameResult::GameResult()
+{
+	ok = false;
+	winner = -1;
+	steps = 0;
+	aiTime[0] = aiTime[1] = 0;
+	aiSteps[0] = aiSteps[1] = 0;
+	overruns[0] = overruns[1] = 0;
+	memory = 0;
+}
+
+
+
+AITournament::AITournament(int gameCount)
+{
+	this->gameCount = gameCount;
+
+	ais.push_back(AI::NUMBI);
+	ais.push_back(AI::CASTOR);
+	ais.push_back(AI::WARRUSH);
+	ais.push_back(AI::REACHTOINFINITY);
+	ais.push_back(AI::NICOWAR);
+	// AIToubib is still experimental and not offered to the players, but it can play the games
+	ais.push_back(AI::TOUBIB);
+	for (size_t a = 0; a < ais.size(); a++)
+		for (size_t b = 0; b < ais.size(); b++)
+			if (a != b)
+				pairings.push_back(std::make_pair((int)a, (int)b));
+}
+
+
+
+bool AITournament::listMaps(void)
+{
+	std::string fullDir = "maps";
+	if (Toolkit::getFileManager()->initDirectoryListing(fullDir.c_str(), "map", false))
+	{
+		std::string fileName;
+		while (!(fileName = (Toolkit::getFileManager()->getNextDirectoryEntry())).empty())
+		{
+			std::string fullFileName = fullDir + DIR_SEPARATOR + fileName;
+			try
+			{
+				if (Engine::loadMapHeader(fullFileName).getNumberOfTeams() >= 2)
+					maps.push_back(fullFileName);
+			}
+			catch (std::ios_base::failure &e)
+			{
+				std::cerr << "AITournament : can't load map " << fullFileName << std::endl;
+			}
+		}
+	}
+	// The directory listing has no order, sort it so that the same games are played on every system
+	std::sort(maps.begin(), maps.end());
+	return !maps.empty();
+}
+
+
+
+std::pair<int, int> AITournament::getPairing(int index) const
+{
+	return pairings[index % pairings.size()];
+}
+
+
+
+const std::string &AITournament::getMap(int index) const
+{
+	return maps[(index / pairings.size()) % maps.size()];
+}
+
+
+
+AITournament::GameResult AITournament::playGame(int index)
+{
+	GameResult result;
+#ifndef WIN32
+	// A forked child starts with the memory of the parent, only count what the game adds to it
+	long startMemory = 0;
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		startMemory = usage.ru_maxrss;
+#endif
+	std::pair<int, int> pairing = getPairing(index);
+	std::vector<AI::ImplementitionID> players;
+	players.push_back(ais[pairing.first]);
+	players.push_back(ais[pairing.second]);
+
+	MapHeader mapHeader;
+	try
+	{
+		mapHeader = Engine::loadMapHeader(getMap(index));
+	}
+	catch (std::ios_base::failure &e)
+	{
+		return result;
+	}
+
+	Engine engine;
+	if (engine.initAIGame(mapHeader, players, index + 1) != Engine::EE_NO_ERROR)
+		return result;
+	engine.run();
+
+	// Player 0 is the local player, the AIs are the next ones
+	Game &game = engine.getGame();
+	Team *teams[2];
+	for (int i = 0; i < 2; i++)
+	{
+		Player *player = game.players[i + 1];
+		assert(player->ai);
+		teams[i] = player->team;
+		result.aiTime[i] = player->ai->computationCpuTime;
+		result.aiSteps[i] = player->ai->scheduler.getStepCount();
+		result.overruns[i] = player->ai->scheduler.getOverrunCount();
+	}
+
+	if (teams[0]->isAlive && !teams[1]->isAlive)
+		result.winner = 0;
+	else if (!teams[0]->isAlive && teams[1]->isAlive)
+		result.winner = 1;
+	else if (game.totalPrestigeReached)
+	{
+		Team *team = game.getTeamWithMostPrestige();
+		if (team == teams[0])
+			result.winner = 0;
+		else if (team == teams[1])
+			result.winner = 1;
+	}
+	result.steps = game.stepCounter;
+
+#ifndef WIN32
+	if (getrusage(RUSAGE_SELF, &usage) == 0 && startMemory > 0)
+		result.memory = usage.ru_maxrss - startMemory;
+#endif
+
+	result.ok = true;
+	return result;
+}
+
+
+
+int AITournament::run(void)
+{
+	if (!listMaps())
+	{
+		std::cerr << "No map with at least two teams found in maps" << std::endl;
+		return 1;
+	}
+
+	globalContainer->automaticEndingGame = true;
+	globalContainer->automaticGameGlobalEndConditions = true;
+	globalContainer->automaticEndingSteps = MAX_STEPS;
+
+	results.resize(gameCount);
+#ifndef WIN32
+	// The game uses global state, so each game is played in its own process, as many at a time as we have cores.
+	// The child sends its result through a pipe
+	unsigned jobs = std::max(1u, boost::thread::hardware_concurrency());
+	std::map<pid_t, std::pair<int, int> > running;
+	int next = 0;
+	while (next < gameCount || !running.empty())
+	{
+		while (next < gameCount && running.size() < jobs)
+		{
+			int fds[2];
+			std::cout << std::flush;
+			bool piped = (pipe(fds) == 0);
+			pid_t pid = piped ? fork() : -1;
+			if (pid == 0)
+			{
+				close(fds[0]);
+				GameResult result = playGame(next);
+				char line[256];
+				int size = snprintf(line, sizeof(line), "%d %d %u %f %f %ld %u %u %u %u\n", (int)result.ok, result.winner, (unsigned)result.steps, result.aiTime[0], result.aiTime[1], result.memory,
+					(unsigned)result.aiSteps[0], (unsigned)result.aiSteps[1], (unsigned)result.overruns[0], (unsigned)result.overruns[1]);
+				if (write(fds[1], line, size) != size)
+					_exit(1);
+				std::cout << std::flush;
+				_exit(0);
+			}
+			else if (pid < 0)
+			{
+				// Can't fork, do it ourselves
+				if (piped)
+				{
+					close(fds[0]);
+					close(fds[1]);
+				}
+				results[next] = playGame(next);
+			}
+			else
+			{
+				close(fds[1]);
+				running[pid] = std::make_pair(next, fds[0]);
+			}
+			next++;
+		}
+
+		if (running.empty())
+			continue;
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0)
+			break;
+		int index = running[pid].first;
+		int fd = running[pid].second;
+		running.erase(pid);
+
+		std::string data;
+		char buffer[256];
+		ssize_t size;
+		while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+			data.append(buffer, size);
+		close(fd);
+
+		GameResult &result = results[index];
+		std::istringstream is(data);
+		int ok = 0;
+		is >> ok >> result.winner >> result.steps >> result.aiTime[0] >> result.aiTime[1] >> result.memory;
+		is >> result.aiSteps[0] >> result.aiSteps[1] >> result.overruns[0] >> result.overruns[1];
+		result.ok = ok && !is.fail() && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (!WIFEXITED(status))
+			std::cout << "game " << index << ": crashed" << std::endl;
+	}
+#else
+	for (int i = 0; i < gameCount; i++)
+		results[i] = playGame(i);
+#endif
+
+	writeReport(std::cout);
+
+	for (int i = 0; i < gameCount; i++)
+		if (!results[i].ok)
+			return 1;
+	return 0;
+}
+
+
+
+void AITournament::writeReport(std::ostream &out) const
+{
+	size_t count = ais.size();
+	std::vector<int> wins(count), draws(count), losses(count), games(count);
+	std::vector<double> aiTime(count), steps(count), memory(count), rating(count, 1500);
+	std::vector<double> aiSteps(count), overruns(count);
+	int failed = 0;
+
+	out << "AI tournament, " << gameCount << " games of at most " << MAX_STEPS << " steps\n";
+	for (int i = 0; i < gameCount; i++)
+	{
+		const GameResult &result = results[i];
+		std::pair<int, int> pairing = getPairing(i);
+		int side[2] = { pairing.first, pairing.second };
+		out << "game " << i << ": " << AINames::getAIText(ais[side[0]]) << " against " << AINames::getAIText(ais[side[1]]) << " on " << getMap(i) << ": ";
+		if (!result.ok)
+		{
+			out << "failed\n";
+			failed++;
+			continue;
+		}
+		if (result.winner >= 0)
+			out << AINames::getAIText(ais[side[result.winner]]) << " won";
+		else
+			out << "draw";
+		out << " after " << result.steps << " steps\n";
+
+		// The ratings are updated game after game, in the order of the games, so that they don't depend on the number of cores
+		double score[2];
+		for (int s = 0; s < 2; s++)
+		{
+			int a = side[s];
+			games[a]++;
+			aiTime[a] += result.aiTime[s];
+			steps[a] += result.steps;
+			memory[a] += result.memory;
+			aiSteps[a] += result.aiSteps[s];
+			overruns[a] += result.overruns[s];
+			if (result.winner < 0)
+			{
+				draws[a]++;
+				score[s] = 0.5;
+			}
+			else if (result.winner == s)
+			{
+				wins[a]++;
+				score[s] = 1;
+			}
+			else
+			{
+				losses[a]++;
+				score[s] = 0;
+			}
+		}
+		const double K = 32;
+		double expected = 1 / (1 + pow(10, (rating[side[1]] - rating[side[0]]) / 400));
+		rating[side[0]] += K * (score[0] - expected);
+		rating[side[1]] += K * (score[1] - (1 - expected));
+	}
+
+	out << "\nAI\tgames\twins\tdraws\tlosses\tCPU ms/step\tover budget\tadded memory (KB)\trating\n";
+	for (size_t a = 0; a < count; a++)
+	{
+		out << AINames::getAIText(ais[a]) << "\t" << games[a] << "\t" << wins[a] << "\t" << draws[a] << "\t" << losses[a] << "\t";
+		if (steps[a] > 0)
+			out << (1000 * aiTime[a] / steps[a]);
+		else
+			out << "-";
+		out << "\t";
+		if (aiSteps[a] > 0)
+			out << (100 * overruns[a] / aiSteps[a]) << "%";
+		else
+			out << "-";
+		out << "\t";
+		if (games[a])
+			out << (long)(memory[a] / games[a]);
+		else
+			out << "-";
+		out << "\t" << (int)floor(rating[a] + 0.5) << "\n";
+	}
+	if (failed)
+		out << failed << " games failed\n";
+	out << std::flush;
+}
@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __AITournament_h
+#define __AITournament_h
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AI.h"
+#include "Types.h"
+
+///This plays games between two AIs without gui, as fast as possible, and rates the AIs.
+///Every AI meets every other AI on both sides, on each map of the maps directory that has
+///at least two teams, in turn. Each game runs in its own process, as many at a time as we
+///have cores, so the time and memory used by each AI can be measured.
+class AITournament
+{
+public:
+	///Games last at most this number of steps, 30 minutes of game time, and are a draw if nobody won
+	static const int MAX_STEPS = 45000;
+
+	explicit AITournament(int gameCount);
+
+	///Plays the games and prints the report. Returns 0 if all the games could be played
+	int run(void);
+
+private:
+	///The outcome of one game
+	struct GameResult
+	{
+		GameResult();
+		///True if the game could be played
+		bool ok;
+		///0 or 1 if the AI on that side won, -1 for a draw
+		int winner;
+		///Number of steps the game lasted
+		Uint32 steps;
+		///CPU time used by the AI of each side to compute its orders, in seconds
+		double aiTime[2];
+		///Number of steps the AI of each side computed, and how many went over its budget
+		Uint32 aiSteps[2];
+		Uint32 overruns[2];
+		///Growth of the peak memory of the process during the game, in KB, 0 if unknown
+		long memory;
+	};
+
+	///Lists the maps with at least two teams, returns false if there is none
+	bool listMaps(void);
+	///Returns the index in ais of the AI playing on side 0 and 1 in game index
+	std::pair<int, int> getPairing(int index) const;
+	///Returns the map of game index
+	const std::string &getMap(int index) const;
+	///Plays game index in this process
+	GameResult playGame(int index);
+	///Writes the report of all the games and the ratings of the AIs
+	void writeReport(std::ostream &out) const;
+
+	int gameCount;
+	///The AIs taking part
+	std::vector<AI::ImplementitionID> ais;
+	///All the ordered pairs of different AIs, as indexes in ais
+	std::vector<std::pair<int, int> > pairings;
+	std::vector<std::string> maps;
+	std::vector<GameResult> results;
+};
+
+#endif
@@ -1551,24 +1551,23 @@ bool Building::subscribeToBringRessourcesStep()
 			}
 		}
 */
-		// Compute the list of candidate units
+		// Compute the list of candidate units, among the ones that were free at the start of the step
+		const WorkerCandidates& candidates=owner->harvestCandidates;
+		const int unitCount=candidates.freeUnits.size();
+		unitsFailingRequirements[UnitNotAvailable] += candidates.busyNotWorkingFor(this);
 		Unit* possibleUnits[Unit::MAX_COUNT];
 		int distances[Unit::MAX_COUNT];
 		int resource[Unit::MAX_COUNT];
 		int teamNumber=owner->teamNumber;
-		for(int n=0; n<Unit::MAX_COUNT; ++n)
+		for(int n=0; n<unitCount; ++n)
 		{
 			possibleUnits[n]=NULL;
 			distances[n] = 0;
 			resource[n] = -1;
-			Unit* unit=owner->myUnits[n];
+			Unit* unit=candidates.freeUnits[n];
 			if(unit)
 			{
-				if(!unit->performance[HARVEST])
-				{
-					continue;
-				}
-				else if(unit->attachedBuilding == this && unit->activity == Unit::ACT_FILLING)
+				if(unit->attachedBuilding == this && unit->activity == Unit::ACT_FILLING)
 				{
 					continue;
 				}
@@ -1676,7 +1675,7 @@ bool Building::subscribeToBringRessourcesStep()
 		int maxLevel = -1;
 		int minValue = INT_MAX;
 		//First: we look only for units with a needed resource:
-		for(int n=0; n<Unit::MAX_COUNT; ++n)
+		for(int n=0; n<unitCount; ++n)
 		{
 			Unit* unit=possibleUnits[n];
 			if(unit==NULL)
@@ -1702,7 +1701,7 @@ bool Building::subscribeToBringRessourcesStep()
 		//Second: we look for an unit who is not carying a ressource:
 		if (choosen==NULL)
 		{
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			for(int n=0; n<unitCount; ++n)
 			{
 				Unit* unit=possibleUnits[n];
 				if(unit==NULL)
@@ -1727,7 +1726,7 @@ bool Building::subscribeToBringRessourcesStep()
 		//Third: we look for an unit who is carrying an unwanted resource:
 		if (choosen==NULL)
 		{
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			for(int n=0; n<unitCount; ++n)
 			{
 				Unit* unit=possibleUnits[n];
 				if(unit==NULL)
@@ -1790,14 +1789,22 @@ bool Building::subscribeForFlagingStep()
 				unitsFailingRequirements[i]=0;
 			}
 
-			//Generate the list of possible units
+			//Generate the list of possible units, among the ones of the type of the flag that were free at the start of the step
+			int unitType=WORKER;
+			if(type->zonable[EXPLORER])
+				unitType=EXPLORER;
+			else if(type->zonable[WARRIOR])
+				unitType=WARRIOR;
+			const WorkerCandidates& candidates=owner->flagCandidates[unitType];
+			const int unitCount=candidates.freeUnits.size();
+			unitsFailingRequirements[UnitNotAvailable] += candidates.busyNotWorkingFor(this);
 			Unit* possibleUnits[Unit::MAX_COUNT];
 			int distances[Unit::MAX_COUNT];
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			for(int n=0; n<unitCount; ++n)
 			{
 				possibleUnits[n]=NULL;
 				distances[n] = 0;
-				Unit* unit=owner->myUnits[n];
+				Unit* unit=candidates.freeUnits[n];
 				if(unit)
 				{
 					if(unit->attachedBuilding == this)
@@ -1875,7 +1882,7 @@ bool Building::subscribeForFlagingStep()
 			*/
 			if (type->zonable[EXPLORER])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(int n=0; n<unitCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -1900,7 +1907,7 @@ bool Building::subscribeForFlagingStep()
 			}
 			else if (type->zonable[WARRIOR])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(int n=0; n<unitCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -1922,7 +1929,7 @@ bool Building::subscribeForFlagingStep()
 			}
 			else if (type->zonable[WORKER])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(int n=0; n<unitCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -2772,6 +2779,7 @@ void Building::integrity()
 Uint32 Building::checkSum(std::vector<Uint32> *checkSumsVector)
 {
 	int cs=0;
+	size_t vectorStart = checkSumsVector ? checkSumsVector->size() : 0;
 
 	cs^=typeNum;
 	if (checkSumsVector)
@@ -2890,5 +2898,10 @@ Uint32 Building::checkSum(std::vector<Uint32> *checkSumsVector)
 	if (checkSumsVector)
 		checkSumsVector->push_back(cs);// [25]
 	
+	// not part of the checksum, it tells which building the values are from
+	if (checkSumsVector)
+		checkSumsVector->push_back(gid);// [26]
+	assert(!checkSumsVector || checkSumsVector->size() == vectorStart+CHECKSUM_VECTOR_SIZE);
+	
 	return cs;
 }
@@ -44,6 +44,10 @@ class Building : public BuildingUtils
 {
 public:
 	static const int MAX_COUNT=1024;
+	//! Number of values checkSum adds to its checkSumsVector
+	static const size_t CHECKSUM_VECTOR_SIZE=26;
+	//! Position of the gid in the values checkSum adds to its checkSumsVector
+	static const size_t CHECKSUM_VECTOR_GID=25;
 	///This is the buildings basic state of existance.
 	enum BuildingState
 	{
@@ -174,10 +178,12 @@ private:bool fullInside(void);
 public:void step(void);
 	///This function subscribes any building that needs ressources carried to it with units.
 	///It is considered greedy, hiring as many units as it needs in order of its preference
+	///The units are taken from the candidates the Team listed for this step in updateAllBuildingTasks
 	///Returns true if a unit was hired
 	bool subscribeToBringRessourcesStep(void);
 	///This function subscribes any flag that needs units for a with units.
 	///It is considered greedy, hiring as many units as it needs in order of its preference
+	///The units are taken from the candidates the Team listed for this step in updateAllBuildingTasks
 	///Returns true if a unit was hired
 	bool subscribeForFlagingStep();
 	/// Subscribes a unit to go inside the building.
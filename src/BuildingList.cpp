@@ -0,0 +1,113 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include <algorithm>
+
+#include "Building.h"
+#include "BuildingList.h"
+#include "Map.h"
+
+BuildingList::BuildingList()
+{
+	wSector=0;
+	hSector=0;
+	maxUnitInside=0;
+	dirty=true;
+}
+
+
+
+void BuildingList::build(Map *map)
+{
+	wSector=map->getSectorW();
+	hSector=map->getSectorH();
+	maxUnitInside=0;
+	sectors.resize(wSector*hSector);
+	for (size_t i=0; i<sectors.size(); i++)
+		sectors[i].clear();
+
+	int rank=0;
+	for (iterator bi=buildings.begin(); bi!=buildings.end(); ++bi, ++rank)
+	{
+		Building *b=*bi;
+		Entry entry;
+		entry.building=b;
+		entry.rank=rank;
+		if (buildings.size()>=MIN_INDEXED_SIZE)
+			sectors[wSector*((b->posY&map->getMaskH())>>4)+((b->posX&map->getMaskW())>>4)].push_back(entry);
+		else
+			sectors[0].push_back(entry);
+		maxUnitInside=std::max(maxUnitInside, b->maxUnitInside);
+	}
+	dirty=false;
+}
+
+
+
+bool BuildingList::getRing(Map *map, int x, int y, int ring, std::vector<Entry> &result, Sint32 *nextDist2)
+{
+	if (dirty)
+		build(map);
+	result.clear();
+
+	if (buildings.size()<MIN_INDEXED_SIZE)
+	{
+		// All the buildings are in sectors[0], no building is further than the half of the map
+		if (ring>0)
+			return false;
+		result=sectors[0];
+		*nextDist2=(map->getW()/2)*(map->getW()/2)+(map->getH()/2)*(map->getH()/2)+1;
+		return true;
+	}
+
+	// The offsets of the sectors from the one of (x, y) go from loX to hiX, so that each sector
+	// is seen once and is at least (|dx|-1)*16+1 cases away on x, going round the map or not
+	int loX=-(wSector-1)/2;
+	int hiX=wSector/2;
+	int loY=-(hSector-1)/2;
+	int hiY=hSector/2;
+	if (ring>std::max(std::max(-loX, hiX), std::max(-loY, hiY)))
+		return false;
+
+	int sx=(x&map->getMaskW())>>4;
+	int sy=(y&map->getMaskH())>>4;
+	for (int dy=std::max(-ring, loY); dy<=std::min(ring, hiY); dy++)
+	{
+		// Inside the ring, only the sectors on its left and right sides
+		bool side=(dy!=-ring && dy!=ring);
+		for (int dx=-ring; dx<=ring; dx+=(side ? 2*ring : 1))
+		{
+			if (dx>=loX && dx<=hiX)
+			{
+				const std::vector<Entry> &sector=sectors[wSector*((sy+dy+hSector)%hSector)+(sx+dx+wSector)%wSector];
+				result.insert(result.end(), sector.begin(), sector.end());
+			}
+		}
+	}
+	*nextDist2=(ring*16+1)*(ring*16+1);
+	return true;
+}
+
+
+
+int BuildingList::getMaxUnitInside(Map *map)
+{
+	if (dirty)
+		build(map);
+	return maxUnitInside;
+}
@@ -0,0 +1,80 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef __BuildingList_h
+#define __BuildingList_h
+
+#include <list>
+#include <vector>
+#include "Types.h"
+
+class Building;
+class Map;
+
+///This is a list of buildings of a team, such as the buildings that can heal units, that can also give
+///the buildings near a position first. The buildings are put in a grid of the 16x16 sectors of the map,
+///the tiling of Map::getSector, when the list changed or a new step started, at the first query.
+///Buildings only move during their own step, when their construction starts or ends.
+class BuildingList
+{
+public:
+	typedef std::list<Building *>::iterator iterator;
+
+	///A building given by getRing, with its position in the list, to find the first one of the list when there is a tie
+	struct Entry
+	{
+		Building *building;
+		int rank;
+	};
+
+	BuildingList();
+
+	void push_front(Building *building) { buildings.push_front(building); dirty=true; }
+	void remove(Building *building) { buildings.remove(building); dirty=true; }
+	void clear(void) { buildings.clear(); dirty=true; }
+	size_t size(void) const { return buildings.size(); }
+	iterator begin(void) { return buildings.begin(); }
+	iterator end(void) { return buildings.end(); }
+
+	///Called at each step, the buildings are put in the grid again at the next query
+	void invalidate(void) { dirty=true; }
+
+	///Puts in result the buildings of the ring-th ring of sectors around the sector of (x, y), the sector
+	///itself being ring 0, and in nextDist2 a lower bound of the warpDistSquare between (x, y) and the
+	///position of any building of the next rings. Returns false if there are no more rings. Short lists
+	///are given all at once in ring 0, as going over them is faster than going over the sectors.
+	bool getRing(Map *map, int x, int y, int ring, std::vector<Entry> &result, Sint32 *nextDist2);
+	///Returns the biggest maxUnitInside of the buildings of the list
+	int getMaxUnitInside(Map *map);
+
+private:
+	///Under this number of buildings, getRing gives all the list at once
+	static const size_t MIN_INDEXED_SIZE=32;
+
+	///Puts the buildings in the grid
+	void build(Map *map);
+
+	std::list<Building *> buildings;
+	///The buildings of each sector, with their position in the list
+	std::vector<std::vector<Entry> > sectors;
+	int wSector, hSector;
+	int maxUnitInside;
+	bool dirty;
+};
+
+#endif
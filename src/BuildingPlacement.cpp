@@ -0,0 +1,140 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "BuildingPlacement.h"
+#include "Map.h"
+
+#include <map>
+#include <boost/weak_ptr.hpp>
+
+boost::shared_ptr<BuildingPlacement> BuildingPlacement::get(Map *map)
+{
+	// The AIs hold the placements, so they are freed with the last AI of the game
+	static std::map<Map *, boost::weak_ptr<BuildingPlacement> > placements;
+
+	for (std::map<Map *, boost::weak_ptr<BuildingPlacement> >::iterator i=placements.begin(); i!=placements.end();)
+	{
+		if (i->second.expired())
+			placements.erase(i++);
+		else
+			++i;
+	}
+
+	boost::shared_ptr<BuildingPlacement> placement=placements[map].lock();
+	if (!placement)
+	{
+		placement.reset(new BuildingPlacement(map));
+		placements[map]=placement;
+	}
+	return placement;
+}
+
+
+
+BuildingPlacement::BuildingPlacement(Map *map)
+{
+	// The map may not be loaded yet, its size is taken when the table is built
+	this->map=map;
+	w=0;
+	h=0;
+	lastUpdateStep=-1;
+	lastBuildStep=0;
+	stamp=0;
+}
+
+
+
+void BuildingPlacement::update(Uint32 step)
+{
+	if (lastUpdateStep==Sint32(step))
+		return;
+	lastUpdateStep=step;
+
+	if (stamp==0 || step>=lastBuildStep+FULL_CHECK_PERIOD || hasChanged())
+	{
+		stamp=map->takeCaseChangeStamp();
+		lastBuildStep=step;
+		build();
+	}
+}
+
+
+
+bool BuildingPlacement::hasChanged(void) const
+{
+	for (int by=0; by<map->getChangeBlockH(); by++)
+		for (int bx=0; bx<map->getChangeBlockW(); bx++)
+			if (map->hasBlockChangedSince(bx, by, stamp))
+				return true;
+	return false;
+}
+
+
+
+void BuildingPlacement::build(void)
+{
+	w=map->getW();
+	h=map->getH();
+	const int tw=w+1;
+	table.assign(tw*(h+1), 0);
+	for (int y=0; y<h; y++)
+	{
+		// The count of the row so far, added to the count of the rows above
+		Uint32 rowSum=0;
+		for (int x=0; x<w; x++)
+		{
+			if (!map->isHardSpaceForBuilding(x, y))
+				rowSum++;
+			table[(y+1)*tw+x+1]=table[y*tw+x+1]+rowSum;
+		}
+	}
+}
+
+
+
+Uint32 BuildingPlacement::countObstacles(int x, int y, int w, int h) const
+{
+	assert(w<=this->w && h<=this->h);
+	// The map wraps around, so the rectangle is cut in up to four parts inside the map
+	x&=map->getMaskW();
+	y&=map->getMaskH();
+	int xEnd=x+w;
+	int yEnd=y+h;
+	int xWrap=0;
+	int yWrap=0;
+	if (xEnd>this->w)
+	{
+		xWrap=xEnd-this->w;
+		xEnd=this->w;
+	}
+	if (yEnd>this->h)
+	{
+		yWrap=yEnd-this->h;
+		yEnd=this->h;
+	}
+
+	Uint32 count=sum(x, y, xEnd, yEnd);
+	if (xWrap)
+		count+=sum(0, y, xWrap, yEnd);
+	if (yWrap)
+		count+=sum(x, 0, xEnd, yWrap);
+	if (xWrap && yWrap)
+		count+=sum(0, 0, xWrap, yWrap);
+	return count;
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __BuildingPlacement_h
+#define __BuildingPlacement_h
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Types.h"
+
+class Map;
+
+///This answers the AIs looking for places where a building fits. It keeps a summed-area table of
+///the cases that are not hard space for building, so whether a rectangle is free is known in four
+///lookups instead of a loop over its cases. The table is built again, once for all the AIs, at
+///the first query of a step where cases of the map changed. It is used from getOrder, on the
+///main thread, never from AIImplementation::plan.
+class BuildingPlacement
+{
+public:
+	///Returns the placement of the map, shared by all the AIs playing on it
+	static boost::shared_ptr<BuildingPlacement> get(Map *map);
+
+	explicit BuildingPlacement(Map *map);
+
+	///Brings the table up to date with the map, if it was not already at this step. Call it before the queries of a step.
+	void update(Uint32 step);
+
+	///Returns the number of cases of the w*h rectangle at (x, y) that are not hard space for building
+	Uint32 countObstacles(int x, int y, int w, int h) const;
+	///Returns true if all the cases of the rectangle are hard space for building, as Map::isHardSpaceForBuilding(x, y, w, h)
+	bool isHardSpace(int x, int y, int w, int h) const { return countObstacles(x, y, w, h)==0; }
+
+private:
+	///After this number of steps, the table is built again even if no change was seen, in case a change didn't go through the Map mutators
+	static const Uint32 FULL_CHECK_PERIOD=32;
+
+	///Builds the table from the cases of the map
+	void build(void);
+	///Returns true if a case of the map changed since the stamp
+	bool hasChanged(void) const;
+	///Returns the number of obstacles in [x0, x1)*[y0, y1), which must be inside the map
+	Uint32 sum(int x0, int y0, int x1, int y1) const
+	{
+		const int tw=w+1;
+		return table[y1*tw+x1]-table[y0*tw+x1]-table[y1*tw+x0]+table[y0*tw+x0];
+	}
+
+	Map *map;
+	int w, h;
+	///table[y*(w+1)+x] is the number of obstacles in [0, x)*[0, y)
+	std::vector<Uint32> table;
+	///The step of the last update, or -1
+	Sint32 lastUpdateStep;
+	///The step at which the table was last built
+	Uint32 lastBuildStep;
+	///The stamp taken from the map when the table was last built, 0 if it never was
+	Uint32 stamp;
+};
+
+#endif
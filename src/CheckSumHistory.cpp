@@ -0,0 +1,374 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <FileManager.h>
+#include <FormatableString.h>
+#include <Toolkit.h>
+#include "CheckSumHistory.h"
+#include "Game.h"
+#include "Unit.h"
+#include <iostream>
+#include <map>
+#include <assert.h>
+#include <stdio.h>
+
+CheckSumHistory::CheckSumHistory()
+{
+	steps.resize(STEP_COUNT);
+	nextStep=0;
+	stepCount=0;
+}
+
+
+
+Uint32 CheckSumHistory::record(Game& game)
+{
+	// The vectors of the oldest step are reused, so that their memory is not allocated at every step
+	Step& s=steps[nextStep];
+	s.game.clear();
+	s.buildings.clear();
+	s.units.clear();
+	s.step=game.stepCounter;
+	s.teamCount=game.mapHeader.getNumberOfTeams();
+	s.checkSum=game.checkSum(&s.game, &s.buildings, &s.units);
+
+	nextStep=(nextStep+1)%STEP_COUNT;
+	if (stepCount<STEP_COUNT)
+		stepCount++;
+	return s.checkSum;
+}
+
+
+
+const CheckSumHistory::Step& CheckSumHistory::getStepByIndex(size_t i) const
+{
+	assert(i<stepCount);
+	return steps[(nextStep+STEP_COUNT-stepCount+i)%STEP_COUNT];
+}
+
+
+
+const CheckSumHistory::Step* CheckSumHistory::getStep(Uint32 step) const
+{
+	for (size_t i=0; i<stepCount; i++)
+		if (getStepByIndex(i).step==step)
+			return &getStepByIndex(i);
+	return NULL;
+}
+
+
+
+void CheckSumHistory::dump(const std::string& fileName) const
+{
+	FILE *fp=Toolkit::getFileManager()->openFP(fileName, "w");
+	if (!fp)
+	{
+		std::cerr << "Can't dump checksum history to file " << fileName << std::endl;
+		return;
+	}
+
+	for (size_t i=0; i<stepCount; i++)
+	{
+		const Step& s=getStepByIndex(i);
+		fprintf(fp, "step %u checksum %08x\n", s.step, s.checkSum);
+
+		fprintf(fp, "game");
+		for (size_t j=0; j<s.game.size(); j++)
+			fprintf(fp, " %08x", s.game[j]);
+		fprintf(fp, "\n");
+
+		// The gid is written first, so that the lines of the same unit or building can be matched
+		for (size_t j=0; j+Unit::CHECKSUM_VECTOR_SIZE<=s.units.size(); j+=Unit::CHECKSUM_VECTOR_SIZE)
+		{
+			fprintf(fp, "unit %u", s.units[j+Unit::CHECKSUM_VECTOR_GID]);
+			for (size_t k=0; k<Unit::CHECKSUM_VECTOR_SIZE; k++)
+				fprintf(fp, " %08x", s.units[j+k]);
+			fprintf(fp, "\n");
+		}
+		for (size_t j=0; j+Building::CHECKSUM_VECTOR_SIZE<=s.buildings.size(); j+=Building::CHECKSUM_VECTOR_SIZE)
+		{
+			fprintf(fp, "building %u", s.buildings[j+Building::CHECKSUM_VECTOR_GID]);
+			for (size_t k=0; k<Building::CHECKSUM_VECTOR_SIZE; k++)
+				fprintf(fp, " %08x", s.buildings[j+k]);
+			fprintf(fp, "\n");
+		}
+	}
+
+	fclose(fp);
+	std::cerr << "Dumped checksum history to file " << fileName << std::endl;
+}
+
+
+
+std::vector<Uint32> CheckSumHistory::getSummary() const
+{
+	// Take the most recent steps that fit in a message, and send them from the oldest
+	size_t first=stepCount;
+	size_t size=1;
+	while (first>0)
+	{
+		size_t stepSize=3+getStepByIndex(first-1).game.size();
+		if (size+stepSize>MAX_MESSAGE_VALUES)
+			break;
+		size+=stepSize;
+		first--;
+	}
+
+	std::vector<Uint32> summary;
+	summary.reserve(size);
+	summary.push_back(stepCount-first);
+	for (size_t i=first; i<stepCount; i++)
+	{
+		const Step& s=getStepByIndex(i);
+		summary.push_back(s.step);
+		summary.push_back(s.checkSum);
+		summary.push_back(s.game.size());
+		summary.insert(summary.end(), s.game.begin(), s.game.end());
+	}
+	return summary;
+}
+
+
+
+bool CheckSumHistory::readSummary(const std::vector<Uint32>& summary, std::vector<SummaryStep>& summarySteps)
+{
+	summarySteps.clear();
+	if (summary.empty())
+		return false;
+	size_t pos=1;
+	for (Uint32 i=0; i<summary[0]; i++)
+	{
+		if (pos+3>summary.size())
+			return false;
+		SummaryStep s;
+		s.step=summary[pos];
+		s.checkSum=summary[pos+1];
+		Uint32 gameSize=summary[pos+2];
+		pos+=3;
+		if (pos+gameSize>summary.size())
+			return false;
+		s.game.assign(summary.begin()+pos, summary.begin()+pos+gameSize);
+		pos+=gameSize;
+		summarySteps.push_back(s);
+	}
+	return true;
+}
+
+
+
+Sint32 CheckSumHistory::findDivergence(const std::vector<Uint32>& summary, Sint32* team) const
+{
+	*team=-1;
+	std::vector<SummaryStep> summarySteps;
+	if (!readSummary(summary, summarySteps))
+		return -1;
+
+	for (size_t i=0; i<summarySteps.size(); i++)
+	{
+		const Step* s=getStep(summarySteps[i].step);
+		if (!s || s->checkSum==summarySteps[i].checkSum)
+			continue;
+
+		const std::vector<Uint32>& remote=summarySteps[i].game;
+		for (size_t k=0; k<s->game.size() && k<remote.size(); k++)
+		{
+			if (s->game[k]!=remote[k])
+			{
+				if (k>=1 && k<1+s->teamCount*Team::CHECKSUM_VECTOR_SIZE)
+					*team=(k-1)/Team::CHECKSUM_VECTOR_SIZE;
+				break;
+			}
+		}
+		return s->step;
+	}
+	return -1;
+}
+
+
+
+std::vector<Uint32> CheckSumHistory::getDetails(Uint32 step, Sint32 team) const
+{
+	std::vector<Uint32> details;
+	details.push_back(step);
+	details.push_back(team);
+
+	const Step* s=getStep(step);
+	// Each half of the message holds as many records as fits in it
+	size_t maxUnitValues=((MAX_MESSAGE_VALUES/2)/Unit::CHECKSUM_VECTOR_SIZE)*Unit::CHECKSUM_VECTOR_SIZE;
+	size_t maxBuildingValues=((MAX_MESSAGE_VALUES/2)/Building::CHECKSUM_VECTOR_SIZE)*Building::CHECKSUM_VECTOR_SIZE;
+
+	size_t unitCountPos=details.size();
+	details.push_back(0);
+	if (s)
+	{
+		for (size_t j=0; j+Unit::CHECKSUM_VECTOR_SIZE<=s->units.size() && details[unitCountPos]<maxUnitValues; j+=Unit::CHECKSUM_VECTOR_SIZE)
+		{
+			if (team>=0 && Unit::GIDtoTeam(s->units[j+Unit::CHECKSUM_VECTOR_GID])!=team)
+				continue;
+			details.insert(details.end(), s->units.begin()+j, s->units.begin()+j+Unit::CHECKSUM_VECTOR_SIZE);
+			details[unitCountPos]+=Unit::CHECKSUM_VECTOR_SIZE;
+		}
+	}
+
+	size_t buildingCountPos=details.size();
+	details.push_back(0);
+	if (s)
+	{
+		for (size_t j=0; j+Building::CHECKSUM_VECTOR_SIZE<=s->buildings.size() && details[buildingCountPos]<maxBuildingValues; j+=Building::CHECKSUM_VECTOR_SIZE)
+		{
+			if (team>=0 && Building::GIDtoTeam(s->buildings[j+Building::CHECKSUM_VECTOR_GID])!=team)
+				continue;
+			details.insert(details.end(), s->buildings.begin()+j, s->buildings.begin()+j+Building::CHECKSUM_VECTOR_SIZE);
+			details[buildingCountPos]+=Building::CHECKSUM_VECTOR_SIZE;
+		}
+	}
+	return details;
+}
+
+
+
+std::string CheckSumHistory::describeGameValue(size_t i, size_t size, Uint32 teamCount)
+{
+	// This follows the order of Game::checkSum and Team::checkSum
+	size_t teamsEnd=1+teamCount*Team::CHECKSUM_VECTOR_SIZE;
+	if (i==0)
+		return "map header";
+	else if (i<teamsEnd)
+	{
+		size_t t=(i-1)/Team::CHECKSUM_VECTOR_SIZE;
+		size_t r=(i-1)%Team::CHECKSUM_VECTOR_SIZE;
+		if (r==0)
+			return FormatableString("team %0").arg(t);
+		else if (r==1)
+			return FormatableString("units of team %0").arg(t);
+		else if (r==2)
+			return FormatableString("buildings of team %0").arg(t);
+		else
+			return FormatableString("team %0, value %1").arg(t).arg(r);
+	}
+	else if (i==teamsEnd)
+		return "all teams";
+	else if (i+2==size)
+		return "map";
+	else if (i+1==size)
+		return "script";
+	else
+		return FormatableString("player %0").arg((i-teamsEnd-1)/2);
+}
+
+
+
+void CheckSumHistory::compareRecords(std::ostream& out, const char* kind, Sint32 team, bool isUnit, const std::vector<Uint32>& local, const Uint32* remote, size_t remoteSize, size_t recordSize, size_t gidPosition)
+{
+	std::map<Uint32, size_t> localRecords;
+	for (size_t j=0; j+recordSize<=local.size(); j+=recordSize)
+	{
+		Uint32 gid=local[j+gidPosition];
+		Sint32 gidTeam=isUnit ? Unit::GIDtoTeam(gid) : Building::GIDtoTeam(gid);
+		if (team<0 || gidTeam==team)
+			localRecords[gid]=j;
+	}
+
+	size_t reported=0;
+	for (size_t j=0; j+recordSize<=remoteSize && reported<MAX_REPORTED_RECORDS; j+=recordSize)
+	{
+		Uint32 gid=remote[j+gidPosition];
+		std::map<Uint32, size_t>::iterator it=localRecords.find(gid);
+		if (it==localRecords.end())
+		{
+			out << "\t" << kind << " " << gid << " only exists on the other side" << std::endl;
+			reported++;
+			continue;
+		}
+		for (size_t k=0; k<recordSize; k++)
+		{
+			if (local[it->second+k]!=remote[j+k])
+			{
+				out << "\t" << kind << " " << gid << ": value [" << k << "] is 0x" << std::hex << local[it->second+k] << " here and 0x" << remote[j+k] << " there" << std::dec << std::endl;
+				reported++;
+				break;
+			}
+		}
+		localRecords.erase(it);
+	}
+
+	// When the other side sent all its records, the remaining ones only exist here
+	bool complete=remoteSize+recordSize<=((MAX_MESSAGE_VALUES/2)/recordSize)*recordSize;
+	for (std::map<Uint32, size_t>::iterator it=localRecords.begin(); complete && it!=localRecords.end() && reported<MAX_REPORTED_RECORDS; ++it)
+	{
+		out << "\t" << kind << " " << it->first << " only exists here" << std::endl;
+		reported++;
+	}
+	if (reported==0)
+		out << "\tno difference in the " << kind << "s" << std::endl;
+}
+
+
+
+void CheckSumHistory::writeReport(std::ostream& out, int player, const std::vector<Uint32>& summary, const std::vector<Uint32>& details) const
+{
+	out << "Player " << player << ":" << std::endl;
+
+	std::vector<SummaryStep> summarySteps;
+	if (!readSummary(summary, summarySteps))
+	{
+		out << "\tmalformed checksum history" << std::endl;
+		return;
+	}
+
+	const Step* s=NULL;
+	const SummaryStep* remoteStep=NULL;
+	for (size_t i=0; i<summarySteps.size() && !s; i++)
+	{
+		const Step* local=getStep(summarySteps[i].step);
+		if (local && local->checkSum!=summarySteps[i].checkSum)
+		{
+			s=local;
+			remoteStep=&summarySteps[i];
+		}
+	}
+	if (!s)
+	{
+		out << "\tno common step with a different checksum" << std::endl;
+		return;
+	}
+
+	out << "\tfirst different step is " << s->step << ", checksum is 0x" << std::hex << s->checkSum << " here and 0x" << remoteStep->checkSum << " there" << std::dec << std::endl;
+	if (s->game.size()!=remoteStep->game.size())
+		out << "\tthe game has " << s->game.size() << " checksums here and " << remoteStep->game.size() << " there" << std::endl;
+	for (size_t k=0; k<s->game.size() && k<remoteStep->game.size(); k++)
+		if (s->game[k]!=remoteStep->game[k])
+			out << "\t" << describeGameValue(k, s->game.size(), s->teamCount) << " differs, [" << k << "] is 0x" << std::hex << s->game[k] << " here and 0x" << remoteStep->game[k] << " there" << std::dec << std::endl;
+
+	if (details.size()<3 || details[0]!=s->step)
+	{
+		out << "\tno details of the units and buildings" << std::endl;
+		return;
+	}
+	Sint32 team=details[1];
+	size_t unitSize=details[2];
+	if (3+unitSize+1>details.size() || 3+unitSize+1+details[3+unitSize]>details.size())
+	{
+		out << "\tmalformed details of the units and buildings" << std::endl;
+		return;
+	}
+	size_t buildingSize=details[3+unitSize];
+	compareRecords(out, "unit", team, true, s->units, &details[3], unitSize, Unit::CHECKSUM_VECTOR_SIZE, Unit::CHECKSUM_VECTOR_GID);
+	compareRecords(out, "building", team, false, s->buildings, buildingSize ? &details[4+unitSize] : NULL, buildingSize, Building::CHECKSUM_VECTOR_SIZE, Building::CHECKSUM_VECTOR_GID);
+}
@@ -0,0 +1,105 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __CheckSumHistory_h
+#define __CheckSumHistory_h
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include "Types.h"
+
+class Game;
+
+///This keeps the detailed checksums of the game for the last steps. When a network game
+///desynchronizes, the players exchange them to find the first unit, building or value
+///that diverged. The summary of the history is exchanged first, then the details of the
+///units and buildings of the team that diverged first, at the step it diverged.
+class CheckSumHistory
+{
+public:
+	///Number of steps kept in the history
+	static const size_t STEP_COUNT = 32;
+	///Maximum number of values sent in one message, whose size is limited to 64 KB
+	static const size_t MAX_MESSAGE_VALUES = 15000;
+
+	CheckSumHistory();
+
+	///Computes the checksum of the game, records its details for the current step and returns it
+	Uint32 record(Game& game);
+
+	///Writes all the recorded steps to a text file, one line per team, unit and building,
+	///so that the files of different players can be compared with diff
+	void dump(const std::string& fileName) const;
+
+	///Returns the checksums of the recorded steps, sent as NetSendCheckSumHistory::Summary
+	std::vector<Uint32> getSummary() const;
+
+	///Compares the summary of another player with the history. Returns the first step whose
+	///checksum differs, or -1 if there is none, and puts the first team that differs there in team,
+	///or -1 if the difference is not in a team
+	Sint32 findDivergence(const std::vector<Uint32>& summary, Sint32* team) const;
+
+	///Returns the checksums of the units and buildings of a team at a step, sent as NetSendCheckSumHistory::Details
+	std::vector<Uint32> getDetails(Uint32 step, Sint32 team) const;
+
+	///Writes a report of the first differences between the history and the summary and details of another player
+	void writeReport(std::ostream& out, int player, const std::vector<Uint32>& summary, const std::vector<Uint32>& details) const;
+
+private:
+	///The detailed checksums of one step, as computed by Game::checkSum
+	struct Step
+	{
+		Uint32 step;
+		Uint32 checkSum;
+		Uint32 teamCount;
+		std::vector<Uint32> game;
+		std::vector<Uint32> buildings;
+		std::vector<Uint32> units;
+	};
+
+	///A step in the summary of another player
+	struct SummaryStep
+	{
+		Uint32 step;
+		Uint32 checkSum;
+		std::vector<Uint32> game;
+	};
+
+	///Returns the recorded step, or NULL if it is not in the history
+	const Step* getStep(Uint32 step) const;
+	///Returns the i-th recorded step, from the oldest
+	const Step& getStepByIndex(size_t i) const;
+	///Reads a summary, returns false if it is malformed
+	static bool readSummary(const std::vector<Uint32>& summary, std::vector<SummaryStep>& steps);
+	///Describes the i-th of the size values of the game checksums
+	static std::string describeGameValue(size_t i, size_t size, Uint32 teamCount);
+	///Writes the differences between the records of units or buildings of the details of another player and ours
+	static void compareRecords(std::ostream& out, const char* kind, Sint32 team, bool isUnit, const std::vector<Uint32>& local, const Uint32* remote, size_t remoteSize, size_t recordSize, size_t gidPosition);
+	///Maximum number of differing units or buildings written in a report
+	static const size_t MAX_REPORTED_RECORDS = 10;
+
+	std::vector<Step> steps;
+	///Where the next step is recorded in steps
+	size_t nextStep;
+	///Number of steps recorded, up to STEP_COUNT
+	size_t stepCount;
+};
+
+#endif
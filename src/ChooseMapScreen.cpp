@@ -131,38 +131,30 @@ void ChooseMapScreen::onAction(Widget *source, Action action, int par1, int par2
 
 			try
 			{
-				mapPreview->setMapThumbnail(mapFileName.c_str());
+				// The header and thumbnail are read from the cache, unless the file changed
+				MapThumbnail thumbnail;
+				if (verbose)
+					std::cout << "ChooseMapScreen::onAction : loading map " << mapFileName << std::endl;
+				validMapSelected = headerCache.get(mapFileName, mapHeader, thumbnail);
+				mapPreview->setMapThumbnail(validMapSelected ? thumbnail : MapThumbnail());
 
-				InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(mapFileName));
-				if (stream->isEndOfStream())
-				{
-					std::cerr << "ChooseMapScreen::onAction() : error, can't open file " << mapFileName  << std::endl;
-				}
-				else
-				{
-					if (verbose)
-						std::cout << "ChooseMapScreen::onAction : loading map " << mapFileName << std::endl;
-					validMapSelected = mapHeader.load(stream);
+				if (!validMapSelected) selectedType = NONE;
 
-					if (!validMapSelected) selectedType = NONE;
-
-					mapHeader.setMapName(glob2FilenameToName(mapFileName));
-					if (validMapSelected)
-					{
-						updateMapInformation();
+				mapHeader.setMapName(glob2FilenameToName(mapFileName));
+				if (validMapSelected)
+				{
+					updateMapInformation();
 
-						time_t mtime = Toolkit::getFileManager()->mtime(mapFileName);
-						mapDate->setText(ctime(&mtime));
+					time_t mtime = Toolkit::getFileManager()->mtime(mapFileName);
+					mapDate->setText(ctime(&mtime));
 
-						if (currentDirectoryMode == DisplayRegular)
-							selectedType = type1;
-						else
-							selectedType = type2;
-					}
+					if (currentDirectoryMode == DisplayRegular)
+						selectedType = type1;
 					else
-						std::cerr << "ChooseMapScreen::onAction : invalid map header for map " << mapFileName << std::endl;
+						selectedType = type2;
 				}
-				delete stream;
+				else
+					std::cerr << "ChooseMapScreen::onAction : invalid map header for map " << mapFileName << std::endl;
 			}
 			catch (std::exception &e)
 			{
@@ -22,6 +22,7 @@
 
 #include "MapHeader.h"
 #include "GameHeader.h"
+#include "MapHeaderCache.h"
 #include "Glob2Screen.h"
 #include <GUINumber.h>
 
@@ -118,6 +119,8 @@ private:
 	Text *mapName, *mapInfo, *mapVersion, *mapSize, *mapDate, *varPrestigeText;
 	//! True when the selected map is valid
 	bool validMapSelected;
+	//! The headers and thumbnails of the files that have already been shown
+	MapHeaderCache headerCache;
 	//! Default type
 	LoadableType type1;
 	//! Alternate type
@@ -25,6 +25,7 @@
 #include <BinaryStream.h>
 #include <FormatableString.h>
 
+#include "AIEcho.h"
 #include "AINames.h"
 #include "CustomGameScreen.h"
 #include "EndGameScreen.h"
@@ -43,12 +44,16 @@
 #include "ReplayWriter.h"
 
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 
 using namespace boost;
 
 Engine::Engine()
 {
 	net=NULL;
+	lastVerifiedKeyframeStep=-1;
 	logFile = globalContainer->logFileManager->getFile("Engine.log");
 }
 
@@ -236,6 +241,31 @@ void Engine::createRandomGame()
 
 
 
+int Engine::initAIGame(MapHeader& mapHeader, const std::vector<AI::ImplementitionID>& ais, Uint32 randomSeed)
+{
+	assert((int)ais.size() <= mapHeader.getNumberOfTeams());
+
+	// The engine needs a local player, it doesn't give any order
+	GameHeader gameHeader;
+	gameHeader.getBasePlayer(0) = BasePlayer(0, globalContainer->settings.getUsername(), 0, BasePlayer::P_LOCAL);
+	for (size_t i=0; i<ais.size(); i++)
+	{
+		FormatableString name("%0 %1");
+		name.arg(AINames::getAIText(ais[i])).arg(i);
+		gameHeader.getBasePlayer(i+1) = BasePlayer(i+1, name.c_str(), i, Player::playerTypeFromImplementitionID(ais[i]));
+		gameHeader.setAllyTeamNumber(i, i);
+	}
+	gameHeader.setNumberOfPlayers(ais.size()+1);
+	gameHeader.setRandomSeed(randomSeed);
+
+	gui.localPlayer=0;
+	gui.localTeamNo=0;
+
+	return initGame(mapHeader, gameHeader);
+}
+
+
+
 bool Engine::haveMap(const MapHeader& mapHeader)
 {
 	// FIXME: This is a fairly ugly way to test if the file exists
@@ -313,18 +343,40 @@ int Engine::run(void)
 		
 		Sint32 needToBeTime = 0;
 		Sint32 startTime = SDL_GetTicks();
+		Sint32 lastFrameTime = 0;
 		unsigned frameNumber = 0;
 		bool sendBumpUp=false;
 
+		// The replay starts with a keyframe of the initial game
+		if (globalContainer->replayWriter)
+			globalContainer->replayWriter->addKeyframeIfNeeded(gui.game);
+
 		while (gui.isRunning)
 		{
 			nextGuiStep--;
+
+			// In turbo mode, the steps are not paced by the clock. This can't work with other players over the network.
+			bool unthrottled = globalContainer->turbo && !multiplayer && !gui.gamePaused;
 			
 			// Set the replay speed
 			if (globalContainer->replaying)
 			{
-				if (globalContainer->replayFastForward && !gui.gamePaused)
+				if (globalContainer->replaySeekStep >= 0)
+				{
+					seekReplay();
+					// Show the result right away once we got there
+					if (globalContainer->replaySeekStep < 0)
+						nextGuiStep = 0;
+				}
+
+				if (globalContainer->replaySeekStep >= 0)
+				{
+					unthrottled = true;
+				}
+				else if (globalContainer->replayFastForward && !gui.gamePaused)
 				{
+					if (globalContainer->replayUnthrottled)
+						unthrottled = true;
 					speed = 12;
 					if (nextGuiStep < 0) nextGuiStep = 2;
 				}
@@ -337,8 +389,21 @@ int Engine::run(void)
 			else
 			{
 				// Process the GUI as usual, every step
+				speed = 40;
 				nextGuiStep = 0;
 			}
+
+			if (unthrottled)
+			{
+				// Run the steps as fast as possible, and only process the GUI and draw
+				// when it is time for a new frame, at most TURBO_MAX_FPS times per second
+				speed = 0;
+				needToBeTime = SDL_GetTicks() - startTime;
+				if (needToBeTime - lastFrameTime >= 1000 / TURBO_MAX_FPS)
+					nextGuiStep = 0;
+				else
+					nextGuiStep = 1;
+			}
 			
 			// We always allow the user to use the gui:
 			if (globalContainer->automaticEndingGame)
@@ -393,6 +458,7 @@ int Engine::run(void)
 				}
 				
 				// we get and push ai orders, if they are needed for this frame
+				planAIs();
 				for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
 				{
 					if (gui.game.players[i]->ai && !net->orderRecieved(i))
@@ -409,11 +475,21 @@ int Engine::run(void)
 				
 				if(networkReadyToExecute)
 				{
-					Uint32 checksum = gui.game.checkSum(NULL, NULL, NULL);
+					Uint32 checksum;
+					if (multiplayer)
+						checksum = checkSumHistory.record(gui.game);
+					else if (globalContainer->replayReader && globalContainer->replayCheckChecksums)
+					{
+						// Keep the details of the checksum the replay compares, in case it doesn't match
+						replayStepCheckSums.clear();
+						checksum = gui.game.checkSum(&replayStepCheckSums, NULL, NULL);
+					}
+					else
+						checksum = gui.game.checkSum(NULL, NULL, NULL);
 					net->advanceStep(checksum);
 
-					// Enable this to do test if checksums in the replay match
-					//if (globalContainer->replayReader) globalContainer->replayReader->setCheckSum(checksum);
+					// Test if checksums in the replay match when verifying replays
+					if (globalContainer->replayReader && globalContainer->replayCheckChecksums) globalContainer->replayReader->setCheckSum(checksum);
 					if (globalContainer->replayWriter) globalContainer->replayWriter->setCheckSum(checksum);
 				}
 
@@ -428,6 +504,7 @@ int Engine::run(void)
 					{	
 						std::cout<<"Game desychronized."<<std::endl;
 						gui.game.dumpAllData("glob2.world-desynchronization.dump.txt");
+						investigateDesynchronization();
 						assert(false);
 					}
 					else
@@ -462,7 +539,9 @@ int Engine::run(void)
 				if (globalContainer->replaying)
 				{
 					assert(globalContainer->replayReader);
-					assert(globalContainer->replayReader->isValid());
+
+					if (globalContainer->replayCheckChecksums)
+						verifyReplayKeyframe();
 					
 					while (globalContainer->replayReader->hasMoreOrdersThisStep())
 					{
@@ -475,15 +554,22 @@ int Engine::run(void)
 							gui.executeOrder(order);
 						}
 					}
+
+					// The reader stops at the first checksum that doesn't match, keep the details of that checksum for the report
+					if (globalContainer->replayCheckChecksums && globalContainer->replayReader->getCheckSumMismatchStep() >= 0 && replayMismatchCheckSums.empty())
+						replayMismatchCheckSums.swap(replayStepCheckSums);
 					
 					if (globalContainer->replayReader->isFinished())
 					{
-						gui.showEndOfReplayScreen();
+						if (globalContainer->runNoX)
+							gui.isRunning = false;
+						else
+							gui.showEndOfReplayScreen();
 					}
 				}
 				
-				// here we do the real work
-				if (networkReadyToExecute && !gui.gamePaused && !gui.hardPause)
+				// here we do the real work, seeking in a replay runs even if it is paused
+				if (networkReadyToExecute && (!gui.gamePaused || globalContainer->replaySeekStep >= 0) && !gui.hardPause)
 				{
 					if (globalContainer->replaying)
 					{
@@ -492,6 +578,9 @@ int Engine::run(void)
 					}
 					
 					gui.game.syncStep(gui.localTeamNo);
+
+					if (globalContainer->replayWriter)
+						globalContainer->replayWriter->addKeyframeIfNeeded(gui.game);
 				}
 			}
 
@@ -511,6 +600,7 @@ int Engine::run(void)
 					// we draw
 					gui.drawAll(gui.localTeamNo);
 					globalContainer->gfx->nextFrame();
+					lastFrameTime = SDL_GetTicks() - startTime;
 				}
 				
 				// if required, save videoshot
@@ -566,6 +656,15 @@ int Engine::run(void)
 			int seconds = (time / 25) % 60;
 			int minutes = (time / 25) / 60;
 			std::cout<< "automaticEndingGame ended: "<<time<<" ticks, "<<minutes<<" minutes, "<<seconds<<" seconds"<<std::endl;
+			for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
+			{
+				if (gui.game.players[i]->ai)
+				{
+					std::cout<<"AI "<<gui.game.players[i]->name<<": ";
+					gui.game.players[i]->ai->scheduler.format(std::cout);
+					std::cout<<std::endl;
+				}
+			}
 		}
 
 		cpuStats.format();
@@ -755,14 +854,22 @@ int Engine::initGame(MapHeader& mapHeader, GameHeader& gameHeader, bool setGameH
 	// We remove uncontrolled stuff from map
 	gui.game.clearingUncontrolledTeams();
 
+	// In network games every computer must run the AIs with the same budget, so they keep the default one
+	if (!multiplayer)
+	{
+		for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
+			if (gui.game.players[i]->ai)
+				gui.game.players[i]->ai->scheduler.setBudget(globalContainer->aiBudget);
+	}
+
 	// We do some cosmetic fix
 	finalAdjustements();
 
 	// we create the net game
 	net=new NetEngine(gui.game.gameHeader.getNumberOfPlayers(), gui.localPlayer);
 
-	// Initialise the replay writer, unless we're showing a replay
-	if (!globalContainer->replaying)
+	// Initialise the replay writer, unless we're showing a replay or playing tournament games, which run in parallel
+	if (!globalContainer->replaying && !globalContainer->tournamentGames)
 	{
 		assert(globalContainer->replayWriter == NULL);
 		globalContainer->replayWriter = new ReplayWriter();
@@ -901,6 +1008,8 @@ int Engine::loadReplay(const std::string &fileName)
 	gui.localTeamNo = 0;
 	globalContainer->replayVisibleTeams = 0xFFFFFFFF;
 	globalContainer->replayFastForward = false;
+	globalContainer->replayUnthrottled = false;
+	globalContainer->replaySeekStep = -1;
 
 	// Initialize the ReplayReader in GlobalContainer
 	globalContainer->replayReader = new ReplayReader();
@@ -942,6 +1051,219 @@ int Engine::loadReplay(const std::string &fileName)
 	return EE_NO_ERROR;
 }
 
+bool Engine::verifyReplay(const std::string &fileName)
+{
+	globalContainer->replayCheckChecksums = true;
+	replayMismatchCheckSums.clear();
+	replayStepCheckSums.clear();
+	replayKeyframeReport.clear();
+	lastVerifiedKeyframeStep = -1;
+
+	if (loadReplay(fileName) != EE_NO_ERROR)
+	{
+		std::cout << fileName << ": can't load replay" << std::endl;
+		return false;
+	}
+	run();
+
+	ReplayReader *reader = globalContainer->replayReader;
+	assert(reader);
+	Sint32 mismatchStep = reader->getCheckSumMismatchStep();
+
+	// Build the whole report before printing it, other replays may be verified at the same time
+	std::ostringstream report;
+	report << std::hex;
+	if (mismatchStep < 0)
+	{
+		report << fileName << ": ok" << std::endl;
+	}
+	else
+	{
+		report << fileName << ": checksums differ at step " << std::dec << mismatchStep << std::hex;
+		report << ", replay has 0x" << reader->getMismatchedCheckSum() << ", game has:" << std::endl;
+		for (size_t i = 0; i < replayMismatchCheckSums.size(); i++)
+			report << "\t[" << std::dec << i << std::hex << "] 0x" << replayMismatchCheckSums[i] << std::endl;
+	}
+	if (!replayKeyframeReport.empty())
+		report << fileName << ": " << replayKeyframeReport;
+	std::cout << report.str() << std::flush;
+
+	delete globalContainer->replayReader;
+	globalContainer->replayReader = NULL;
+	globalContainer->replayCheckChecksums = false;
+
+	return mismatchStep < 0;
+}
+
+bool Engine::benchmarkGradients(const std::string &fileName)
+{
+	if (!loadGame(fileName))
+	{
+		std::cout << fileName << ": can't load map" << std::endl;
+		return false;
+	}
+	std::ostringstream report;
+	bool same = AIEcho::Gradients::Gradient::benchmark(&gui.game.map, report);
+	std::cout << fileName << ": " << report.str() << std::flush;
+	return same;
+}
+
+void Engine::planAIs(void)
+{
+	std::vector<AI *> ais;
+	for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
+	{
+		AI *ai = gui.game.players[i]->ai;
+		if (ai && !net->orderRecieved(i) && ai->canPlan(gui.gamePaused))
+			ais.push_back(ai);
+	}
+	if (ais.empty())
+		return;
+
+	// The game is not modified until all the AIs are done, and the orders are then
+	// taken in the order of the players, so the threads can't change the orders
+	aiPlanner.plan(ais);
+}
+
+void Engine::investigateDesynchronization()
+{
+	checkSumHistory.dump("glob2.desync.history.txt");
+	if (!multiplayer)
+		return;
+
+	const GameHeader& header = gui.game.gameHeader;
+	int remotePlayerCount = 0;
+	for (int p=0; p<header.getNumberOfPlayers(); p++)
+		if (p != gui.localPlayer && header.getBasePlayer(p).type == BasePlayer::P_IP)
+			remotePlayerCount++;
+
+	// First every player sends the summary of its history, then the details of the units and buildings
+	// where it diverged from each other player, the two parts each fitting in one message
+	std::map<int, std::vector<Uint32> > summaries, details;
+	std::set<std::pair<Sint32, Sint32> > sentDetails;
+	net->sendCheckSumHistory(NetSendCheckSumHistory::Summary, checkSumHistory.getSummary());
+	Uint32 timeout = SDL_GetTicks() + 10000;
+	size_t processed = 0;
+	size_t divergingPlayers = 0;
+	while ((summaries.size() < size_t(remotePlayerCount) || details.size() < divergingPlayers) && SDL_GetTicks() < timeout)
+	{
+		multiplayer->update();
+		const std::vector<shared_ptr<NetSendCheckSumHistory> >& histories = net->getCheckSumHistories();
+		for (; processed < histories.size(); processed++)
+		{
+			shared_ptr<NetSendCheckSumHistory> history = histories[processed];
+			if (history->getPart() == NetSendCheckSumHistory::Summary)
+			{
+				summaries[history->getPlayer()] = history->getValues();
+				Sint32 team;
+				Sint32 step = checkSumHistory.findDivergence(history->getValues(), &team);
+				// The other player finds the same divergence and sends its details
+				if (step >= 0)
+					divergingPlayers++;
+				if (step >= 0 && sentDetails.insert(std::make_pair(step, team)).second)
+					net->sendCheckSumHistory(NetSendCheckSumHistory::Details, checkSumHistory.getDetails(step, team));
+			}
+			else
+			{
+				details[history->getPlayer()] = history->getValues();
+			}
+		}
+		SDL_Delay(20);
+	}
+
+	std::ostringstream report;
+	report << "Desynchronization at step " << gui.game.stepCounter << ", " << summaries.size() << " of " << remotePlayerCount << " players sent their checksum history" << std::endl;
+	for (std::map<int, std::vector<Uint32> >::iterator i = summaries.begin(); i != summaries.end(); ++i)
+		checkSumHistory.writeReport(report, i->first, i->second, details[i->first]);
+
+	std::cout << report.str();
+	FILE *fp = Toolkit::getFileManager()->openFP("glob2.desync.report.txt", "w");
+	if (fp)
+	{
+		fputs(report.str().c_str(), fp);
+		fclose(fp);
+	}
+}
+
+void Engine::verifyReplayKeyframe()
+{
+	// Once the game diverged, later keyframes won't match either
+	if (!replayKeyframeReport.empty())
+		return;
+
+	ReplayReader *reader = globalContainer->replayReader;
+	Sint32 step = reader->getCurrentStep();
+	if (step == lastVerifiedKeyframeStep || reader->getKeyframeStepBefore(step) != step)
+		return;
+	lastVerifiedKeyframeStep = step;
+
+	InputStream *snapshot = reader->getKeyframeSnapshot(step);
+	if (snapshot == NULL)
+		return;
+	Game keyframeGame(NULL);
+	boost::mt19937 keyframeRandomGenerator;
+	bool loaded = keyframeGame.load(snapshot) && loadSyncRandState(snapshot, keyframeRandomGenerator);
+	delete snapshot;
+	if (!loaded)
+	{
+		replayKeyframeReport = FormatableString("can't load the keyframe at step %0\n").arg(step);
+		return;
+	}
+
+	// Compare the detailed checksums, to tell which part of the game diverged
+	std::vector<Uint32> expected[3], actual[3];
+	keyframeGame.checkSum(&expected[0], &expected[1], &expected[2]);
+	gui.game.checkSum(&actual[0], &actual[1], &actual[2]);
+	const char *names[3] = { "game", "buildings", "units" };
+	std::ostringstream report;
+	report << std::hex;
+	for (int v = 0; v < 3; v++)
+	{
+		if (expected[v].size() != actual[v].size())
+		{
+			report << "\t" << names[v] << ": " << std::dec << expected[v].size() << " checksums in the keyframe, " << actual[v].size() << " in the game" << std::hex << std::endl;
+			continue;
+		}
+		for (size_t i = 0; i < expected[v].size(); i++)
+			if (expected[v][i] != actual[v][i])
+				report << "\t" << names[v] << "[" << std::dec << i << std::hex << "]: 0x" << expected[v][i] << " in the keyframe, 0x" << actual[v][i] << " in the game" << std::endl;
+	}
+	// The random generator is not part of the checksums, but the game diverges as soon as it does
+	if (!(keyframeRandomGenerator == randomGenerator))
+		report << "\tthe state of the random generator" << std::endl;
+	if (!report.str().empty())
+		replayKeyframeReport = FormatableString("the game differs from the keyframe at step %0:\n").arg(step) + report.str();
+}
+
+void Engine::seekReplay()
+{
+	ReplayReader *reader = globalContainer->replayReader;
+	assert(reader);
+	Uint32 targetStep = globalContainer->replaySeekStep;
+	Uint32 currentStep = reader->getCurrentStep();
+
+	// Jump to the last keyframe before the target if we have to go back, or if it is ahead of us
+	Sint32 keyframeStep = reader->getKeyframeStepBefore(targetStep);
+	if (keyframeStep >= 0 && (targetStep < currentStep || static_cast<Uint32>(keyframeStep) > currentStep))
+	{
+		InputStream *snapshot = reader->openKeyframe(targetStep);
+		if (snapshot)
+		{
+			if (!gui.loadReplayKeyframe(snapshot))
+			{
+				// The game is lost, stop the replay
+				gui.isRunning = false;
+			}
+			delete snapshot;
+		}
+		currentStep = reader->getCurrentStep();
+	}
+
+	// Without a keyframe, we can't go back in time
+	if (currentStep >= targetStep)
+		globalContainer->replaySeekStep = -1;
+}
+
 void Engine::finalAdjustements(void)
 {
 	gui.adjustLocalTeam();
@@ -31,6 +31,8 @@
 #include "NetEngine.h"
 #include "MultiplayerGame.h"
 #include "CPUStatisticsManager.h"
+#include "CheckSumHistory.h"
+#include "AIPlanner.h"
 
 
 class MultiplayersJoin;
@@ -70,8 +72,20 @@ public:
 	//! This function creates a game with a random map and random AI for every team
 	void createRandomGame();
 
+	/// Initiates a game on the given map where the AI ais[i] plays alone on team i. The local player
+	/// only watches, from team 0. This is used by the AI tournaments
+	int initAIGame(MapHeader& mapHeader, const std::vector<AI::ImplementitionID>& ais, Uint32 randomSeed);
+
 	/// Load a replay
 	int loadReplay(const std::string &fileName);
+
+	/// Runs the given replay without gui as fast as possible, checking the game's checksums against the
+	/// ones in the replay. Prints a report and returns true if they all match.
+	bool verifyReplay(const std::string &fileName);
+
+	/// Loads the given map and computes the gradients of the AI on it with the current and the
+	/// reference algorithm. Prints the timings and returns true if both gave the same gradients.
+	bool benchmarkGradients(const std::string &fileName);
 	
 	///Tells whether a map matching mapHeader is located on this system
 	bool haveMap(const MapHeader& mapHeader);
@@ -97,6 +111,9 @@ public:
 
 	///This will load the game header of the game with the given filename
 	static GameHeader loadGameHeader(const std::string &filename);
+
+	///Returns the game that is run
+	Game& getGame() { return gui.game; }
 	
 private:
 	/// Initiates a game, provided the map and game header. This initiates the net
@@ -117,6 +134,14 @@ private:
 	bool loadGame(const std::string &filename);
 	//! Do the final adjustements, like setting local teams and viewport, rendering minimap
 	void finalAdjustements(void);
+	//! Move the replay towards globalContainer->replaySeekStep, using its keyframes. Resets replaySeekStep when it is reached
+	void seekReplay(void);
+	//! When verifying a replay, compare the game with the replay's keyframe at the current step, if there is one
+	void verifyReplayKeyframe(void);
+	//! Lets the AIs that need an order at this step plan at the same time, on several threads
+	void planAIs(void);
+	//! When a network game desynchronized, exchange the checksum histories with the other players and report where they diverged
+	void investigateDesynchronization(void);
 
 	///This function will choose a random map from the available maps
 	MapHeader chooseRandomMap();
@@ -133,11 +158,28 @@ private:
 
 	CPUStatisticsManager cpuStats;
 
+	//! The detailed checksums of the last steps of a network game
+	CheckSumHistory checkSumHistory;
+	///Plans the AIs of each step on worker threads, see planAIs
+	AIPlanner aiPlanner;
+
 	Sint32 automaticGameStartTick, automaticGameEndTick;
 
 	FILE *logFile;
 
+	//! When verifying a replay, the detailed checksums of the game at the step where they stopped matching
+	std::vector<Uint32> replayMismatchCheckSums;
+	//! When verifying a replay, the detailed checksums of the game when the checksum of the current step was taken
+	std::vector<Uint32> replayStepCheckSums;
+	//! When verifying a replay, the description of the first keyframe that didn't match the game
+	std::string replayKeyframeReport;
+	//! When verifying a replay, the step of the last keyframe compared with the game
+	Sint32 lastVerifiedKeyframeStep;
+
 	static const bool verbose = false;
+
+	//! The maximum number of frames drawn per second when the steps are not paced by the clock
+	static const int TURBO_MAX_FPS = 25;
 };
 
 #endif
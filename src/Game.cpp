@@ -35,10 +35,12 @@
 
 #include <FileManager.h>
 #include <GraphicContext.h>
+#include <ParallelRenderer.h>
 
 #include "BuildingType.h"
 #include "Game.h"
 #include "GameUtilities.h"
+#include "MapThumbnail.h"
 #include "GlobalContainer.h"
 #include "LogFileManager.h"
 #include "Order.h"
@@ -68,6 +70,7 @@ Game::Game(GameGUI *gui, MapEdit* edit):
 	mapscript(gui)
 {
 	logFile = globalContainer->logFileManager->getFile("Game.log");
+	parallelRenderer = new ParallelRenderer();
 
 	init(gui, edit);
 }
@@ -94,6 +97,7 @@ Game::~Game()
 	}
 
 	overlayAlphas.resize(0);
+	delete parallelRenderer;
 
 	clearGame();
 
@@ -280,7 +284,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 					for (int x=posX; x<posX+w; x++)
 					{
 						size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
-						map.cases[index].forbidden|=teamMask;
+						map.setForbidden(index, map.cases[index].forbidden | teamMask);
 						if (oc->teamNumber == players[localPlayer]->teamNumber)
 							map.localForbiddenMap.set(index, true);
 					}
@@ -497,7 +501,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
-							map.cases[index].forbidden |= teamMask;
+							map.setForbidden(index, map.cases[index].forbidden | teamMask);
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
 								map.localForbiddenMap.set(index, true);
@@ -516,7 +520,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
-							map.cases[index].forbidden &= notTeamMask;
+							map.setForbidden(index, map.cases[index].forbidden & notTeamMask);
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
 								map.localForbiddenMap.set(index, false);
@@ -968,6 +972,13 @@ bool Game::load(GAGCore::InputStream *stream)
 		gameHints.decodeData(stream, mapHeader.getVersionMinor());
 	}
 
+	///The thumbnail is only read by map choosers, skip it
+	if(mapHeader.getThumbnailOffset())
+	{
+		MapThumbnail thumbnail;
+		thumbnail.decodeData(stream, mapHeader.getVersionMinor());
+	}
+
 	stream->readLeaveSection();
 
 	///versions less than 63 did not have fertility computed with the map, but computed it live.
@@ -1038,6 +1049,7 @@ void Game::save(GAGCore::OutputStream *stream, bool fileIsAMap, const std::strin
 	mapHeader.setMapName(name);
 	mapHeader.setIsSavedGame(!fileIsAMap);
 	mapHeader.resetGameSHA1();
+	mapHeader.setThumbnailOffset(0);
 
 	for (int i=0; i<mapHeader.getNumberOfTeams(); ++i)
 	{
@@ -1108,6 +1120,16 @@ void Game::save(GAGCore::OutputStream *stream, bool fileIsAMap, const std::strin
 	}
 	mapHeader.setGameSHA1(sha1);
 
+	///Save a thumbnail of the map, so that map choosers don't have to load the whole map.
+	///Its offset is only written when the MapHeader is overwritten below.
+	if (stream->canSeek() && dynamic_cast<GAGCore::BinaryOutputStream*>(stream))
+	{
+		mapHeader.setThumbnailOffset(stream->getPosition());
+		MapThumbnail thumbnail;
+		thumbnail.computeFromMap(map);
+		thumbnail.encodeData(stream);
+	}
+
 	///Overwrite the MapHeader. This is done after the map
 	///offset has been set.
 	if (stream->canSeek())
@@ -1142,7 +1164,7 @@ void Game::buildProjectSyncStep(Sint32 localTeam)
 				{
 					size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
 					// Update real map
-					map.cases[index].forbidden&=notTeamMask;
+					map.setForbidden(index, map.cases[index].forbidden & notTeamMask);
 					// Update local map
 					if (teamNumber == localTeam)
 						map.localForbiddenMap.set(index, false);
@@ -1164,7 +1186,7 @@ void Game::buildProjectSyncStep(Sint32 localTeam)
 					{
 						size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
 						// Update real map
-						map.cases[index].forbidden&=notTeamMask;
+						map.setForbidden(index, map.cases[index].forbidden & notTeamMask);
 						// Update local map
 						if (teamNumber == localTeam)
 							map.localForbiddenMap.set(index, false);
@@ -2819,6 +2841,9 @@ void Game::drawMap(int sx, int sy, int sw, int sh, int righMargin, int topMargin
 	int right=((sx+sw+31)>>5);
 	int bot=((sy+sh+31)>>5);
 
+	// in software mode, record the drawing commands and draw them in parallel bands at the end
+	parallelRenderer->begin(globalContainer->gfx);
+
 	time++;
 	drawMapWater(sw, sh, viewportX, viewportY, time);
 	drawMapTerrain(left, top, right, bot, viewportX, viewportY, localTeam, drawOptions);
@@ -2978,6 +3003,8 @@ void Game::drawMap(int sx, int sy, int sw, int sh, int righMargin, int topMargin
 							globalContainer->gfx->drawString((x<<5), (y<<5)+10, globalContainer->littleFont, value2);*/
 						break;
 					}
+
+	parallelRenderer->end();
 }
 
 
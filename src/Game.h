@@ -37,6 +37,7 @@
 namespace GAGCore
 {
 	class DrawableSurface;
+	class ParallelRenderer;
 	class InputStream;
 	class OutputStream;
 }
@@ -245,6 +246,8 @@ public:
 	///Stores alpha values to be passed to the drawing system. kept here so it isn't re-allocated
 	///every frame
 	std::valarray<unsigned char> overlayAlphas;
+	///Draws the map with several threads in software mode, each thread drawing a horizontal band of the screen
+	ParallelRenderer *parallelRenderer;
 
 public:
 	int mouseX, mouseY;
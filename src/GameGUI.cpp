@@ -117,6 +117,8 @@
 #define REPLAY_BAR_HEIGHT (2*REPLAY_PROGRESS_BAR_Y_OFFSET + 20)
 #define REPLAY_BAR_Y (globalContainer->settings.screenHeight - REPLAY_BAR_HEIGHT)
 #define REPLAY_BAR_TIMER_X (REPLAY_PROGRESS_BAR_X_OFFSET + REPLAY_PROGRESS_BAR_CAP_WIDTH + 5)
+#define REPLAY_PROGRESS_BAR_X (REPLAY_PROGRESS_BAR_X_OFFSET + REPLAY_PROGRESS_BAR_CAP_WIDTH - 1)
+#define REPLAY_PROGRESS_BAR_WIDTH (REPLAY_BAR_WIDTH - 2*REPLAY_PROGRESS_BAR_X_OFFSET - REPLAY_PROGRESS_BAR_NUM_BUTTONS * REPLAY_PROGRESS_BAR_BUTTON_WIDTH - 2*REPLAY_PROGRESS_BAR_CAP_WIDTH + 2)
 
 // Sprites for the replay bar
 #define REPLAY_BAR_LEFT_CAP_SPRITE 56
@@ -184,10 +186,12 @@ GameGUI::GameGUI()
 	  
 	  ghostManager(game)
 {
+	autosaveThread = NULL;
 }
 
 GameGUI::~GameGUI()
 {
+	finishAutosave(true);
 	for (ParticleSet::iterator it = particles.begin(); it != particles.end(); ++it)
 		delete *it;
 }
@@ -214,6 +218,7 @@ void GameGUI::init()
 	selection.building = NULL;
 	selection.unit = NULL;
 	miniMapPushed=false;
+	replayProgressBarPushed=false;
 	putMark=false;
 	showUnitWorkingToBuilding=true;
 	chatMask=0xFFFFFFFF;
@@ -636,20 +641,64 @@ void GameGUI::syncStep(void)
 	assert(teamStats);
 
 	if ((game.stepCounter&255) == 79)
+		autosave();
+}
+
+namespace
+{
+	//! Write an autosave serialized in memory to its file, run in its own thread
+	struct AutosaveFileWriter
 	{
-		const std::string name = Toolkit::getStringTable()->getString("[auto save]");
-		std::string fileName = glob2NameToFilename("games", name, "game");
-		OutputStream *stream = new BinaryOutputStream(Toolkit::getFileManager()->openOutputStreamBackend(fileName));
-		if (stream->isEndOfStream())
-		{
-			std::cerr << "GameGUI::syncStep : can't open autosave file " << name << " for writing" << std::endl;
-		}
-		else
+		std::string fileName;
+		std::string data;
+
+		void operator()()
 		{
-			save(stream, name);
+			StreamBackend *backend = Toolkit::getFileManager()->openOutputStreamBackend(fileName);
+			if (backend->isEndOfStream())
+				std::cerr << "AutosaveFileWriter : can't open autosave file " << fileName << " for writing" << std::endl;
+			else
+				backend->write(data.c_str(), data.size());
+			delete backend;
 		}
-		delete stream;
-	}
+	};
+}
+
+void GameGUI::autosave(void)
+{
+	// If the last autosave is still being written, we skip this one
+	if (!finishAutosave(false))
+		return;
+
+	const std::string name = Toolkit::getStringTable()->getString("[auto save]");
+	std::string fileName = glob2NameToFilename("games", name, "game");
+
+	// The game is serialized in memory here, between steps, as it can't be copied for another thread to do it.
+	// Only writing the file, the slow part on most disks, is done by a thread while the game goes on.
+	// We don't fork a process to save, as the other threads of the game could hold locks the child would need.
+	MemoryStreamBackend *backend = new MemoryStreamBackend();
+	OutputStream *stream = new BinaryOutputStream(backend);
+	save(stream, name);
+	AutosaveFileWriter writer;
+	writer.fileName = fileName;
+	backend->seekFromEnd(0);
+	writer.data.assign(backend->getBuffer(), backend->getPosition());
+	delete stream;
+	autosaveThread = new boost::thread(writer);
+}
+
+bool GameGUI::finishAutosave(bool wait)
+{
+	if (!autosaveThread)
+		return true;
+
+	if (wait)
+		autosaveThread->join();
+	else if (!autosaveThread->timed_join(boost::posix_time::seconds(0)))
+		return false;
+	delete autosaveThread;
+	autosaveThread = NULL;
+	return true;
 }
 
 bool GameGUI::processScrollableWidget(SDL_Event *event)
@@ -1098,6 +1147,7 @@ void GameGUI::processEvent(SDL_Event *event)
 				}
 			}
 			miniMapPushed=false;
+			replayProgressBarPushed=false;
 			selectionPushed=false;
 			panPushed=false;
 			// showUnitWorkingToBuilding=false;
@@ -1855,6 +1905,10 @@ void GameGUI::handleMouseMotion(int mx, int my, int button)
 	{
 		minimapMouseToPos(mx, my, &viewportX, &viewportY, true);
 	}
+	else if (replayProgressBarPushed)
+	{
+		seekReplayFromProgressBar(mx);
+	}
 	else
 	{
 		if (mx<scrollZoneWidth)
@@ -2544,11 +2598,18 @@ void GameGUI::handleReplayProgressBarClick(int mx, int my, int button)
 		
 		if (my >= y && my <= y+20)
 		{
+			if (mx >= REPLAY_PROGRESS_BAR_X && mx < REPLAY_PROGRESS_BAR_X + REPLAY_PROGRESS_BAR_WIDTH)
+			{
+				// Timeline, keep seeking while the button is held
+				replayProgressBarPushed = true;
+				seekReplayFromProgressBar(mx);
+			}
 			if (mx >= x-3*inc && mx <= x-2*inc)
 			{
 				// Play
 				gamePaused = false;
 				globalContainer->replayFastForward = false;
+				globalContainer->replayUnthrottled = false;
 			}
 			if (mx > x-2*inc && mx <= x-inc)
 			{
@@ -2557,7 +2618,9 @@ void GameGUI::handleReplayProgressBarClick(int mx, int my, int button)
 			}
 			if (mx > x-inc && mx <= x)
 			{
-				// Fast-forward
+				// Fast-forward, clicking it again toggles running as fast as possible
+				if (!gamePaused && globalContainer->replayFastForward)
+					globalContainer->replayUnthrottled = !globalContainer->replayUnthrottled;
 				gamePaused = false;
 				globalContainer->replayFastForward = true;
 			}
@@ -2565,6 +2628,17 @@ void GameGUI::handleReplayProgressBarClick(int mx, int my, int button)
 	}
 }
 
+void GameGUI::seekReplayFromProgressBar(int mx)
+{
+	assert(globalContainer->replaying);
+	assert(globalContainer->replayReader);
+
+	int pos = std::max(0, std::min(mx - REPLAY_PROGRESS_BAR_X, REPLAY_PROGRESS_BAR_WIDTH));
+	Uint32 numSteps = globalContainer->replayReader->getNumStepsTotal();
+	// The Engine jumps to the nearest keyframe and runs the replay up to this step
+	globalContainer->replaySeekStep = static_cast<Uint64>(numSteps) * pos / REPLAY_PROGRESS_BAR_WIDTH;
+}
+
 boost::shared_ptr<Order> GameGUI::getOrder(void)
 {
 	boost::shared_ptr<Order> order;
@@ -3772,10 +3846,17 @@ void GameGUI::drawReplayProgressBar(bool drawBackground)
 
 	// Draw the actual progress bar
 	Style::style->drawProgressBar(globalContainer->gfx, 
-		REPLAY_PROGRESS_BAR_X_OFFSET + REPLAY_PROGRESS_BAR_CAP_WIDTH - 1, y,
-		REPLAY_BAR_WIDTH - 2*REPLAY_PROGRESS_BAR_X_OFFSET - REPLAY_PROGRESS_BAR_NUM_BUTTONS * REPLAY_PROGRESS_BAR_BUTTON_WIDTH - 2*REPLAY_PROGRESS_BAR_CAP_WIDTH + 2, 
+		REPLAY_PROGRESS_BAR_X, y,
+		REPLAY_PROGRESS_BAR_WIDTH, 
 		globalContainer->replayReader->getCurrentStep(), 
 		globalContainer->replayReader->getNumStepsTotal());
+
+	// Mark the step we are seeking to
+	if (globalContainer->replaySeekStep >= 0)
+	{
+		int seekX = REPLAY_PROGRESS_BAR_X + static_cast<Uint64>(globalContainer->replaySeekStep) * REPLAY_PROGRESS_BAR_WIDTH / globalContainer->replayReader->getNumStepsTotal();
+		globalContainer->gfx->drawVertLine(seekX, y, 20, Color::white);
+	}
 	
 	// Draw the round caps
 	globalContainer->gfx->drawSprite(
@@ -4711,6 +4792,38 @@ bool GameGUI::load(GAGCore::InputStream *stream, bool ignoreGUIData)
 	return true;
 }
 
+bool GameGUI::loadReplayKeyframe(GAGCore::InputStream *stream)
+{
+	// The selection and the local team point to objects of the old game
+	clearSelection();
+
+	if (!game.load(stream))
+	{
+		std::cerr << "GameGUI::loadReplayKeyframe : can't load game" << std::endl;
+		return false;
+	}
+
+	// The random generator is not part of the game, it must go on from where it was when the snapshot was taken
+	if (!loadSyncRandState(stream))
+	{
+		std::cerr << "GameGUI::loadReplayKeyframe : can't load the state of the random generator" << std::endl;
+		return false;
+	}
+
+	// Like in Engine::loadReplay, the players must not issue orders of their own
+	for (int p=0; p<game.gameHeader.getNumberOfPlayers(); p++)
+	{
+		game.players[p]->makeItAI(AI::NONE);
+		game.gameHeader.getBasePlayer(p).makeItAI(AI::NONE);
+	}
+
+	adjustLocalTeam();
+	game.setAlliances();
+	minimap.setGame(game);
+
+	return true;
+}
+
 void GameGUI::save(GAGCore::OutputStream *stream, const std::string name)
 {
 	// Game is can't be no more automatically generated
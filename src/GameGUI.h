@@ -24,6 +24,7 @@
 
 #include <queue>
 #include <valarray>
+#include <boost/thread/thread.hpp>
 
 #include "Game.h"
 #include "Brush.h"
@@ -96,11 +97,15 @@ public:
 	//!
 	bool load(GAGCore::InputStream *stream, bool ignoreGUIData=false);
 	void save(GAGCore::OutputStream *stream, const std::string name);
+	/// Replaces the game by a replay keyframe (see ReplayReader::openKeyframe), keeping the state of the gui
+	bool loadReplayKeyframe(GAGCore::InputStream *stream);
 
 	void processEvent(SDL_Event *event);
 
 	// Engine has to call this every "real" steps. (or game steps)
 	void syncStep(void);
+	//! Wait for the autosave being written in the background, if any, returns false if wait is false and it is not finished yet
+	bool finishAutosave(bool wait);
 	//! return the local team of the player who is running glob2
 	Team *getLocalTeam(void) { return localTeam; }
 
@@ -225,6 +230,10 @@ private:
 	void handleMapClick(int mx, int my, int button);
 	void handleMenuClick(int mx, int my, int button);
 	void handleReplayProgressBarClick(int mx, int my, int button);
+	//! Seek the replay to the step under mx on the progress bar
+	void seekReplayFromProgressBar(int mx);
+	//! Save the game to the autosave file. The game is serialized in memory in the step, the file is written by a thread
+	void autosave(void);
 
 	void handleActivation(Uint8 state, Uint8 gain);
 	void nextDisplayMode(void);
@@ -374,6 +383,10 @@ private:
 	Sint32 selectionPushedPosX, selectionPushedPosY;
 	//! True if the mouse's button way never relased since click im minimap.
 	bool miniMapPushed;
+	//! True if the mouse's button way never relased since click in the replay's progress bar.
+	bool replayProgressBarPushed;
+	//! Thread writing the autosave to its file, NULL if none is running
+	boost::thread *autosaveThread;
 	//! True if we try to put a mark in the minimap
 	bool putMark;
 	//! True if we are panning
@@ -23,6 +23,7 @@
 
 #ifndef YOG_SERVER_ONLY
 
+#include "AITournament.h"
 #include "CampaignEditor.h"
 #include "CampaignMenuScreen.h"
 #include "CampaignMainMenu.h"
@@ -55,12 +56,15 @@
 
 #include <stdio.h>
 #include <sys/types.h>
+#include <map>
+#include <boost/thread/thread.hpp>
 
 #endif  // !YOG_SERVER_ONLY
 
 #ifndef WIN32
 #	include <unistd.h>
 #	include <sys/time.h>
+#	include <sys/wait.h>
 #else
 #	include <time.h>
 #endif
@@ -140,6 +144,125 @@ int Glob2::runNoX()
 
 
 
+int Glob2::runVerifyReplays()
+{
+	std::vector<std::string> replays;
+	// The directory is given on the command line, so it is not looked for in the search list
+	const std::string dir = Toolkit::getFileManager()->absolutePath(globalContainer->verifyReplaysDirectory);
+	if (Toolkit::getFileManager()->initRealDirectoryListing(dir, "replay", false))
+	{
+		std::string fileName;
+		while (!(fileName = Toolkit::getFileManager()->getNextDirectoryEntry()).empty())
+			replays.push_back(dir + DIR_SEPARATOR + fileName);
+	}
+	if (replays.empty())
+	{
+		std::cerr << "No replay found in " << dir << std::endl;
+		return 1;
+	}
+
+	unsigned failed = 0;
+#ifndef WIN32
+	// The game uses global state, so each replay is verified in its own process, as many at a time as we have cores
+	unsigned jobs = std::max(1u, boost::thread::hardware_concurrency());
+	std::map<pid_t, std::string> running;
+	size_t next = 0;
+	while (next < replays.size() || !running.empty())
+	{
+		while (next < replays.size() && running.size() < jobs)
+		{
+			std::cout << std::flush;
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				Engine engine;
+				bool ok = engine.verifyReplay(replays[next]);
+				std::cout << std::flush;
+				_exit(ok ? 0 : 1);
+			}
+			else if (pid < 0)
+			{
+				// Can't fork, do it ourselves
+				Engine engine;
+				if (!engine.verifyReplay(replays[next]))
+					failed++;
+			}
+			else
+			{
+				running[pid] = replays[next];
+			}
+			next++;
+		}
+
+		if (running.empty())
+			continue;
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0)
+			break;
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			if (!WIFEXITED(status))
+				std::cout << running[pid] << ": crashed" << std::endl;
+			failed++;
+		}
+		running.erase(pid);
+	}
+#else
+	for (size_t i = 0; i < replays.size(); i++)
+	{
+		Engine engine;
+		if (!engine.verifyReplay(replays[i]))
+			failed++;
+	}
+#endif
+
+	std::cout << replays.size() << " replays verified, " << failed << " failed" << std::endl;
+	return failed ? 1 : 0;
+}
+
+
+
+int Glob2::runBenchmarkGradients()
+{
+	std::vector<std::string> maps;
+	// The directory is given on the command line, so it is not looked for in the search list
+	const std::string dir = Toolkit::getFileManager()->absolutePath(globalContainer->benchmarkGradientsDirectory);
+	if (Toolkit::getFileManager()->initRealDirectoryListing(dir, "map", false))
+	{
+		std::string fileName;
+		while (!(fileName = Toolkit::getFileManager()->getNextDirectoryEntry()).empty())
+			maps.push_back(dir + DIR_SEPARATOR + fileName);
+	}
+	if (maps.empty())
+	{
+		std::cerr << "No map found in " << dir << std::endl;
+		return 1;
+	}
+
+	// Maps are benchmarked one after the other, so that the timings don't disturb each other
+	unsigned failed = 0;
+	for (size_t i = 0; i < maps.size(); i++)
+	{
+		Engine engine;
+		if (!engine.benchmarkGradients(maps[i]))
+			failed++;
+	}
+
+	std::cout << maps.size() << " maps benchmarked, " << failed << " failed" << std::endl;
+	return failed ? 1 : 0;
+}
+
+
+
+int Glob2::runTournament()
+{
+	AITournament tournament(globalContainer->tournamentGames);
+	return tournament.run();
+}
+
+
+
 int Glob2::runTestGames()
 {
 	globalContainer->automaticEndingSteps=90000;
@@ -260,6 +383,27 @@ int Glob2::run(int argc, char *argv[])
 		runTestMapGeneration();
 	}
 	
+	if (!globalContainer->verifyReplaysDirectory.empty())
+	{
+		int ret=runVerifyReplays();
+		delete globalContainer;
+		return ret;
+	}
+	
+	if (!globalContainer->benchmarkGradientsDirectory.empty())
+	{
+		int ret=runBenchmarkGradients();
+		delete globalContainer;
+		return ret;
+	}
+	
+	if (globalContainer->tournamentGames)
+	{
+		int ret=runTournament();
+		delete globalContainer;
+		return ret;
+	}
+	
 	if (globalContainer->runNoX)
 	{
 		int ret=runNoX();
@@ -36,6 +36,12 @@ public:
 	int runTestGames();
 	///Generates random maps non stop until the game crashes
 	int runTestMapGeneration();
+	///Verifies the checksums of all the replays of a directory, using all cores
+	int runVerifyReplays();
+	///Benchmarks the gradients of the AI on all the maps of a directory
+	int runBenchmarkGradients();
+	///Plays games between the AIs, using all cores, and rates them
+	int runTournament();
 	int run(int argc, char *argv[]);
 };
 
@@ -21,6 +21,7 @@
 #include <GAG.h>
 #include <GUIBase.h>
 
+#include "AIScheduler.h"
 #include "FileManager.h"
 #include "GameGUIKeyActions.h"
 #include "Glob2Screen.h"
@@ -95,6 +96,10 @@ GlobalContainer::GlobalContainer(void)
 	
 	runTestGames=false;
 	runTestMapGeneration=false;
+	tournamentGames=0;
+	aiBudget=AIScheduler::DEFAULT_BUDGET;
+	turbo=false;
+	verifyCheckSums=false;
 	automaticEndingGame=false;
 	automaticEndingSteps=-1;
 
@@ -120,10 +125,13 @@ GlobalContainer::GlobalContainer(void)
 	replaying = false;
 	replayFileName = "";
 	replayFastForward = false;
+	replayUnthrottled = false;
+	replaySeekStep = -1;
 	replayShowFog = true;
 	replayVisibleTeams = 0xFFFFFFFF;
 	replayShowAreas = false;
 	replayShowFlags = true;
+	replayCheckChecksums = false;
 
 #ifndef YOG_SERVER_ONLY
 	replayReader = NULL;
@@ -250,6 +258,73 @@ void GlobalContainer::parseArgs(int argc, char *argv[])
 			runTestMapGeneration = true;
 			runNoX=true;
 		}
+		else if (strcmp(argv[i], "-verify-replays")==0 || strcmp(argv[i], "--verify-replays")==0)
+		{
+			if (i+1 < argc)
+			{
+				verifyReplaysDirectory = argv[i+1];
+				runNoX = true;
+				i++;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("--verify-replays <directory>\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-gradients")==0 || strcmp(argv[i], "--benchmark-gradients")==0)
+		{
+			if (i+1 < argc)
+			{
+				benchmarkGradientsDirectory = argv[i+1];
+				runNoX = true;
+				i++;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("--benchmark-gradients <directory>\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-tournament")==0 || strcmp(argv[i], "--tournament")==0)
+		{
+			if (i+1 < argc && atoi(argv[i+1]) > 0)
+			{
+				tournamentGames = atoi(argv[i+1]);
+				runNoX = true;
+				i++;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("--tournament <number of games>\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-ai-budget")==0 || strcmp(argv[i], "--ai-budget")==0)
+		{
+			if (i+1 < argc && atoi(argv[i+1]) > 0)
+			{
+				aiBudget = atoi(argv[i+1]);
+				i++;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("--ai-budget <microseconds>\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-turbo")==0)
+		{
+			turbo=true;
+		}
+		else if (strcmp(argv[i], "-verify-checksums")==0)
+		{
+			verifyCheckSums=true;
+		}
 		else if (strcmp(argv[i], "-vs")==0)
 		{
 			if (i+1 < argc)
@@ -467,6 +542,12 @@ void GlobalContainer::parseArgs(int argc, char *argv[])
 			printf("-test-games\tCreates random games with AI and tests them\n");
 			printf("-test-games-nox\tCreates random games with AI and tests them, without gui\n");
 			printf("-test-map-gen\tGenerates random maps endlessly, without gui\n");
+			printf("-turbo\tRun games and replays as fast as possible instead of at game speed\n");
+			printf("-verify-checksums\tCheck the map checksum kept up to date during the game against a full recomputation\n");
+			printf("-verify-replays <directory>\tReplays all the replays of the directory without gui and checks that the games don't diverge\n");
+			printf("-benchmark-gradients <directory>\tComputes the gradients of the AI on all the maps of the directory without gui and prints how long it took\n");
+			printf("-tournament <number of games>\tPlays games between the AIs on the maps of the maps directory without gui and rates the AIs\n");
+			printf("-ai-budget <microseconds>\tWork each AI may do per step in games that are not played over the network, %u by default\n", AIScheduler::DEFAULT_BUDGET);
 			printf("-admin-router Allows you to connect to a YOG router to do administration\n");
 			printf("-vs <name>\tsave a videoshot as name\n");
 			printf("-replay <replay file name>\t replay the game stored in the specified file.\n");
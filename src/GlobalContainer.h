@@ -122,6 +122,13 @@ public:
 	bool runTestGames; //! runs test games
 	
 	bool runTestMapGeneration; //! runs test map generation
+
+	bool turbo; //!< Run the game steps as fast as possible instead of at game speed, drawing at most a few frames per second
+	std::string verifyReplaysDirectory; //!< If not empty, verify the checksums of all the replays in this directory and exit
+	std::string benchmarkGradientsDirectory; //!< If not empty, benchmark the AI gradients on all the maps in this directory and exit
+	int tournamentGames; //!< If not 0, play that many AI against AI games without gui, rate the AIs and exit
+	Uint32 aiBudget; //!< Budget of work of each AI per step in games that are not played over the network, in estimated microseconds
+	bool verifyCheckSums; //!< Recompute the checksums kept up to date during the game from scratch and report differences, for debugging
 	
 	bool hostServer;
 	bool hostRouter;
@@ -133,10 +140,13 @@ public:
 	bool replaying; //!< Whether the current game is a replay or a usual game
 	std::string replayFileName; //!< The name of the replay file.
 	bool replayFastForward; //!< If set to true, the replay will play faster.
+	bool replayUnthrottled; //!< If set to true with replayFastForward, the replay runs as fast as possible.
+	Sint32 replaySeekStep; //!< If not -1, the replay is run without delay and without drawing until it reaches this step.
 	bool replayShowFog; //!< Draw the fog of war or draw the entire map. Can be edited real-time.
 	Uint32 replayVisibleTeams; //!< A mask of which teams can be seen in the replay. Can be edited real-time.
 	bool replayShowAreas; //!< Show areas of gui.localPlayer or not. Can be edited real-time.
 	bool replayShowFlags; //!< Show all flags or show none. Can be edited real-time.
+	bool replayCheckChecksums; //!< Compare the game's checksums with the ones stored in the replay.
 
 #ifndef YOG_SERVER_ONLY
 	ReplayReader *replayReader; //!< Reads and processes replay files, and outputs orders
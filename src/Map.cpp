@@ -28,7 +28,9 @@
 #include <algorithm>
 #include <valarray>
 #include <Stream.h>
+#include <BinaryStream.h>
 #include <queue>
+#include "zlib.h"
 
 
 #if defined( LOG_GRADIENT_LINE_GRADIENT )
@@ -88,8 +90,11 @@ Map::Map()
 	fogOfWar=NULL;
 	fogOfWarA=NULL;
 	fogOfWarB=NULL;
+	fogOfWarBlocksA=NULL;
+	fogOfWarBlocksB=NULL;
 	astarpoints = NULL;
 	cases=NULL;
+	casesCheckSum=0;
 	for (int t=0; t<Team::MAX_COUNT; t++)
 		for (int r=0; r<MAX_NB_RESSOURCES; r++)
 			for (int s=0; s<2; s++)
@@ -112,6 +117,10 @@ Map::Map()
 	undermap=NULL;
 	sectors=NULL;
 	listedAddr=NULL;
+	minimapDirtyBlocks=NULL;
+	minimapDirtyRows=NULL;
+	caseChangeBlocks=NULL;
+	caseChangeStamp=0;
 	
 	for (int t = 0; t < Team::MAX_COUNT; t++)
 		clearingAreaClaims[t] = NULL;
@@ -251,9 +260,18 @@ void Map::clear()
 		delete[] fogOfWarB;
 		fogOfWarB=NULL;
 
+		assert(fogOfWarBlocksA);
+		delete[] fogOfWarBlocksA;
+		fogOfWarBlocksA=NULL;
+
+		assert(fogOfWarBlocksB);
+		delete[] fogOfWarBlocksB;
+		fogOfWarBlocksB=NULL;
+
 		assert(cases);
 		delete[] cases;
 		cases=NULL;
+		casesCheckSum=0;
 		for (int t=0; t<Team::MAX_COUNT; t++)
 			if (ressourcesGradient[t][0][0])
 				for (int r=0; r<MAX_RESSOURCES; r++)
@@ -320,6 +338,18 @@ void Map::clear()
 		delete[] immobileUnits;
 		immobileUnits=NULL;
 
+		assert(minimapDirtyBlocks);
+		delete[] minimapDirtyBlocks;
+		minimapDirtyBlocks=NULL;
+		
+		assert(minimapDirtyRows);
+		delete[] minimapDirtyRows;
+		minimapDirtyRows=NULL;
+		
+		assert(caseChangeBlocks);
+		delete[] caseChangeBlocks;
+		caseChangeBlocks=NULL;
+
 		arraysBuilt=false;
 	}
 	else
@@ -328,6 +358,8 @@ void Map::clear()
 		assert(fogOfWar==NULL);
 		assert(fogOfWarA==NULL);
 		assert(fogOfWarB==NULL);
+		assert(fogOfWarBlocksA==NULL);
+		assert(fogOfWarBlocksB==NULL);
 		assert(cases==NULL);
 		for (int t=0; t<Team::MAX_COUNT; t++)
 			for (int r=0; r<MAX_RESSOURCES; r++)
@@ -963,11 +995,20 @@ void Map::setSize(int wDec, int hDec, TerrainType terrainType)
 	fogOfWarB=new Uint32[size];
 	memset(fogOfWarB, 0, size*sizeof(Uint32));
 	fogOfWar=fogOfWarA;
+	fogOfWarBlocksA=new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	memset(fogOfWarBlocksA, 0, size>>(2*MINIMAP_BLOCK_SHIFT));
+	fogOfWarBlocksB=new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	memset(fogOfWarBlocksB, 0, size>>(2*MINIMAP_BLOCK_SHIFT));
 	
 	localForbiddenMap.resize(size, false);
 	localGuardAreaMap.resize(size, false);
 	localClearAreaMap.resize(size, false);
 	
+	minimapDirtyBlocks=new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	minimapDirtyRows=new Uint8[h>>MINIMAP_BLOCK_SHIFT];
+	setMinimapDirty();
+	caseChangeBlocks=new Uint32[size>>(2*CHANGE_BLOCK_SHIFT)];
+	
 	cases=new Case[size];
 	Case initCase;
 	initCase.terrain = 0; // default, not really meaningfull.
@@ -984,6 +1025,7 @@ void Map::setSize(int wDec, int hDec, TerrainType terrainType)
 	
 	for (size_t i=0; i<size; i++)
 		cases[i]=initCase;
+	resetCasesCheckSum();
 	
 	undermap=new Uint8[size];
 	memset(undermap, terrainType, size);
@@ -1082,6 +1124,10 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 	fogOfWar = fogOfWarA;
 	memset(fogOfWarA, 0, size*sizeof(Uint32));
 	memset(fogOfWarB, 0, size*sizeof(Uint32));
+	fogOfWarBlocksA = new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	memset(fogOfWarBlocksA, 0, size>>(2*MINIMAP_BLOCK_SHIFT));
+	fogOfWarBlocksB = new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	memset(fogOfWarBlocksB, 0, size>>(2*MINIMAP_BLOCK_SHIFT));
 	localForbiddenMap.resize(size, false);
 	localGuardAreaMap.resize(size, false);
 	localClearAreaMap.resize(size, false);
@@ -1091,6 +1137,10 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 	astarpoints=new AStarAlgorithmPoint[size];
 	immobileUnits = new Uint8[size];
 	memset(immobileUnits, 255, size*sizeof(Uint8));
+	minimapDirtyBlocks = new Uint8[size>>(2*MINIMAP_BLOCK_SHIFT)];
+	minimapDirtyRows = new Uint8[h>>MINIMAP_BLOCK_SHIFT];
+	setMinimapDirty();
+	caseChangeBlocks = new Uint32[size>>(2*CHANGE_BLOCK_SHIFT)];
 	
 	#ifdef check_disorderable_gradient_error_probability
 	for (int i = 0; i < GT_SIZE; i++)
@@ -1104,32 +1154,44 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 
 	// We read what's inside the map:
 	stream->read(undermap, size, "undermap");
-	stream->readEnterSection("cases");
-	for (size_t i=0; i<size; i++)
+	if (versionMinor >= 84)
 	{
-		stream->readEnterSection(i);
-		mapDiscovered[i] = stream->readUint32("mapDiscovered");
-
-		cases[i].terrain = stream->readUint16("terrain");
-		cases[i].building = stream->readUint16("building");
-
-		stream->read(&(cases[i].ressource), 4, "ressource");
-		cases[i].groundUnit = stream->readUint16("groundUnit");
-		cases[i].airUnit = stream->readUint16("airUnit");
-		cases[i].forbidden = stream->readUint32("forbidden");
-		if(versionMinor < 62)
-			stream->readUint32("hiddenForbidden");
-		cases[i].guardArea = stream->readUint32("guardArea");
-		cases[i].clearArea = stream->readUint32("clearArea");
-		cases[i].scriptAreas = stream->readUint16("scriptAreas");
-		cases[i].canRessourcesGrow = stream->readUint8("canRessourcesGrow");
-		if(versionMinor >= 63)
-			cases[i].fertility = stream->readUint16("fertility");
-		fertilityMaximum = std::max(fertilityMaximum, cases[i].fertility);
-
+		if (!loadPlanes(stream))
+		{
+			fprintf(stderr, "Map:: Failed to load the content of the cases.\n");
+			return false;
+		}
+	}
+	else
+	{
+		stream->readEnterSection("cases");
+		for (size_t i=0; i<size; i++)
+		{
+			stream->readEnterSection(i);
+			mapDiscovered[i] = stream->readUint32("mapDiscovered");
+
+			cases[i].terrain = stream->readUint16("terrain");
+			cases[i].building = stream->readUint16("building");
+
+			stream->read(&(cases[i].ressource), 4, "ressource");
+			cases[i].groundUnit = stream->readUint16("groundUnit");
+			cases[i].airUnit = stream->readUint16("airUnit");
+			cases[i].forbidden = stream->readUint32("forbidden");
+			if(versionMinor < 62)
+				stream->readUint32("hiddenForbidden");
+			cases[i].guardArea = stream->readUint32("guardArea");
+			cases[i].clearArea = stream->readUint32("clearArea");
+			cases[i].scriptAreas = stream->readUint16("scriptAreas");
+			cases[i].canRessourcesGrow = stream->readUint8("canRessourcesGrow");
+			if(versionMinor >= 63)
+				cases[i].fertility = stream->readUint16("fertility");
+			fertilityMaximum = std::max(fertilityMaximum, cases[i].fertility);
+
+			stream->readLeaveSection();
+		}
 		stream->readLeaveSection();
 	}
-	stream->readLeaveSection();
+	resetCasesCheckSum();
 
 	for(int n=0; n<9; ++n)
 	{
@@ -1234,28 +1296,37 @@ void Map::save(GAGCore::OutputStream *stream)
 
 	// We write what's inside the map:
 	stream->write(undermap, size, "undermap");
-	stream->writeEnterSection("cases");
-	for (size_t i=0; i<size ;i++)
+	if (dynamic_cast<GAGCore::BinaryOutputStream*>(stream))
 	{
-		stream->writeEnterSection(i);
-		stream->writeUint32(mapDiscovered[i], "mapDiscovered");
+		savePlanes(stream);
+	}
+	else
+	{
+		// Text streams are only used for dumps, which are easier to read case by case.
+		// They are written in the old format and can't be loaded back.
+		stream->writeEnterSection("cases");
+		for (size_t i=0; i<size ;i++)
+		{
+			stream->writeEnterSection(i);
+			stream->writeUint32(mapDiscovered[i], "mapDiscovered");
 
-		stream->writeUint16(cases[i].terrain, "terrain");
-		stream->writeUint16(cases[i].building, "building");
-		
-		stream->write(&(cases[i].ressource), 4, "ressource");
-		
-		stream->writeUint16(cases[i].groundUnit, "groundUnit");
-		stream->writeUint16(cases[i].airUnit, "airUnit");
-		stream->writeUint32(cases[i].forbidden, "forbidden");
-		stream->writeUint32(cases[i].guardArea, "guardArea");
-		stream->writeUint32(cases[i].clearArea, "clearArea");
-		stream->writeUint16(cases[i].scriptAreas, "scriptAreas");
-		stream->writeUint8(cases[i].canRessourcesGrow, "canRessourcesGrow");
-		stream->writeUint16(cases[i].fertility, "fertility");
+			stream->writeUint16(cases[i].terrain, "terrain");
+			stream->writeUint16(cases[i].building, "building");
+			
+			stream->write(&(cases[i].ressource), 4, "ressource");
+			
+			stream->writeUint16(cases[i].groundUnit, "groundUnit");
+			stream->writeUint16(cases[i].airUnit, "airUnit");
+			stream->writeUint32(cases[i].forbidden, "forbidden");
+			stream->writeUint32(cases[i].guardArea, "guardArea");
+			stream->writeUint32(cases[i].clearArea, "clearArea");
+			stream->writeUint16(cases[i].scriptAreas, "scriptAreas");
+			stream->writeUint8(cases[i].canRessourcesGrow, "canRessourcesGrow");
+			stream->writeUint16(cases[i].fertility, "fertility");
+			stream->writeLeaveSection();
+		}
 		stream->writeLeaveSection();
 	}
-	stream->writeLeaveSection();
 
 	//Save area names
 	for(int n=0; n<9; ++n)
@@ -1281,6 +1352,165 @@ void Map::save(GAGCore::OutputStream *stream)
 	stream->writeLeaveSection();
 }
 
+// Planes are stored in little endian, whatever the platform
+template<typename T>
+static inline void storePlaneValue(Uint8 *&p, T v)
+{
+	for (size_t b=0; b<sizeof(T); b++)
+		*p++ = static_cast<Uint8>(v >> (8*b));
+}
+
+template<typename T>
+static inline T loadPlaneValue(const Uint8 *&p)
+{
+	T v = 0;
+	for (size_t b=0; b<sizeof(T); b++)
+		v |= static_cast<T>(*p++) << (8*b);
+	return v;
+}
+
+//! Write a plane as a single block, compressed if that makes it smaller
+static void writePlane(GAGCore::OutputStream *stream, const std::vector<Uint8> &plane, const char *name)
+{
+	uLongf compressedSize = compressBound(plane.size());
+	std::vector<Uint8> compressed(compressedSize);
+	if (compress2(&compressed[0], &compressedSize, &plane[0], plane.size(), Z_BEST_SPEED) == Z_OK && compressedSize < plane.size())
+	{
+		stream->writeUint8(1, "compressed");
+		stream->writeUint32(compressedSize, "size");
+		stream->write(&compressed[0], compressedSize, name);
+	}
+	else
+	{
+		stream->writeUint8(0, "compressed");
+		stream->writeUint32(plane.size(), "size");
+		stream->write(&plane[0], plane.size(), name);
+	}
+}
+
+//! Read a plane written by writePlane, which must be size bytes once uncompressed
+static bool readPlane(GAGCore::InputStream *stream, std::vector<Uint8> &plane, size_t size, const char *name)
+{
+	Uint8 compressed = stream->readUint8("compressed");
+	Uint32 storedSize = stream->readUint32("size");
+	// Maps are never empty, and there would be nothing to read into
+	if (size == 0 || storedSize == 0)
+		return false;
+	plane.resize(size);
+	if (!compressed)
+	{
+		if (storedSize != size)
+			return false;
+		stream->read(&plane[0], size, name);
+		return true;
+	}
+	if (storedSize > compressBound(size))
+		return false;
+	std::vector<Uint8> data(storedSize);
+	stream->read(&data[0], storedSize, name);
+	uLongf planeSize = size;
+	return uncompress(&plane[0], &planeSize, &data[0], storedSize) == Z_OK && planeSize == size;
+}
+
+template<typename T>
+static void writeCasePlane(GAGCore::OutputStream *stream, const Case *cases, size_t size, T Case::*field, const char *name)
+{
+	std::vector<Uint8> plane(size*sizeof(T));
+	Uint8 *p = &plane[0];
+	for (size_t i=0; i<size; i++)
+		storePlaneValue(p, cases[i].*field);
+	writePlane(stream, plane, name);
+}
+
+template<typename T>
+static bool readCasePlane(GAGCore::InputStream *stream, Case *cases, size_t size, T Case::*field, const char *name)
+{
+	std::vector<Uint8> plane;
+	if (!readPlane(stream, plane, size*sizeof(T), name))
+		return false;
+	const Uint8 *p = &plane[0];
+	for (size_t i=0; i<size; i++)
+		cases[i].*field = loadPlaneValue<T>(p);
+	return true;
+}
+
+void Map::savePlanes(GAGCore::OutputStream *stream)
+{
+	stream->writeEnterSection("planes");
+
+	std::vector<Uint8> plane(size*4);
+	Uint8 *p = &plane[0];
+	for (size_t i=0; i<size; i++)
+		storePlaneValue(p, mapDiscovered[i]);
+	writePlane(stream, plane, "mapDiscovered");
+
+	writeCasePlane(stream, cases, size, &Case::terrain, "terrain");
+	writeCasePlane(stream, cases, size, &Case::building, "building");
+
+	// The components of the ressources one after the other, they compress better than interleaved
+	for (size_t i=0; i<size; i++)
+	{
+		plane[i] = cases[i].ressource.type;
+		plane[size+i] = cases[i].ressource.variety;
+		plane[2*size+i] = cases[i].ressource.amount;
+		plane[3*size+i] = cases[i].ressource.animation;
+	}
+	writePlane(stream, plane, "ressource");
+
+	writeCasePlane(stream, cases, size, &Case::groundUnit, "groundUnit");
+	writeCasePlane(stream, cases, size, &Case::airUnit, "airUnit");
+	writeCasePlane(stream, cases, size, &Case::forbidden, "forbidden");
+	writeCasePlane(stream, cases, size, &Case::guardArea, "guardArea");
+	writeCasePlane(stream, cases, size, &Case::clearArea, "clearArea");
+	writeCasePlane(stream, cases, size, &Case::scriptAreas, "scriptAreas");
+	writeCasePlane(stream, cases, size, &Case::canRessourcesGrow, "canRessourcesGrow");
+	writeCasePlane(stream, cases, size, &Case::fertility, "fertility");
+
+	stream->writeLeaveSection();
+}
+
+bool Map::loadPlanes(GAGCore::InputStream *stream)
+{
+	stream->readEnterSection("planes");
+
+	std::vector<Uint8> plane;
+	if (!readPlane(stream, plane, size*4, "mapDiscovered"))
+		return false;
+	const Uint8 *p = &plane[0];
+	for (size_t i=0; i<size; i++)
+		mapDiscovered[i] = loadPlaneValue<Uint32>(p);
+
+	if (!readCasePlane(stream, cases, size, &Case::terrain, "terrain") ||
+		!readCasePlane(stream, cases, size, &Case::building, "building"))
+		return false;
+
+	if (!readPlane(stream, plane, size*4, "ressource"))
+		return false;
+	for (size_t i=0; i<size; i++)
+	{
+		cases[i].ressource.type = plane[i];
+		cases[i].ressource.variety = plane[size+i];
+		cases[i].ressource.amount = plane[2*size+i];
+		cases[i].ressource.animation = plane[3*size+i];
+	}
+
+	if (!readCasePlane(stream, cases, size, &Case::groundUnit, "groundUnit") ||
+		!readCasePlane(stream, cases, size, &Case::airUnit, "airUnit") ||
+		!readCasePlane(stream, cases, size, &Case::forbidden, "forbidden") ||
+		!readCasePlane(stream, cases, size, &Case::guardArea, "guardArea") ||
+		!readCasePlane(stream, cases, size, &Case::clearArea, "clearArea") ||
+		!readCasePlane(stream, cases, size, &Case::scriptAreas, "scriptAreas") ||
+		!readCasePlane(stream, cases, size, &Case::canRessourcesGrow, "canRessourcesGrow") ||
+		!readCasePlane(stream, cases, size, &Case::fertility, "fertility"))
+		return false;
+
+	for (size_t i=0; i<size; i++)
+		fertilityMaximum = std::max(fertilityMaximum, cases[i].fertility);
+
+	stream->readLeaveSection();
+	return true;
+}
+
 void Map::addTeam(void)
 {
 	int numberOfTeam=game->mapHeader.getNumberOfTeams();
@@ -1504,11 +1734,36 @@ void Map::syncStep(Uint32 stepCounter)
 
 void Map::switchFogOfWar(void)
 {
-	memset(fogOfWar, 0, size*sizeof(Uint32));
-	if (fogOfWar==fogOfWarA)
-		fogOfWar=fogOfWarB;
-	else
-		fogOfWar=fogOfWarA;
+	Uint32 *nextFogOfWar = (fogOfWar==fogOfWarA) ? fogOfWarB : fogOfWarA;
+	Uint8 *seenBlocks = (fogOfWar==fogOfWarA) ? fogOfWarBlocksA : fogOfWarBlocksB;
+	
+	// The squares are seen in both buffers, so the visible fog of war can only change where the
+	// current buffer was seen since it was cleared. Only these blocks are compared and cleared,
+	// and the ones where the fog changes are redrawn.
+	const int blockW = w>>MINIMAP_BLOCK_SHIFT;
+	const int blockH = h>>MINIMAP_BLOCK_SHIFT;
+	const int blockSize = 1<<MINIMAP_BLOCK_SHIFT;
+	for (int by=0; by<blockH; by++)
+		for (int bx=0; bx<blockW; bx++)
+		{
+			Uint8 &seen = seenBlocks[by*blockW+bx];
+			if (!seen)
+				continue;
+			seen = 0;
+			
+			bool changed = false;
+			for (int y=by<<MINIMAP_BLOCK_SHIFT; y<(by+1)<<MINIMAP_BLOCK_SHIFT; y++)
+			{
+				const size_t rowIndex = (y<<wDec)+(bx<<MINIMAP_BLOCK_SHIFT);
+				if (memcmp(fogOfWar+rowIndex, nextFogOfWar+rowIndex, blockSize*sizeof(Uint32)) != 0)
+					changed = true;
+				memset(fogOfWar+rowIndex, 0, blockSize*sizeof(Uint32));
+			}
+			if (changed)
+				setMinimapDirty(bx<<MINIMAP_BLOCK_SHIFT, by<<MINIMAP_BLOCK_SHIFT);
+		}
+	
+	fogOfWar=nextFogOfWar;
 }
 
 void Map::computeLocalForbidden(int localTeamNo)
@@ -1543,7 +1798,8 @@ void Map::computeLocalClearArea(int localTeamNo)
 
 void Map::decRessource(int x, int y)
 {
-	Ressource &r = getCase(x, y).ressource;
+	const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+	Ressource &r = cases[index].ressource;
 	
 	if (r.type == NO_RES_TYPE || r.amount == 0)
 		return;
@@ -1552,6 +1808,7 @@ void Map::decRessource(int x, int y)
 	
 	if (!fulltype->shrinkable)
 		return;
+	beginCaseChange(index);
 	if (fulltype->eternal)
 	{
 		if (r.amount > 0)
@@ -1560,10 +1817,14 @@ void Map::decRessource(int x, int y)
 	else
 	{
 		if (!fulltype->granular || r.amount<=1)
+		{
 			r.clear();
+			setMinimapDirty(x, y);
+		}
 		else
 			r.amount--;
 	}
+	endCaseChange(index);
 }
 
 void Map::decRessource(int x, int y, int ressourceType)
@@ -1574,7 +1835,8 @@ void Map::decRessource(int x, int y, int ressourceType)
 
 bool Map::incRessource(int x, int y, int ressourceType, int variety)
 {
-	Ressource &r = getCase(x, y).ressource;
+	const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+	Ressource &r = cases[index].ressource;
 	const RessourceType *fulltype;
 	incRessourceLog[0]++;
 	if (r.type == NO_RES_TYPE)
@@ -1590,10 +1852,13 @@ bool Map::incRessource(int x, int y, int ressourceType, int variety)
 		fulltype = globalContainer->ressourcesTypes.get(ressourceType);
 		if (getTerrainType(x, y) == fulltype->terrain)
 		{
+			beginCaseChange(index);
 			r.type = ressourceType;
 			r.variety = variety;
 			r.amount = 1;
 			r.animation = 0;
+			endCaseChange(index);
+			setMinimapDirty(x, y);
 			incRessourceLog[4]++;
 			return true;
 		}
@@ -1619,13 +1884,17 @@ bool Map::incRessource(int x, int y, int ressourceType, int variety)
 	if (r.amount < fulltype->sizesCount)
 	{
 		incRessourceLog[10]++;
+		beginCaseChange(index);
 		r.amount++;
+		endCaseChange(index);
 		return true;
 	}
 	else
 	{
 		incRessourceLog[11]++;
+		beginCaseChange(index);
 		r.amount--;
+		endCaseChange(index);
 	}
 	return false;
 }
@@ -2071,7 +2340,13 @@ void Map::setNoRessource(int x, int y, int l)
 	assert(l<h);
 	for (int dx=x-(l>>1); dx<x+(l>>1)+1; dx++)
 		for (int dy=y-(l>>1); dy<y+(l>>1)+1; dy++)
-			(cases+w*(dy&hMask)+(dx&wMask))->ressource.clear();
+		{
+			const size_t index = w*(dy&hMask)+(dx&wMask);
+			beginCaseChange(index);
+			cases[index].ressource.clear();
+			endCaseChange(index);
+		}
+	setMinimapDirty(x-(l>>1), y-(l>>1), l+1, l+1);
 }
 
 void Map::setRessource(int x, int y, int type, int l)
@@ -2083,14 +2358,18 @@ void Map::setRessource(int x, int y, int type, int l)
 		for (int dy=y-(l>>1); dy<y+(l>>1)+1; dy++)
 			if (isRessourceAllowed(dx, dy, type))
 			{
-				Ressource *rp=&((cases+w*(dy&hMask)+(dx&wMask))->ressource);
+				const size_t index = w*(dy&hMask)+(dx&wMask);
+				beginCaseChange(index);
+				Ressource *rp=&(cases[index].ressource);
 				rp->type=type;
 				RessourceType *rt=globalContainer->ressourcesTypes.get(type);
 				rp->variety=syncRand()%rt->varietiesCount;
 				assert(rt->sizesCount>1);
 				rp->amount=1+syncRand()%(rt->sizesCount-1);
 				rp->animation=0;
+				endCaseChange(index);
 			}
+	setMinimapDirty(x-(l>>1), y-(l>>1), l+1, l+1);
 }
 
 bool Map::isRessourceAllowed(int x, int y, int type)
@@ -2105,12 +2384,18 @@ bool Map::isPointSet(int n, int x, int y)
 
 void Map::setPoint(int n, int x, int y)
 {
-	getCase(x, y).scriptAreas |= 1<<n;
+	const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+	beginCaseChange(index);
+	cases[index].scriptAreas |= 1<<n;
+	endCaseChange(index);
 }
 
 void Map::unsetPoint(int n, int x, int y)
 {
-	getCase(x, y).scriptAreas ^= getCase(x, y).scriptAreas & (1<<n);
+	const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+	beginCaseChange(index);
+	cases[index].scriptAreas &= ~(1<<n);
+	endCaseChange(index);
 }
 
 std::string Map::getAreaName(int n)
@@ -2118,6 +2403,30 @@ std::string Map::getAreaName(int n)
 	return areaNames[n];
 }
 
+void Map::setMinimapDirty(int x, int y, int w, int h)
+{
+	// Step block by block, but always include the last column and row of the rect
+	const int blockSize = 1<<MINIMAP_BLOCK_SHIFT;
+	for (int dy=0; dy<h+blockSize; dy+=blockSize)
+	{
+		int yi = y + std::min(dy, h-1);
+		for (int dx=0; dx<w+blockSize; dx+=blockSize)
+			setMinimapDirty(x + std::min(dx, w-1), yi);
+	}
+}
+
+void Map::setMinimapDirty(void)
+{
+	memset(minimapDirtyBlocks, 1, size>>(2*MINIMAP_BLOCK_SHIFT));
+	memset(minimapDirtyRows, 1, h>>MINIMAP_BLOCK_SHIFT);
+}
+
+void Map::clearMinimapDirty(void)
+{
+	memset(minimapDirtyBlocks, 0, size>>(2*MINIMAP_BLOCK_SHIFT));
+	memset(minimapDirtyRows, 0, h>>MINIMAP_BLOCK_SHIFT);
+}
+
 void Map::setAreaName(int n, std::string name)
 {
 	areaNames[n]=name;
@@ -5145,24 +5454,34 @@ Uint16 Map::lookup(Uint8 tl, Uint8 tr, Uint8 bl, Uint8 br)
 	return terrainLookupTable[index][0]+(syncRand()%terrainLookupTable[index][1]);
 }
 
+Uint32 Map::computeCasesCheckSum(void) const
+{
+	Uint32 cs = 0;
+	for (size_t i=0; i<size; i++)
+		cs += caseCheckSum(i);
+	return cs;
+}
+
+void Map::resetCasesCheckSum(void)
+{
+	casesCheckSum = computeCasesCheckSum();
+	// Many cases changed at once, consider them all changed
+	std::fill(caseChangeBlocks, caseChangeBlocks + (size>>(2*CHANGE_BLOCK_SHIFT)), caseChangeStamp);
+}
+
 Uint32 Map::checkSum(bool heavy)
 {
 	Uint32 cs=size;
 	if (heavy)
 	{
-		const Case* end = cases + (w * h);
-		for (Case* c=cases; c < end; ++c)
+		// The sum is kept up to date as the cases change, going through the whole map is only done to check that
+		if (globalContainer->verifyCheckSums)
 		{
-			cs+=
-				c->terrain +
-				c->building +
-				c->ressource.getUint32() +
-				c->groundUnit +
-				c->airUnit +
-				c->forbidden +
-				c->scriptAreas;
-			cs=(cs<<1)|(cs>>31);
+			Uint32 expected = computeCasesCheckSum();
+			if (casesCheckSum != expected)
+				std::cerr << "Map::checkSum : the cases checksum is " << std::hex << casesCheckSum << " but should be " << expected << std::dec << ", a change of the cases was not accounted for" << std::endl;
 		}
+		cs+=casesCheckSum;
 	};
 	return cs;
 }
@@ -106,6 +106,12 @@ public:
 	bool load(GAGCore::InputStream *stream, MapHeader& header, Game *game=NULL);
 	//! Save a map
 	void save(GAGCore::OutputStream *stream);
+protected:
+	//! Save the content of the cases as one block per plane, used for binary streams since version 84
+	void savePlanes(GAGCore::OutputStream *stream);
+	//! Load the content of the cases saved by savePlanes
+	bool loadPlanes(GAGCore::InputStream *stream);
+public:
 	
 	// add & remove teams, used by the map editor and the random map generator
 	// Have to be called *after* session.numberOfTeam has been changed.
@@ -154,9 +160,14 @@ public:
 	void setMapDiscovered(int x, int y, Uint32 sharedVision)
 	{
 		size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		if (((mapDiscovered[index] & fogOfWar[index]) & sharedVision) != sharedVision)
+			setMinimapDirty(x, y);
 		mapDiscovered[index] |= sharedVision;
 		fogOfWarA[index] |= sharedVision;
 		fogOfWarB[index] |= sharedVision;
+		size_t block = (((y&hMask)>>MINIMAP_BLOCK_SHIFT)<<(wDec-MINIMAP_BLOCK_SHIFT))+((x&wMask)>>MINIMAP_BLOCK_SHIFT);
+		fogOfWarBlocksA[block] = 1;
+		fogOfWarBlocksB[block] = 1;
 	}
 
 	//! Set map to discovered state at rect (x, y, w, h) for all teams in sharedVision (mask).
@@ -179,7 +190,10 @@ public:
 			assert(id<Building::MAX_COUNT);
 			assert(team>=0);
 			assert(team<Team::MAX_COUNT);
-			teams[team]->myBuildings[id]->seenByMask|=sharedVision;
+			Building *building = teams[team]->myBuildings[id];
+			if ((building->seenByMask & sharedVision) != sharedVision)
+				setMinimapDirty(x, y);
+			building->seenByMask|=sharedVision;
 		}
 	}
 
@@ -212,6 +226,7 @@ public:
 	void unsetMapDiscovered(void)
 	{
 		memset(mapDiscovered, 0, w*h*sizeof(Uint32));
+		setMinimapDirty();
 	}
 
 	//! Returs true if map is discovered at position (x,y) for a given vision mask.
@@ -242,6 +257,7 @@ public:
 	void setMapDiscovered(void)
 	{
 		memset(mapDiscovered, ~0u, w*h*sizeof(Uint32));
+		setMinimapDirty();
 	}
 
 	//! Returs true if map is currently discovered at position (x,y) for a given vision mask.
@@ -359,23 +375,35 @@ public:
 	
 	void setTerrain(int x, int y, Uint16 terrain)
 	{
-		cases[((y&hMask)<<wDec)+(x&wMask)].terrain = terrain;
+		const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		beginCaseChange(index);
+		cases[index].terrain = terrain;
+		endCaseChange(index);
+		setMinimapDirty(x, y);
 	}
 	
 	void setForbidden(int x, int y, Uint32 forbidden)
 	{
-		cases[((y&hMask)<<wDec)+(x&wMask)].forbidden = forbidden;
+		setForbidden(((y&hMask)<<wDec)+(x&wMask), forbidden);
+	}
+	
+	void setForbidden(size_t index, Uint32 forbidden)
+	{
+		beginCaseChange(index);
+		cases[index].forbidden = forbidden;
+		endCaseChange(index);
 	}
 	
 	void addForbidden(int x, int y, Uint32 teamNum)
 	{
-		cases[((y&hMask)<<wDec)+(x&wMask)].forbidden |=  Team::teamNumberToMask(teamNum);
+		const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		setForbidden(index, cases[index].forbidden | Team::teamNumberToMask(teamNum));
 	}
 
 	void removeForbidden(int x, int y, Uint32 teamNum)
 	{
-		Case& c=cases[((y&hMask)<<wDec)+(x&wMask)];
-		c.forbidden ^= c.forbidden &  Team::teamNumberToMask(teamNum);
+		const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		setForbidden(index, cases[index].forbidden & ~Team::teamNumberToMask(teamNum));
 	}
 	
 	void addClearArea(int x, int y, Uint32 teamNum)
@@ -513,13 +541,33 @@ public:
 	Uint16 getAirUnit(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].airUnit; }
 	Uint16 getBuilding(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].building; }
 	
-	void setGroundUnit(int x, int y, Uint16 guid) { cases[((y&hMask)<<wDec)+(x&wMask)].groundUnit = guid; }
-	void setAirUnit(int x, int y, Uint16 guid) { cases[((y&hMask)<<wDec)+(x&wMask)].airUnit = guid; }
+	void setGroundUnit(int x, int y, Uint16 guid)
+	{
+		const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		beginCaseChange(index);
+		cases[index].groundUnit = guid;
+		endCaseChange(index);
+		setMinimapDirty(x, y);
+	}
+	void setAirUnit(int x, int y, Uint16 guid)
+	{
+		const size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		beginCaseChange(index);
+		cases[index].airUnit = guid;
+		endCaseChange(index);
+		setMinimapDirty(x, y);
+	}
 	void setBuilding(int x, int y, int w, int h, Uint16 gbid)
 	{
 		for (int yi=y; yi<y+h; yi++)
 			for (int xi=x; xi<x+w; xi++)
-				cases[((yi&hMask)<<wDec)+(xi&wMask)].building = gbid;
+			{
+				const size_t index = ((yi&hMask)<<wDec)+(xi&wMask);
+				beginCaseChange(index);
+				cases[index].building = gbid;
+				endCaseChange(index);
+			}
+		setMinimapDirty(x, y, w, h);
 	}
 	
 	//! Return sector at (x,y).
@@ -528,7 +576,7 @@ public:
 	Sector *getSector(int i) { assert(i>=0); assert(i<sizeSector); return sectors+i; }
 
 	//! Set undermap terrain type at (x,y) (undermap positions)
-	void setUMTerrain(int x, int y, TerrainType t) { undermap[((y&hMask)<<wDec)+(x&wMask)] = (Uint8)t; }
+	void setUMTerrain(int x, int y, TerrainType t) { undermap[((y&hMask)<<wDec)+(x&wMask)] = (Uint8)t; setMinimapDirty(x, y); }
 	//! Return undermap terrain type at (x,y)
 	TerrainType getUMTerrain(int x, int y) { return (TerrainType)undermap[((y&hMask)<<wDec)+(x&wMask)]; }
 	//! Set undermap terrain type at (x,y) (undermap positions) on an area
@@ -556,6 +604,67 @@ public:
 	///A vector holding the area names
 	std::vector<std::string> areaNames;
 	///@}
+
+	///The following tracks which parts of the map changed since the minimap last looked.
+	///The map is split in blocks of 2^MINIMAP_BLOCK_SHIFT squares, and every mutator that
+	///changes something the minimap shows (units, buildings, terrain, ressources, discovery
+	///and fog of war) marks the block it touched. Each row of blocks also has a flag, so
+	///that a minimap that finds nothing to redraw only looks at a few bytes.
+	///@{
+	enum { MINIMAP_BLOCK_SHIFT = 3 };
+	///Marks the block containing (x, y) as changed
+	void setMinimapDirty(int x, int y)
+	{
+		int bx = (x&wMask)>>MINIMAP_BLOCK_SHIFT;
+		int by = (y&hMask)>>MINIMAP_BLOCK_SHIFT;
+		minimapDirtyBlocks[(by<<(wDec-MINIMAP_BLOCK_SHIFT))+bx] = 1;
+		minimapDirtyRows[by] = 1;
+	}
+	///Marks all blocks intersecting rect (x, y, w, h) as changed
+	void setMinimapDirty(int x, int y, int w, int h);
+	///Marks the whole map as changed
+	void setMinimapDirty(void);
+	///Marks the whole map as unchanged
+	void clearMinimapDirty(void);
+	///Returns the number of blocks on x
+	int getMinimapBlockW(void) const { return w>>MINIMAP_BLOCK_SHIFT; }
+	///Returns the number of blocks on y
+	int getMinimapBlockH(void) const { return h>>MINIMAP_BLOCK_SHIFT; }
+	///Returns true and clears the flag if a block of row by changed
+	bool takeMinimapDirtyRow(int by)
+	{
+		if (!minimapDirtyRows[by])
+			return false;
+		minimapDirtyRows[by] = 0;
+		return true;
+	}
+	///Returns true and clears the flag if block (bx, by) changed
+	bool takeMinimapDirtyBlock(int bx, int by)
+	{
+		Uint8 &dirty = minimapDirtyBlocks[(by<<(wDec-MINIMAP_BLOCK_SHIFT))+bx];
+		if (!dirty)
+			return false;
+		dirty = 0;
+		return true;
+	}
+	///@}
+	
+	///The following tracks which parts of the map changed, for those who keep maps computed
+	///from the cases up to date, like the AIs. Every change of a case that goes through
+	///beginCaseChange and endCaseChange stamps its block of 2^CHANGE_BLOCK_SHIFT squares
+	///with caseChangeStamp. To know what changed since it last looked, one keeps the stamp
+	///returned by takeCaseChangeStamp and looks for the blocks stamped with it or later.
+	///@{
+	enum { CHANGE_BLOCK_SHIFT = 4 };
+	///Returns a new stamp, the changes from now on are stamped with it
+	Uint32 takeCaseChangeStamp(void) { return ++caseChangeStamp; }
+	///Returns true if a case of block (bx, by) changed since stamp was taken
+	bool hasBlockChangedSince(int bx, int by, Uint32 stamp) const { return caseChangeBlocks[(by<<(wDec-CHANGE_BLOCK_SHIFT))+bx] >= stamp; }
+	///Returns the number of blocks on x
+	int getChangeBlockW(void) const { return w>>CHANGE_BLOCK_SHIFT; }
+	///Returns the number of blocks on y
+	int getChangeBlockH(void) const { return h>>CHANGE_BLOCK_SHIFT; }
+	///@}
 	
 	//! Transform coordinate from map scale (mx,my) to pixel scale (px,py)
 	void mapCaseToPixelCase(int mx, int my, int *px, int *py) { *px=(mx<<5); *py=(my<<5); }
@@ -756,6 +865,8 @@ public:
 	Game *game;
 public:
 	Case *cases;
+	//! Sum of the caseCheckSum of all cases, kept up to date when the cases change so that the heavy checkSum does not have to go through the whole map
+	Uint32 casesCheckSum;
 	Sint32 w, h;
 	Sint32 wMask, hMask;
 	Sint32 wDec, hDec;
@@ -773,6 +884,8 @@ public:
 	bool arraysBuilt; // if true, the next pointers(arrays) have to be valid and filled.
 	Uint32 *mapDiscovered;
 	Uint32 *fogOfWar, *fogOfWarA, *fogOfWarB;
+	//! One byte per minimap block for each of fogOfWarA and fogOfWarB, 1 if a square of the block was seen since the buffer was cleared
+	Uint8 *fogOfWarBlocksA, *fogOfWarBlocksB;
 	//! true = forbidden
 	Utilities::BitArray localForbiddenMap;
 	//! true = guard area
@@ -828,6 +941,15 @@ protected:
 	Uint8 **listedAddr;
 	size_t size;
 
+	//! One byte per block of the map, 1 if the minimap has to redraw it
+	Uint8 *minimapDirtyBlocks;
+	//! One byte per row of blocks, 1 if any block of the row is dirty
+	Uint8 *minimapDirtyRows;
+	//! For each block of the map, the caseChangeStamp when one of its cases last changed
+	Uint32 *caseChangeBlocks;
+	//! The stamp given to the changes of the cases, increased by takeCaseChangeStamp
+	Uint32 caseChangeStamp;
+
 	Sector *sectors;
 	Sint32 wSector, hSector;
 	int sizeSector;
@@ -872,7 +994,37 @@ protected:
 	std::vector<int> astarExaminedPoints;
 
 public:
+	//! Return the checksum of the map, if heavy it includes the content of all cases, see casesCheckSum
 	Uint32 checkSum(bool heavy);
+	//! Return the checksum of the fields of the case at index that are checked for desynchronisation
+	Uint32 caseCheckSum(size_t index) const
+	{
+		const Case &c = cases[index];
+		Uint32 cs = c.terrain;
+		cs = cs*31 + c.building;
+		cs = cs*31 + c.ressource.getUint32();
+		cs = cs*31 + c.groundUnit;
+		cs = cs*31 + c.airUnit;
+		cs = cs*31 + c.forbidden;
+		cs = cs*31 + c.scriptAreas;
+		// mix with the position, so that moving things around changes the sum
+		cs ^= static_cast<Uint32>(index) * 2654435761u;
+		cs *= 0x85EBCA6Bu;
+		cs ^= cs >> 13;
+		return cs;
+	}
+	//! Must be called before changing a field of the case at index included in caseCheckSum
+	void beginCaseChange(size_t index) { casesCheckSum -= caseCheckSum(index); }
+	//! Must be called after having changed a field of the case at index included in caseCheckSum
+	void endCaseChange(size_t index)
+	{
+		casesCheckSum += caseCheckSum(index);
+		caseChangeBlocks[((index>>(wDec+CHANGE_BLOCK_SHIFT))<<(wDec-CHANGE_BLOCK_SHIFT)) + ((index&wMask)>>CHANGE_BLOCK_SHIFT)] = caseChangeStamp;
+	}
+	//! Compute the sum of the caseCheckSum of all cases, going through the whole map
+	Uint32 computeCasesCheckSum(void) const;
+	//! Recompute casesCheckSum from all cases, after many of them have been changed at once
+	void resetCasesCheckSum(void);
 	Sint32 warpDist1d(int p, int q, int l);///distance of coordinates p and q on a loop of length l
 	Sint32 warpDistSquare(int px, int py, int qx, int qy); //!< The distance^2 between (px, py) and (qx, qy), warp-safe.
 	Sint32 warpDistMax(int px, int py, int qx, int qy); //!< The max distance on x or y axis, between (px, py) and (qx, qy), warp-safe.
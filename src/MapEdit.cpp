@@ -3289,7 +3289,7 @@ void MapEdit::handleBrushClick(int mx, int my)
 				{
 					if (brushType == ForbiddenBrush)
 					{
-						game.map.getCase(x, y).forbidden |= (1<<team);
+						game.map.addForbidden(x, y, team);
 						game.map.localForbiddenMap.set(game.map.w*(y&game.map.hMask)+(x&game.map.wMask), true);
 					}
 					else if (brushType == GuardAreaBrush)
@@ -3314,7 +3314,7 @@ void MapEdit::handleBrushClick(int mx, int my)
 				{
 					if (brushType == ForbiddenBrush)
 					{
-						game.map.getCase(x, y).forbidden ^= game.map.getCase(x, y).forbidden & (1<<team);
+						game.map.removeForbidden(x, y, team);
 						game.map.localForbiddenMap.set(game.map.w*(y&game.map.hMask)+(x&game.map.wMask), false);
 					}
 					else if (brushType == GuardAreaBrush)
@@ -36,6 +36,7 @@ void MapHeader::reset()
 	numberOfTeams = 0;
 	mapName = "";
 	mapOffset = 0;
+	thumbnailOffset = 0;
 	isSavedGame=false;
 	resetGameSHA1();
 }
@@ -61,6 +62,10 @@ bool MapHeader::load(GAGCore::InputStream *stream)
 
 	numberOfTeams = stream->readSint32("numberOfTeams");
 	mapOffset = stream->readUint32("mapOffset");
+	if(versionMinor>=86)
+		thumbnailOffset = stream->readUint32("thumbnailOffset");
+	else
+		thumbnailOffset = 0;
 	isSavedGame = stream->readUint8("isSavedGame");
 	if(versionMinor==67)
 		stream->readUint32("checksum");
@@ -92,6 +97,7 @@ void MapHeader::save(GAGCore::OutputStream *stream) const
 	stream->writeSint32(VERSION_MINOR, "versionMinor");
 	stream->writeSint32(numberOfTeams, "numberOfTeams");
 	stream->writeUint32(mapOffset, "mapOffset");
+	stream->writeUint32(thumbnailOffset, "thumbnailOffset");
 	stream->writeUint8(isSavedGame, "isSavedGame");
 	stream->write(SHA1, 20, "SHA1");
 	stream->writeEnterSection("teams");
@@ -177,6 +183,20 @@ void MapHeader::setMapOffset(Uint32 newMapOffset)
 
 
 
+Uint32 MapHeader::getThumbnailOffset() const
+{
+	return thumbnailOffset;
+}
+
+
+
+void MapHeader::setThumbnailOffset(Uint32 newThumbnailOffset)
+{
+	thumbnailOffset = newThumbnailOffset;
+}
+
+
+
 BaseTeam& MapHeader::getBaseTeam(const int n)
 {
 	assert(n>=0 && n<Team::MAX_COUNT);
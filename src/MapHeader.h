@@ -79,6 +79,15 @@ public:
 	/// *overwritten* after the offset has been found.
 	void setMapOffset(Uint32 mapOffset);
 
+	/// Returns the offset of the precomputed MapThumbnail in the
+	/// file, or 0 if there is none. Map choosers read it there
+	/// instead of loading the whole map.
+	Uint32 getThumbnailOffset() const;
+
+	/// Sets the thumbnail offset. Like the map offset, it is only
+	/// known once the game has been saved.
+	void setThumbnailOffset(Uint32 thumbnailOffset);
+
 	/// Returns the base team for team n. n must be between 0 and 31
 	BaseTeam& getBaseTeam(const int n);
 	const  BaseTeam& getBaseTeam(const int n) const;
@@ -116,6 +125,8 @@ private:
 	/// and is used to generate Map previews without loading
 	/// the complete file.
 	Uint32 mapOffset;
+	/// The offset of the MapThumbnail in the save, or 0 if there is none
+	Uint32 thumbnailOffset;
 	
 	/// The teams in the map. BaseTeam is used to allow access to information like team numbers and
 	/// team colors without loading the entire game.
@@ -0,0 +1,183 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <BinaryStream.h>
+#include <FileManager.h>
+#include <Stream.h>
+#include <StreamBackend.h>
+#include <Toolkit.h>
+#include "MapHeaderCache.h"
+#include "Version.h"
+#include <iostream>
+#include <vector>
+
+using namespace GAGCore;
+
+MapHeaderCache::MapHeaderCache(const std::string& cacheFileName)
+	: cacheFileName(cacheFileName), modified(false)
+{
+	load();
+}
+
+
+
+MapHeaderCache::~MapHeaderCache()
+{
+	if (modified)
+		save();
+}
+
+
+
+bool MapHeaderCache::get(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail)
+{
+	Uint32 mtime = Toolkit::getFileManager()->mtime(fileName);
+	std::map<std::string, Entry>::iterator i = entries.find(fileName);
+	if (i == entries.end() || i->second.mtime != mtime)
+	{
+		// Read the header from the file, and keep it as it is there
+		InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(fileName));
+		if (stream->isEndOfStream())
+		{
+			delete stream;
+			return false;
+		}
+		MapHeader fileHeader;
+		bool good = fileHeader.load(stream);
+		size_t headerSize = stream->getPosition();
+		if (!good || !stream->canSeek())
+		{
+			delete stream;
+			return false;
+		}
+		std::vector<char> headerData(headerSize);
+		stream->seekFromStart(0);
+		stream->read(&headerData[0], headerSize, "header");
+		delete stream;
+
+		MapThumbnail fileThumbnail;
+		fileThumbnail.loadFromMap(fileName);
+		MemoryStreamBackend *thumbnailBackend = new MemoryStreamBackend();
+		OutputStream *thumbnailStream = new BinaryOutputStream(thumbnailBackend);
+		fileThumbnail.encodeData(thumbnailStream);
+
+		Entry entry;
+		entry.mtime = mtime;
+		entry.header.assign(&headerData[0], headerSize);
+		entry.thumbnail.assign(thumbnailBackend->getBuffer(), thumbnailStream->getPosition());
+		delete thumbnailStream;
+
+		entries[fileName] = entry;
+		i = entries.find(fileName);
+		modified = true;
+	}
+
+	// The backends are filled with the data, they must be read from its start
+	MemoryStreamBackend *headerBackend = new MemoryStreamBackend(i->second.header.data(), i->second.header.size());
+	headerBackend->seekFromStart(0);
+	InputStream *headerStream = new BinaryInputStream(headerBackend);
+	bool good = header.load(headerStream);
+	delete headerStream;
+	if (!good)
+		return false;
+
+	MemoryStreamBackend *thumbnailBackend = new MemoryStreamBackend(i->second.thumbnail.data(), i->second.thumbnail.size());
+	thumbnailBackend->seekFromStart(0);
+	InputStream *thumbnailStream = new BinaryInputStream(thumbnailBackend);
+	thumbnail.decodeData(thumbnailStream, VERSION_MINOR);
+	delete thumbnailStream;
+	return true;
+}
+
+
+
+void MapHeaderCache::load()
+{
+	entries.clear();
+	InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(cacheFileName));
+	if (stream->isEndOfStream())
+	{
+		delete stream;
+		return;
+	}
+
+	// The thumbnails are encoded with the current version, older caches are rebuilt
+	Uint32 versionMinor = stream->readUint32("versionMinor");
+	if (versionMinor != VERSION_MINOR)
+	{
+		delete stream;
+		return;
+	}
+
+	Uint32 count = stream->readUint32("count");
+	for (Uint32 n = 0; n < count && !stream->isEndOfStream(); n++)
+	{
+		std::string fileName = stream->readText("fileName");
+		Entry entry;
+		entry.mtime = stream->readUint32("mtime");
+		Uint32 headerSize = stream->readUint32("headerSize");
+		Uint32 thumbnailSize = stream->readUint32("thumbnailSize");
+		if (headerSize == 0 || thumbnailSize == 0 || headerSize > 1<<20 || thumbnailSize > 1<<20)
+			break;
+		std::vector<char> data(headerSize + thumbnailSize);
+		stream->read(&data[0], data.size(), "data");
+		if (stream->isEndOfStream())
+			break;
+		entry.header.assign(&data[0], headerSize);
+		entry.thumbnail.assign(&data[headerSize], thumbnailSize);
+		entries[fileName] = entry;
+	}
+	delete stream;
+}
+
+
+
+void MapHeaderCache::save()
+{
+	// Forget the files that have been removed
+	for (std::map<std::string, Entry>::iterator i = entries.begin(); i != entries.end();)
+	{
+		if (Toolkit::getFileManager()->mtime(i->first) == 0)
+			entries.erase(i++);
+		else
+			++i;
+	}
+
+	OutputStream *stream = new BinaryOutputStream(Toolkit::getFileManager()->openOutputStreamBackend(cacheFileName));
+	if (!stream->isValid())
+	{
+		std::cerr << "MapHeaderCache::save : can't write " << cacheFileName << std::endl;
+		delete stream;
+		return;
+	}
+
+	stream->writeUint32(VERSION_MINOR, "versionMinor");
+	stream->writeUint32(entries.size(), "count");
+	for (std::map<std::string, Entry>::iterator i = entries.begin(); i != entries.end(); ++i)
+	{
+		stream->writeText(i->first, "fileName");
+		stream->writeUint32(i->second.mtime, "mtime");
+		stream->writeUint32(i->second.header.size(), "headerSize");
+		stream->writeUint32(i->second.thumbnail.size(), "thumbnailSize");
+		stream->write(i->second.header.data(), i->second.header.size(), "header");
+		stream->write(i->second.thumbnail.data(), i->second.thumbnail.size(), "thumbnail");
+	}
+	delete stream;
+	modified = false;
+}
@@ -0,0 +1,67 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __MAPHEADERCACHE_H
+#define __MAPHEADERCACHE_H
+
+#include <map>
+#include <string>
+#include "MapHeader.h"
+#include "MapThumbnail.h"
+
+///This keeps the headers and thumbnails of the maps, games and replays shown by map choosers in
+///a file, so that they don't have to be read from the files each time they are selected. The
+///entries are keyed by file name, and read again from the file when its modification time changed.
+class MapHeaderCache
+{
+public:
+	///Loads the cache from the given file
+	MapHeaderCache(const std::string& cacheFileName="headers.cache");
+
+	///Saves the cache if it has been modified
+	~MapHeaderCache();
+
+	///Gets the header and thumbnail of the given file, from the cache or from the file.
+	///Returns false if the file is not a valid map, game or replay
+	bool get(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail);
+
+	///Saves the cache, without the entries of the files that don't exist anymore
+	void save();
+
+private:
+	///Loads the cache
+	void load();
+
+	///The cached header and thumbnail of a file
+	struct Entry
+	{
+		///The modification time of the file when it was read
+		Uint32 mtime;
+		///The header, as it is in the file
+		std::string header;
+		///The thumbnail, as encoded by MapThumbnail::encodeData
+		std::string thumbnail;
+	};
+
+	std::string cacheFileName;
+	std::map<std::string, Entry> entries;
+	bool modified;
+};
+
+#endif
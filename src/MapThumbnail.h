@@ -32,6 +32,8 @@ namespace GAGCore
 	class InputStream;
 };
 
+class Map;
+
 ///This class encapsulates everything about map thumbnails, which are shown when choosing a map before you start a game
 class MapThumbnail
 {
@@ -39,8 +41,12 @@ public:
 	///Constructs a thumbnail
 	MapThumbnail();
 	
-	///Loads the thumbnail from the map with the given map name
+	///Loads the thumbnail from the map with the given map name. If the map file has a precomputed
+	///thumbnail, only its header and the thumbnail are read, otherwise the whole map is loaded
 	void loadFromMap(const std::string& map);
+
+	///Computes the thumbnail of the given map
+	void computeFromMap(Map& map);
 	
 	///Encodes this thumbnail into a stream
 	void encodeData(GAGCore::OutputStream* stream) const;
@@ -30,6 +30,21 @@
 
 using namespace GAGCore;
 
+static const int terrainColor[3][3] = {
+	{ 0, 40, 120 }, // Water
+	{ 170, 170, 0 }, // Sand
+	{ 0, 90, 0 }, // Grass
+};
+
+static const int buildingsUnitsColor[6][3] = {
+	{ 10, 240, 20 }, // self
+	{ 220, 200, 20 }, // ally
+	{ 220, 25, 30 }, // enemy
+	{ (10*3)/5, (240*3)/5, (20*3)/5 }, // self FOW
+	{ (220*3)/5, (200*3)/5, (20*3)/5 }, // ally FOW
+	{ (220*3)/5, (25*3)/5, (30*3)/5 }, // enemy FOW
+};
+
 
 // Creates a minimap of specified values
 // nox - no graphics
@@ -45,8 +60,13 @@ Minimap::Minimap(bool nox, int menuWidth, int gameWidth, int xOffset, int yOffse
 {
 	if (nox) return;
 
-  // since the update loop goes by row store that row so we gan draw the gray "radar" line 
-	update_row = -1;
+	// the first draw renders everything, later ones only what changed on the map
+	fullRefresh = true;
+	lastLocalTeam = -1;
+	lastVisibleTeams = 0;
+	lastAllies = 0;
+	lastMiniW = 0;
+	lastMiniH = 0;
 	// The actual minimap picture to be drawn to.
 	surface=new DrawableSurface(width, height);
 }
@@ -108,26 +128,32 @@ void Minimap::draw(int localteam, int viewportX, int viewportY, int viewportW, i
 	offset_x = game->teams[localteam]->startPosX - game->map.getW() / 2;
 	offset_y = game->teams[localteam]->startPosY - game->map.getH() / 2;
 
-	///What row the scan-line ("radar") is to be drawn at
-	int line_row = 0;
+	// anything that changes the color of every pixel requires a full redraw
+	Uint32 visibleTeams = game->teams[localteam]->me;
+	if (globalContainer->replaying) visibleTeams = globalContainer->replayVisibleTeams;
+	Uint32 allies = game->teams[localteam]->allies;
+	if (localteam != lastLocalTeam || visibleTeams != lastVisibleTeams || allies != lastAllies
+		|| mini_w != lastMiniW || mini_h != lastMiniH)
+		fullRefresh = true;
 
 	//Render the colorMap and blit the surface
-	if(update_row == -1)
+	if(fullRefresh)
 	{
 	  // clear the minimap by drawing a black rect over it
 		surface->drawFilledRect(0, 0, width, height, 0, 0, 0, Color::ALPHA_OPAQUE);
-		update_row = 0;
+		game->map.clearMinimapDirty();
 		refreshPixelRows(0, mini_h, localteam);
+		fullRefresh = false;
+		lastLocalTeam = localteam;
+		lastVisibleTeams = visibleTeams;
+		lastAllies = allies;
+		lastMiniW = mini_w;
+		lastMiniH = mini_h;
 	}
 	else
 	{
-		///Render 1/25th of the rows at a time
-		const int rows_to_render = std::max(1, mini_h/25);
-		
-		refreshPixelRows(update_row, (update_row + rows_to_render) % (mini_h), localteam);
-		update_row += rows_to_render;
-		update_row %= (mini_h);
-		line_row = update_row;
+		// only redraw the parts of the map that changed since last frame
+		refreshDirtyBlocks(localteam);
 	}
 	//Draw the surface
 	globalContainer->gfx->drawSurface(gameWidth-menuWidth+xOffset, yOffset, surface);
@@ -159,10 +185,6 @@ void Minimap::draw(int localteam, int viewportX, int viewportY, int viewportW, i
 	///The lines are out of alignment, so a single pixel in the bottom right hand of the square
 	///is never drawn
 	globalContainer->gfx->drawPixel(endx, endy, 255, 255, 255);
-
-	///Draw the line that shows where the minimap is currently updating
-	if(minimapMode == HideFOW)
-		globalContainer->gfx->drawHorzLine(mini_x, mini_y + line_row , mini_w, 100, 100, 100);
 	
 	///Draw a 1 pixel border arround the minimap
 	globalContainer->gfx->drawRect(gameWidth-menuWidth+xOffset-1,
@@ -212,13 +234,15 @@ void Minimap::convertToScreen(int nx, int ny, int& x, int& y)
 
 void Minimap::resetMinimapDrawing()
 {
-	update_row = -1;
+	fullRefresh = true;
 }
 
 
 
 void Minimap::setMinimapMode(MinimapMode mode)
 {
+	if (mode != minimapMode)
+		fullRefresh = true;
 	minimapMode = mode;
 }
 
@@ -274,32 +298,89 @@ void Minimap::refreshPixelRows(int start, int end, int localteam)
 
 
 
+void Minimap::refreshDirtyBlocks(int localteam)
+{
+	if (noX) return;
+
+	Map& map = game->map;
+	const int blockSize = 1<<Map::MINIMAP_BLOCK_SHIFT;
+	for (int by=0; by<map.getMinimapBlockH(); by++)
+	{
+		if (!map.takeMinimapDirtyRow(by))
+			continue;
+		
+		int y = map.normalizeY((by<<Map::MINIMAP_BLOCK_SHIFT) - offset_y);
+		int hFirst = std::min(blockSize, map.getH() - y);
+		for (int bx=0; bx<map.getMinimapBlockW(); bx++)
+		{
+			if (!map.takeMinimapDirtyBlock(bx, by))
+				continue;
+			
+			// The minimap is centered on the team start, so a block may wrap arround its sides
+			int x = map.normalizeX((bx<<Map::MINIMAP_BLOCK_SHIFT) - offset_x);
+			int wFirst = std::min(blockSize, map.getW() - x);
+			refreshMapRect(x, y, wFirst, hFirst, localteam);
+			if (wFirst < blockSize)
+				refreshMapRect(0, y, blockSize - wFirst, hFirst, localteam);
+			if (hFirst < blockSize)
+				refreshMapRect(x, 0, wFirst, blockSize - hFirst, localteam);
+			if ((wFirst < blockSize) && (hFirst < blockSize))
+				refreshMapRect(0, 0, blockSize - wFirst, blockSize - hFirst, localteam);
+		}
+	}
+}
+
+
+
+void Minimap::refreshMapRect(int x, int y, int w, int h, int localteam)
+{
+	if (noX) return;
+
+	const int dMx = ((game->map.getW())<<16) / (mini_w);
+	const int dMy = ((game->map.getH())<<16) / (mini_h);
+
+	// Pixel d covers the map squares from dM*d to dM*(d+1) in fixed-point,
+	// so take one pixel more on each side to be sure to cover the rect
+	int startX = std::max(0, ((x<<16) / dMx) - 1);
+	int endX = std::min(mini_w - 1, ((x+w)<<16) / dMx);
+	int startY = std::max(0, ((y<<16) / dMy) - 1);
+	int endY = std::min(mini_h - 1, ((y+h)<<16) / dMy);
+
+	for (int dy=startY; dy<=endY; dy++)
+		for (int dx=startX; dx<=endX; dx++)
+			computeColor(dx, dy, localteam);
+
+	// The last pixel of a row or column can reach the first square of the map
+	if (x == 0)
+		for (int dy=startY; dy<=endY; dy++)
+			computeColor(mini_w - 1, dy, localteam);
+	if (y == 0)
+		for (int dx=startX; dx<=endX; dx++)
+			computeColor(dx, mini_h - 1, localteam);
+}
+
+
+
 void Minimap::computeColors(int row, int localTeam)
 {
 	if (noX) return;
 
+	for (int dx=0; dx<mini_w; dx++)
+		computeColor(dx, row, localTeam);
+}
+
+
+
+void Minimap::computeColor(int dx, int dy, int localTeam)
+{
+	if (noX) return;
+
 	assert(localTeam>=0);
 	assert(localTeam<Team::MAX_COUNT);
 
-	const int terrainColor[3][3] = {
-		{ 0, 40, 120 }, // Water
-		{ 170, 170, 0 }, // Sand
-		{ 0, 90, 0 }, // Grass
-	};
-
-	const int buildingsUnitsColor[6][3] = {
-		{ 10, 240, 20 }, // self
-		{ 220, 200, 20 }, // ally
-		{ 220, 25, 30 }, // enemy
-		{ (10*3)/5, (240*3)/5, (20*3)/5 }, // self FOW
-		{ (220*3)/5, (200*3)/5, (20*3)/5 }, // ally FOW
-		{ (220*3)/5, (25*3)/5, (30*3)/5 }, // enemy FOW
-	};
-
 	int pcol[3+MAX_RESSOURCES];
 
 	// get data
-	int szX = mini_w;
 	int decX = mini_offset_x, decY = mini_offset_y;
 
 	// Variables for traversing each map square within a minimap square.
@@ -312,124 +393,118 @@ void Minimap::computeColors(int row, int localTeam)
 	Uint32 visibleTeams = game->teams[localTeam]->me;
 	if (globalContainer->replaying) visibleTeams = globalContainer->replayVisibleTeams;
 
-	const int dy = row;
-	for (int dx=0; dx<szX; dx++)
-	{
-		memset(pcol, 0, sizeof(pcol));
-		int nCount = 0;
-		int UnitOrBuildingIndex = -1;
-		
-		// compute
-		for (int minidyFP=dMy*dy+decSPY; minidyFP<=(dMy*(dy+1))+decSPY; minidyFP+=(1<<16)) { // Fixed-point numbers
-			int minidy = minidyFP>>16;
-			for (int minidxFP=dMx*dx+decSPX; minidxFP<=(dMx*(dx+1))+decSPX; minidxFP+=(1<<16)) // Fixed-point numbers
-			{
-				int minidx = minidxFP>>16;
-				bool seenUnderFOW = false;
+	memset(pcol, 0, sizeof(pcol));
+	int nCount = 0;
+	int UnitOrBuildingIndex = -1;
+	
+	// compute
+	for (int minidyFP=dMy*dy+decSPY; minidyFP<=(dMy*(dy+1))+decSPY; minidyFP+=(1<<16)) { // Fixed-point numbers
+		int minidy = minidyFP>>16;
+		for (int minidxFP=dMx*dx+decSPX; minidxFP<=(dMx*(dx+1))+decSPX; minidxFP+=(1<<16)) // Fixed-point numbers
+		{
+			int minidx = minidxFP>>16;
+			bool seenUnderFOW = false;
 
-				Uint16 gid=game->map.getAirUnit(minidx, minidy);
-				if (gid==NOGUID)
-					gid=game->map.getGroundUnit(minidx, minidy);
-				if (gid==NOGUID)
-				{
-					gid=game->map.getBuilding(minidx, minidy);
-					if (gid!=NOGUID)
-					{
-						if (game->teams[Building::GIDtoTeam(gid)]->myBuildings[Building::GIDtoID(gid)]->seenByMask & visibleTeams)
-						{
-							seenUnderFOW = true;
-						}
-					}
-				}
+			Uint16 gid=game->map.getAirUnit(minidx, minidy);
+			if (gid==NOGUID)
+				gid=game->map.getGroundUnit(minidx, minidy);
+			if (gid==NOGUID)
+			{
+				gid=game->map.getBuilding(minidx, minidy);
 				if (gid!=NOGUID)
 				{
-					int teamId=gid/Unit::MAX_COUNT;
-					if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
-					{
-						if (teamId==localTeam)
-							UnitOrBuildingIndex = 0;
-						else if ((game->teams[localTeam]->allies) & visibleTeams)
-							UnitOrBuildingIndex = 1;
-						else
-							UnitOrBuildingIndex = 2;
-						goto unitOrBuildingFound;
-					}
-					else if (seenUnderFOW)
+					if (game->teams[Building::GIDtoTeam(gid)]->myBuildings[Building::GIDtoID(gid)]->seenByMask & visibleTeams)
 					{
-						if (teamId==localTeam)
-							UnitOrBuildingIndex = 3;
-						else if ((game->teams[localTeam]->allies) & visibleTeams)
-							UnitOrBuildingIndex = 4;
-						else
-							UnitOrBuildingIndex = 5;
-						goto unitOrBuildingFound;
+						seenUnderFOW = true;
 					}
 				}
-				
-				if (useMapDiscovered || game->map.isMapDiscovered(minidx, minidy, visibleTeams))
+			}
+			if (gid!=NOGUID)
+			{
+				int teamId=gid/Unit::MAX_COUNT;
+				if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
 				{
-					// get color to add
-					int pcolIndex;
-					Ressource r=game->map.getRessource(minidx, minidy);
-					if (r.type!=NO_RES_TYPE)
-					{
-						pcolIndex=r.type + 3;
-					}
+					if (teamId==localTeam)
+						UnitOrBuildingIndex = 0;
+					else if ((game->teams[localTeam]->allies) & visibleTeams)
+						UnitOrBuildingIndex = 1;
 					else
-					{
-						pcolIndex=game->map.getUMTerrain(minidx,minidy);
-					}
-					
-					// get weight to add
-					int pcolAddValue;
-					if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
-						pcolAddValue=5;
+						UnitOrBuildingIndex = 2;
+					goto unitOrBuildingFound;
+				}
+				else if (seenUnderFOW)
+				{
+					if (teamId==localTeam)
+						UnitOrBuildingIndex = 3;
+					else if ((game->teams[localTeam]->allies) & visibleTeams)
+						UnitOrBuildingIndex = 4;
 					else
-						pcolAddValue=3;
-
-					pcol[pcolIndex]+=pcolAddValue;
+						UnitOrBuildingIndex = 5;
+					goto unitOrBuildingFound;
 				}
-
-				nCount++;
 			}
+			
+			if (useMapDiscovered || game->map.isMapDiscovered(minidx, minidy, visibleTeams))
+			{
+				// get color to add
+				int pcolIndex;
+				Ressource r=game->map.getRessource(minidx, minidy);
+				if (r.type!=NO_RES_TYPE)
+				{
+					pcolIndex=r.type + 3;
+				}
+				else
+				{
+					pcolIndex=game->map.getUMTerrain(minidx,minidy);
+				}
+				
+				// get weight to add
+				int pcolAddValue;
+				if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
+					pcolAddValue=5;
+				else
+					pcolAddValue=3;
+
+				pcol[pcolIndex]+=pcolAddValue;
+			}
+
+			nCount++;
 		}
+	}
 
-		// Yes I know, this is *ugly*, but this piece of code *needs* speedup
-		unitOrBuildingFound:
+	// Yes I know, this is *ugly*, but this piece of code *needs* speedup
+	unitOrBuildingFound:
 
-		int r, g, b;
-		if (UnitOrBuildingIndex >= 0)
+	int r, g, b;
+	if (UnitOrBuildingIndex >= 0)
+	{
+		r = buildingsUnitsColor[UnitOrBuildingIndex][0];
+		g = buildingsUnitsColor[UnitOrBuildingIndex][1];
+		b = buildingsUnitsColor[UnitOrBuildingIndex][2];
+	}
+	else
+	{
+		nCount*=5;
+
+		int lr, lg, lb;
+		lr = lg = lb = 0;
+		for (int i=0; i<3; i++)
 		{
-			r = buildingsUnitsColor[UnitOrBuildingIndex][0];
-			g = buildingsUnitsColor[UnitOrBuildingIndex][1];
-			b = buildingsUnitsColor[UnitOrBuildingIndex][2];
-			UnitOrBuildingIndex = -1;
+			lr += pcol[i]*terrainColor[i][0];
+			lg += pcol[i]*terrainColor[i][1];
+			lb += pcol[i]*terrainColor[i][2];
 		}
-		else
+		for (int i=0; i<MAX_RESSOURCES; i++)
 		{
-			nCount*=5;
-
-			int lr, lg, lb;
-			lr = lg = lb = 0;
-			for (int i=0; i<3; i++)
-			{
-				lr += pcol[i]*terrainColor[i][0];
-				lg += pcol[i]*terrainColor[i][1];
-				lb += pcol[i]*terrainColor[i][2];
-			}
-			for (int i=0; i<MAX_RESSOURCES; i++)
-			{
-				RessourceType *rt = globalContainer->ressourcesTypes.get(i);
-				lr += pcol[i+3]*(rt->minimapR);
-				lg += pcol[i+3]*(rt->minimapG);
-				lb += pcol[i+3]*(rt->minimapB);
-			}
-
-			r = lr/nCount;
-			g = lg/nCount;
-			b = lb/nCount;
+			RessourceType *rt = globalContainer->ressourcesTypes.get(i);
+			lr += pcol[i+3]*(rt->minimapR);
+			lg += pcol[i+3]*(rt->minimapG);
+			lb += pcol[i+3]*(rt->minimapB);
 		}
-		surface->drawPixel(dx+decX, dy+decY, r, g, b, Color::ALPHA_OPAQUE);
+
+		r = lr/nCount;
+		g = lg/nCount;
+		b = lb/nCount;
 	}
+	surface->drawPixel(dx+decX, dy+decY, r, g, b, Color::ALPHA_OPAQUE);
 }
-
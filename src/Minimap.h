@@ -76,8 +76,18 @@ private:
 	///Refreshes a range of rows on the screen, handles wrapping
 	void refreshPixelRows(int start, int end, int localteam);
 
+	///Refreshes the pixels covering the map blocks that changed since the last call
+	void refreshDirtyBlocks(int localteam);
+
+	///Refreshes the pixels covering the map rect (x, y, w, h), given relative to
+	///offset_x and offset_y and not wrapping
+	void refreshMapRect(int x, int y, int w, int h, int localteam);
+
 	/// Computes the colors for positions in the given row
 	void computeColors(int row, int localteam);
+
+	/// Computes the color of the pixel at (dx, dy) of the minimap
+	void computeColor(int dx, int dy, int localteam);
 	
 	bool noX;
 	int menuWidth;
@@ -86,7 +96,14 @@ private:
 	int yOffset;
 	int width;
 	int height;
-	int update_row;
+	///True when the whole minimap must be redrawn on the next draw
+	bool fullRefresh;
+	///The parameters the minimap was last drawn with, a change needs a full redraw
+	int lastLocalTeam;
+	Uint32 lastVisibleTeams;
+	Uint32 lastAllies;
+	int lastMiniW;
+	int lastMiniH;
 	int offset_x;
 	int offset_y;
 	int mini_x;
@@ -527,6 +527,14 @@ void MultiplayerGame::recieveMessage(boost::shared_ptr<NetMessage> message)
 			netEngine->pushOrder(order, order->sender, false);
 		}
 	}
+	if(type==MNetSendCheckSumHistory)
+	{
+		if(netEngine)
+		{
+			shared_ptr<NetSendCheckSumHistory> info = static_pointer_cast<NetSendCheckSumHistory>(message);
+			netEngine->pushCheckSumHistory(info);
+		}
+	}
 	if(type==MNetRequestFile)
 	{
 		boost::shared_ptr<YOGClientFileAssembler> assembler(new YOGClientFileAssembler(client, fileID));
@@ -245,6 +245,31 @@ bool NetEngine::matchCheckSums()
 
 
 
+void NetEngine::sendCheckSumHistory(Uint8 part, const std::vector<Uint32>& values)
+{
+	if(router)
+	{
+		shared_ptr<NetSendCheckSumHistory> message(new NetSendCheckSumHistory(localPlayer, part, values));
+		router->sendMessage(message);
+	}
+}
+
+
+
+void NetEngine::pushCheckSumHistory(boost::shared_ptr<NetSendCheckSumHistory> history)
+{
+	checkSumHistories.push_back(history);
+}
+
+
+
+const std::vector<boost::shared_ptr<NetSendCheckSumHistory> >& NetEngine::getCheckSumHistories()
+{
+	return checkSumHistories;
+}
+
+
+
 void NetEngine::increaseLatencyAdjustment()
 {
 	boost::shared_ptr<AdjustLatency> latency(new AdjustLatency(currentLatency+1));
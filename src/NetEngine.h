@@ -25,6 +25,8 @@
 #include <queue>
 #include "NetConnection.h"
 
+class NetSendCheckSumHistory;
+
 ///The purpose of this class is to sort Orders, and hand them out in
 ///the correct time slot. It serves partially to hide latency, Orders
 ///are set to execute a fixed number of ticks ahead, and this class
@@ -86,6 +88,16 @@ public:
 	
 	///Set the localPlayer, only necessary in replays
 	void setLocalPlayer(int player);
+
+	///Sends a part of the checksum history of the local player to the other players,
+	///used to find where the game desynchronized, see NetSendCheckSumHistory::Part
+	void sendCheckSumHistory(Uint8 part, const std::vector<Uint32>& values);
+
+	///Stores a part of the checksum history recieved from another player
+	void pushCheckSumHistory(boost::shared_ptr<NetSendCheckSumHistory> history);
+
+	///Returns the parts of the checksum histories recieved from the other players
+	const std::vector<boost::shared_ptr<NetSendCheckSumHistory> >& getCheckSumHistories();
 	
 private:
 
@@ -102,6 +114,8 @@ private:
 	boost::shared_ptr<NetConnection> router;
 	int networkOrderRate;
 	int currentLatency;
+	///The parts of the checksum histories recieved from the other players
+	std::vector<boost::shared_ptr<NetSendCheckSumHistory> > checkSumHistories;
 };
 
 
@@ -17,6 +17,7 @@
 */
 
 #include "NetMessage.h"
+#include "CheckSumHistory.h"
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -217,6 +218,9 @@ shared_ptr<NetMessage> NetMessage::getNetMessage(GAGCore::InputStream* stream)
 		case MNetSubmitRatingOnMap:
 		message.reset(new NetSubmitRatingOnMap);
 		break;
+		case MNetSendCheckSumHistory:
+		message.reset(new NetSendCheckSumHistory);
+		break;
 		///append_create_point
 	}
 	message->decodeData(stream);
@@ -4585,4 +4589,115 @@ Uint8 NetSubmitRatingOnMap::getRating() const
 
 
 
+NetSendCheckSumHistory::NetSendCheckSumHistory()
+	: player(0), part(Summary)
+{
+
+}
+
+
+
+NetSendCheckSumHistory::NetSendCheckSumHistory(Uint8 player, Uint8 part, const std::vector<Uint32>& values)
+	:player(player), part(part), values(values)
+{
+}
+
+
+
+Uint8 NetSendCheckSumHistory::getMessageType() const
+{
+	return MNetSendCheckSumHistory;
+}
+
+
+
+void NetSendCheckSumHistory::encodeData(GAGCore::OutputStream* stream) const
+{
+	stream->writeEnterSection("NetSendCheckSumHistory");
+	stream->writeUint8(player, "player");
+	stream->writeUint8(part, "part");
+	stream->writeUint32(values.size(), "size");
+	stream->writeEnterSection("values");
+	for(unsigned int i=0; i<values.size(); ++i)
+	{
+		stream->writeEnterSection(i);
+		stream->writeUint32(values[i], "value");
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+	stream->writeLeaveSection();
+}
+
+
+
+void NetSendCheckSumHistory::decodeData(GAGCore::InputStream* stream)
+{
+	stream->readEnterSection("NetSendCheckSumHistory");
+	player = stream->readUint8("player");
+	part = stream->readUint8("part");
+	Uint32 size = stream->readUint32("size");
+	// The size comes from the network, no history sends more values in one message
+	if (size > CheckSumHistory::MAX_MESSAGE_VALUES)
+	{
+		std::cerr << "NetSendCheckSumHistory::decodeData : " << size << " values is too many, ignoring them" << std::endl;
+		values.clear();
+		stream->readLeaveSection();
+		return;
+	}
+	values.resize(size);
+	stream->readEnterSection("values");
+	for(unsigned int i=0; i<size; ++i)
+	{
+		stream->readEnterSection(i);
+		values[i] = stream->readUint32("value");
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+	stream->readLeaveSection();
+}
+
+
+
+std::string NetSendCheckSumHistory::format() const
+{
+	std::ostringstream s;
+	s<<"NetSendCheckSumHistory("<<"player="<<(int)player<<"; "<<"part="<<(int)part<<"; "<<"size="<<values.size()<<"; "<<")";
+	return s.str();
+}
+
+
+
+bool NetSendCheckSumHistory::operator==(const NetMessage& rhs) const
+{
+	if(typeid(rhs)==typeid(NetSendCheckSumHistory))
+	{
+		const NetSendCheckSumHistory& r = dynamic_cast<const NetSendCheckSumHistory&>(rhs);
+		if(r.player == player && r.part == part && r.values == values)
+			return true;
+	}
+	return false;
+}
+
+
+Uint8 NetSendCheckSumHistory::getPlayer() const
+{
+	return player;
+}
+
+
+
+Uint8 NetSendCheckSumHistory::getPart() const
+{
+	return part;
+}
+
+
+
+const std::vector<Uint32>& NetSendCheckSumHistory::getValues() const
+{
+	return values;
+}
+
+
+
 //append_code_position
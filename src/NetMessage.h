@@ -107,6 +107,7 @@ enum NetMessageType
 	MNetRequestMapThumbnail,
 	MNetSendMapThumbnail,
 	MNetSubmitRatingOnMap,
+	MNetSendCheckSumHistory,
 	//type_append_marker
 };
 
@@ -2314,6 +2315,58 @@ private:
 
 
 
+///This message sends a part of the checksum history of a player to the other players
+///of a game, so that they can find where the game desynchronized, see CheckSumHistory
+class NetSendCheckSumHistory : public NetMessage
+{
+public:
+	///The parts of the history that can be sent
+	enum Part
+	{
+		///The checksums of the last steps
+		Summary,
+		///The checksums of the units and buildings at one step
+		Details
+	};
+
+	///Creates a NetSendCheckSumHistory message
+	NetSendCheckSumHistory();
+
+	///Creates a NetSendCheckSumHistory message
+	NetSendCheckSumHistory(Uint8 player, Uint8 part, const std::vector<Uint32>& values);
+
+	///Returns MNetSendCheckSumHistory
+	Uint8 getMessageType() const;
+
+	///Encodes the data
+	void encodeData(GAGCore::OutputStream* stream) const;
+
+	///Decodes the data
+	void decodeData(GAGCore::InputStream* stream);
+
+	///Formats the NetSendCheckSumHistory message with a small amount
+	///of information.
+	std::string format() const;
+
+	///Compares with another NetSendCheckSumHistory
+	bool operator==(const NetMessage& rhs) const;
+
+	///Retrieves the player who sent the history
+	Uint8 getPlayer() const;
+
+	///Retrieves the part of the history, from Part
+	Uint8 getPart() const;
+
+	///Retrieves the values of the history
+	const std::vector<Uint32>& getValues() const;
+private:
+	Uint8 player;
+	Uint8 part;
+	std::vector<Uint32> values;
+};
+
+
+
 //message_append_marker
 
 #include <iostream>
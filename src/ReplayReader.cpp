@@ -19,6 +19,7 @@
 #include "ReplayReader.h"
 
 #include "BinaryStream.h"
+#include "StreamBackend.h"
 #include "Order.h"
 #include "NetMessage.h"
 #include "GUIMessageBox.h"
@@ -26,30 +27,39 @@
 #include "Version.h"
 #include "Toolkit.h"
 #include "FileManager.h"
+#include "ReplayWriter.h"
+#include "zlib.h"
 
 #include <iomanip>
 
 ReplayReader::ReplayReader()
 {
 	stream = NULL;
+	file = NULL;
 	currentStep = 0;
 	numSteps = 0;
 	ordersProcessed = 0;
 	numOrders = 0;
 	stepsUntilNextOrder = -1;
 	checksum = 0;
+	checksumMismatchStep = -1;
+	mismatchedChecksum = 0;
 }
 
 ReplayReader::~ReplayReader()
 {
 	delete stream;
 	stream = NULL;
+	delete file;
+	file = NULL;
 }
 
 bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrders)
 {
-	// Reset checksum
+	// Reset checksum and keyframes
 	checksum = 0;
+	checksumMismatchStep = -1;
+	keyframes.clear();
 
 	// Make sure the given stream is valid
 	if (inputStream == NULL) return false;
@@ -59,18 +69,17 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 		return false;
 	}
 
-	// If we still own a different stream, delete that one first
-	if (stream != NULL)
-	{
-		delete stream;
-	}
+	// If we still own different streams, delete them first
+	delete stream;
+	stream = NULL;
+	delete file;
 
 	// From now on we own the given stream
-	stream = inputStream;
+	file = inputStream;
 
 	currentStep = 0;
 	ordersProcessed = 0;
-	
+
 	// Skip to the section in the stream where the header ends
 	if (skipToOrders)
 	{
@@ -78,40 +87,42 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 		{
 			// readEnterSection doesn't do anything, so just read the gui that is there and discard the data
 			GameGUI tempGui;
-			tempGui.load(stream);
+			tempGui.load(file);
 		}
 		catch (std::exception &e)
 		{
-			delete stream;
-			stream = NULL;
+			delete file;
+			file = NULL;
 			return false;
 		}
 	}
 
 	// Read the version numbers
-	Uint16 version_major = stream->readUint16("versionMajor");
-	Uint16 version_minor = stream->readUint16("versionMinor");
+	Uint16 version_major = file->readUint16("versionMajor");
+	Uint16 version_minor = file->readUint16("versionMinor");
 
 	// Check the version number. Playing a replay of an older version is impossible.
 	if (version_major != VERSION_MAJOR || version_minor != VERSION_MINOR)
 	{
-		delete stream;
-		stream = NULL;
+		delete file;
+		file = NULL;
 		return false;
 	}
 
+	// Uncompress the orders and find the keyframes
+	assert(file->canSeek());
+	stream = readBlocks();
+
 	// If there are no orders, this is also not a valid replay (there should be at least a NullOrder)
 	if (stream->isEndOfStream())
 	{
 		delete stream;
 		stream = NULL;
+		delete file;
+		file = NULL;
 		return false;
 	}
 
-	// Save the position in the stream
-	assert(stream->canSeek());
-	size_t pos = stream->getPosition();
-
 	// Calculate the length of this replay
 	boost::shared_ptr<Order> order;
 	numSteps = 0;
@@ -141,6 +152,8 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 				// Fail
 				delete stream;
 				stream = NULL;
+				delete file;
+				file = NULL;
 				return false;
 			}
 			else
@@ -158,9 +171,13 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 	}
 	while (order->getOrderType() != ORDER_NULL);
 
-	// Go back to the original position in the stream
-	stream->seekFromStart(pos);
-	
+	// Keyframes after the last readable order can't be reached
+	while (!keyframes.empty() && keyframes.back().step > numSteps)
+		keyframes.pop_back();
+
+	// Go back to the start of the orders
+	stream->seekFromStart(0);
+
 	// Read the number of steps until the first order
 	stepsUntilNextOrder = stream->readUint16("replayStepCounter");
 
@@ -237,6 +254,9 @@ boost::shared_ptr<Order> ReplayReader::retrieveOrder()
 			std::cerr << "\tChecksum in replay file: 0x" << order->gameCheckSum << std::endl;
 			std::cerr << std::setbase(10);
 
+			checksumMismatchStep = currentStep;
+			mismatchedChecksum = order->gameCheckSum;
+
 			delete stream;
 			stream = NULL;
 			return boost::shared_ptr<Order>(new NullOrder());
@@ -260,7 +280,177 @@ boost::shared_ptr<Order> ReplayReader::retrieveOrder()
 	return order;
 }
 
+Sint32 ReplayReader::getCheckSumMismatchStep() const
+{
+	return checksumMismatchStep;
+}
+
+Uint32 ReplayReader::getMismatchedCheckSum() const
+{
+	return mismatchedChecksum;
+}
+
 GAGCore::InputStream* ReplayReader::getStream() const
 {
 	return stream;
 }
+
+GAGCore::InputStream *ReplayReader::readBlocks()
+{
+	keyframes.clear();
+	std::string orders;
+
+	size_t pos = file->getPosition();
+	file->seekFromEnd(0);
+	size_t length = file->getPosition();
+	file->seekFromStart(pos);
+
+	// The blocks are read until the end block, or until the end of the file if the game didn't end properly
+	bool ended = false;
+	while (!ended && file->getPosition() + 1 <= length)
+	{
+		Uint8 type = file->readUint8("replayBlockType");
+		if (type == ReplayWriter::ORDERS_BLOCK)
+		{
+			if (file->getPosition() + 8 > length) break;
+			uLongf size = file->readUint32("ordersUncompressedSize");
+			Uint32 compressedSize = file->readUint32("ordersCompressedSize");
+			if (size == 0 || compressedSize == 0 || compressedSize > compressBound(size) || file->getPosition() + compressedSize > length) break;
+
+			std::vector<Uint8> compressed(compressedSize);
+			file->read(&compressed[0], compressedSize, "ordersData");
+			std::vector<Uint8> data(size);
+			if (uncompress(&data[0], &size, &compressed[0], compressedSize) != Z_OK || size != data.size())
+			{
+				std::cerr << "Error in replay: can't uncompress orders at position " << orders.size() << std::endl;
+				break;
+			}
+			orders.append(reinterpret_cast<const char *>(&data[0]), size);
+		}
+		else if (type == ReplayWriter::KEYFRAME_BLOCK)
+		{
+			// Only the position of the keyframe is kept, it is read when needed
+			if (file->getPosition() + 22 > length) break;
+			Keyframe keyframe;
+			keyframe.position = file->getPosition();
+			keyframe.step = file->readUint32("keyframeStep");
+			file->seekRelative(14);
+			Uint32 compressedSize = file->readUint32("keyframeCompressedSize");
+			if (file->getPosition() + compressedSize > length) break;
+			file->seekRelative(compressedSize);
+			if (keyframes.empty() || keyframe.step > keyframes.back().step)
+				keyframes.push_back(keyframe);
+		}
+		else if (type == ReplayWriter::END_BLOCK)
+		{
+			ended = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (!ended)
+	{
+		// The game didn't end properly, so the replay is ended where the last complete block ends
+		std::cerr << "Warning: replay was not finished, it stops at the last orders that were written" << std::endl;
+		if (!orders.empty())
+		{
+			MemoryStreamBackend *lastOrdersBackend = new MemoryStreamBackend();
+			OutputStream *lastOrders = new BinaryOutputStream(lastOrdersBackend);
+			lastOrders->writeUint16(0, "replayStepsSinceLastOrder");
+			NetSendOrder msg(boost::shared_ptr<Order>(new NullOrder()));
+			msg.encodeData(lastOrders);
+			orders.append(lastOrdersBackend->getBuffer(), lastOrders->getPosition());
+			delete lastOrders;
+		}
+	}
+
+	MemoryStreamBackend *ordersBackend = new MemoryStreamBackend(orders.data(), orders.size());
+	ordersBackend->seekFromStart(0);
+	return new BinaryInputStream(ordersBackend);
+}
+
+Sint32 ReplayReader::getKeyframeStepBefore(Uint32 step) const
+{
+	Sint32 keyframeStep = -1;
+	for (size_t i = 0; i < keyframes.size() && keyframes[i].step <= step; i++)
+		keyframeStep = keyframes[i].step;
+	return keyframeStep;
+}
+
+GAGCore::InputStream *ReplayReader::readKeyframe(const Keyframe &keyframe, Uint32 &orderPosition, Uint16 &stepsSinceLastOrder, Uint32 &ordersBefore)
+{
+	size_t pos = stream->getPosition();
+	stream->seekFromEnd(0);
+	size_t ordersLength = stream->getPosition();
+	stream->seekFromStart(pos);
+	file->seekFromStart(keyframe.position);
+	Uint32 keyframeStep = file->readUint32("keyframeStep");
+	orderPosition = file->readUint32("keyframeOrderPosition");
+	stepsSinceLastOrder = file->readUint16("keyframeStepsSinceLastOrder");
+	ordersBefore = file->readUint32("keyframeNumOrders");
+	uLongf size = file->readUint32("keyframeUncompressedSize");
+	Uint32 compressedSize = file->readUint32("keyframeCompressedSize");
+	if (keyframeStep != keyframe.step || ordersBefore >= numOrders || orderPosition >= ordersLength || size == 0 || compressedSize == 0 || compressedSize > compressBound(size))
+	{
+		std::cerr << "Error in replay: invalid keyframe at step " << keyframe.step << std::endl;
+		return NULL;
+	}
+
+	std::vector<Uint8> compressed(compressedSize);
+	file->read(&compressed[0], compressedSize, "keyframeData");
+	std::vector<Uint8> data(size);
+	if (uncompress(&data[0], &size, &compressed[0], compressedSize) != Z_OK || size != data.size())
+	{
+		std::cerr << "Error in replay: can't uncompress keyframe at step " << keyframe.step << std::endl;
+		return NULL;
+	}
+
+	MemoryStreamBackend *snapshotBackend = new MemoryStreamBackend(&data[0], size);
+	snapshotBackend->seekFromStart(0);
+	return new BinaryInputStream(snapshotBackend);
+}
+
+GAGCore::InputStream *ReplayReader::openKeyframe(Uint32 step)
+{
+	if (!isValid()) return NULL;
+
+	const Keyframe *keyframe = NULL;
+	for (size_t i = 0; i < keyframes.size() && keyframes[i].step <= step; i++)
+		keyframe = &keyframes[i];
+	if (keyframe == NULL) return NULL;
+
+	Uint32 orderPosition;
+	Uint16 stepsSinceLastOrder;
+	Uint32 ordersBefore;
+	InputStream *snapshot = readKeyframe(*keyframe, orderPosition, stepsSinceLastOrder, ordersBefore);
+	if (snapshot == NULL) return NULL;
+
+	// Put the reader in the state it was in when the snapshot was taken
+	stream->seekFromStart(orderPosition);
+	Uint16 stepsUntilNextOrderFromLast = stream->readUint16("replayStepCounter");
+	stepsUntilNextOrder = (stepsUntilNextOrderFromLast >= stepsSinceLastOrder ? stepsUntilNextOrderFromLast - stepsSinceLastOrder : 0);
+	currentStep = keyframe->step;
+	ordersProcessed = ordersBefore;
+
+	return snapshot;
+}
+
+GAGCore::InputStream *ReplayReader::getKeyframeSnapshot(Uint32 step)
+{
+	if (!isValid()) return NULL;
+
+	for (size_t i = 0; i < keyframes.size(); i++)
+	{
+		if (keyframes[i].step == step)
+		{
+			Uint32 orderPosition;
+			Uint16 stepsSinceLastOrder;
+			Uint32 ordersBefore;
+			return readKeyframe(keyframes[i], orderPosition, stepsSinceLastOrder, ordersBefore);
+		}
+	}
+	return NULL;
+}
@@ -22,6 +22,7 @@
 #include <boost/shared_ptr.hpp>
 #include <assert.h>
 #include <string>
+#include <vector>
 #include "Types.h"
 
 namespace GAGCore
@@ -32,10 +33,12 @@ namespace GAGCore
 class Order;
 
 /// This class is used for reading replays.
-/// The replay stream is kept open and read every time you do retrieveOrder.
+/// The orders of the replay are uncompressed in memory when it is loaded, and read every time you do retrieveOrder.
+/// The replay stream is kept open to read the keyframes when they are needed.
 /// If this replay stores checksums, they are checked every time an order is read.
 /// The replay ends early if both the checksum given to this class by setCheckSum(checksum) != 0
 /// AND the order written in the replay file != 0 AND both don't match.
+/// If the replay contains keyframes (see ReplayWriter), openKeyframe() can be used to jump to any point of it.
 class ReplayReader
 {
 public:
@@ -76,22 +79,54 @@ public:
 	/// Set the checksum. 0 means no testing is done for checksum matches.
 	void setCheckSum(Uint32 checksum = 0);
 
+	/// Returns the step at which the checksums didn't match, or -1 if they always did
+	Sint32 getCheckSumMismatchStep() const;
+
+	/// Returns the checksum read in the replay at the step where they didn't match
+	Uint32 getMismatchedCheckSum() const;
+
 	/// Get the next order on the current step
 	boost::shared_ptr<Order> retrieveOrder();
 
-	/// Get the stream that this reader uses, or NULL if there is none
+	/// Get the stream of the orders that this reader uses, or NULL if there is none
 	GAGCore::InputStream *getStream() const;
 
+	/// Returns the step of the last keyframe at or before the given step, or -1 if there is none
+	Sint32 getKeyframeStepBefore(Uint32 step) const;
+
+	/// Moves the reader to the last keyframe at or before the given step, and returns a stream containing the
+	/// snapshot of the game at that step, to be loaded with GameGUI::loadReplayKeyframe().
+	/// The caller owns the returned stream. Returns NULL and leaves the reader unchanged if it fails.
+	GAGCore::InputStream *openKeyframe(Uint32 step);
+
+	/// Returns a stream containing the snapshot of the game of the keyframe at exactly the given step, without
+	/// moving the reader. The caller owns the returned stream. Returns NULL if there is no such keyframe.
+	GAGCore::InputStream *getKeyframeSnapshot(Uint32 step);
+
 private:
+	/// Reads the blocks of the replay that follow the header, finds the keyframes and returns a stream with
+	/// the uncompressed orders. If the replay is not finished, the orders are ended after the last complete block.
+	GAGCore::InputStream *readBlocks();
+
+	/// The position of a keyframe in the stream
+	struct Keyframe;
+
+	/// Reads the keyframe and returns its snapshot, or NULL if it is invalid. Fills the state of the reader at that
+	/// keyframe in the given variables. The position in the orders is left unchanged.
+	GAGCore::InputStream *readKeyframe(const Keyframe &keyframe, Uint32 &orderPosition, Uint16 &stepsSinceLastOrder, Uint32 &ordersBefore);
+
 	/// You shouldn't copy-construct this class
 	ReplayReader(const ReplayReader &copy) { assert(false); };
 
 	/// You shouldn't use assignment on this class
 	void operator=(const ReplayReader &reader) { assert(false); };
 
-	/// The stream it reads the replay from
+	/// The stream it reads the orders from
 	GAGCore::InputStream *stream;
 
+	/// The stream of the replay, where the keyframes are read from
+	GAGCore::InputStream *file;
+
 	/// Current step number
 	Uint32 currentStep;
 
@@ -109,6 +144,23 @@ private:
 
 	/// The game's current checksum (or 0 if it's not given)
 	Uint32 checksum;
+
+	/// The step at which the checksums didn't match, or -1
+	Sint32 checksumMismatchStep;
+
+	/// The checksum in the replay at checksumMismatchStep
+	Uint32 mismatchedChecksum;
+
+	struct Keyframe
+	{
+		/// The step of the snapshot
+		Uint32 step;
+		/// The position of the keyframe in the replay stream
+		Uint32 position;
+	};
+
+	/// The keyframes of the replay, sorted by step
+	std::vector<Keyframe> keyframes;
 };
 
 #endif
@@ -26,8 +26,14 @@
 #include "Version.h"
 #include "Toolkit.h"
 #include "FileManager.h"
+#include "Game.h"
+#include "Utilities.h"
+#include "zlib.h"
 
+#include <algorithm>
+#include <iostream>
 #include <stdio.h>
+#include <vector>
 
 // Write an Order to the stream, with the given checksum
 inline void writeOrder(GAGCore::OutputStream *stream, boost::shared_ptr<Order> order, Uint32 checksum = 0)
@@ -46,7 +52,17 @@ ReplayWriter::ReplayWriter()
 {
 	bufferBackend = NULL;
 	buffer = NULL;
+	pendingBackend = NULL;
+	pending = NULL;
 	stepsSinceLastOrder = 0;
+	currentStep = 0;
+	numOrders = 0;
+	flushedOrdersSize = 0;
+	lastFlushStep = 0;
+	lastKeyframeStep = -1;
+	pendingKeyframe = NULL;
+	keyframeThread = NULL;
+	finished = false;
 	checksum = 0;
 }
 
@@ -55,6 +71,7 @@ ReplayWriter::~ReplayWriter()
 	finish();
 
 	delete buffer;
+	delete pending;
 }
 
 void ReplayWriter::init(const std::string &backend, GameGUI &gui)
@@ -69,7 +86,7 @@ void ReplayWriter::init(const std::string &backend, GameGUI &gui)
 	}
 	else
 	{
-		FILE* fp = Toolkit::getFileManager()->openFP(backend, "w+");
+		FILE* fp = Toolkit::getFileManager()->openFP(backend, "w+b");
 		bufferBackend = new FileStreamBackend(fp);
 	}
 
@@ -78,12 +95,17 @@ void ReplayWriter::init(const std::string &backend, GameGUI &gui)
 	buffer = new BinaryOutputStream(bufferBackend);
 	assert(buffer->isValid());
 
+	// The orders are kept in memory until they are written in a block
+	pendingBackend = new MemoryStreamBackend();
+	pending = new BinaryOutputStream(pendingBackend);
+
 	// Write the game's header to the buffer
 	gui.save(buffer, "replayHeader");
 
 	// Write the current glob2 version number to the buffer
 	buffer->writeUint16(VERSION_MAJOR, "versionMajor");
 	buffer->writeUint16(VERSION_MINOR, "versionMinor");
+	buffer->flush();
 }
 
 bool ReplayWriter::isValid() const
@@ -94,6 +116,13 @@ bool ReplayWriter::isValid() const
 void ReplayWriter::advanceStep()
 {
 	stepsSinceLastOrder++;
+	currentStep++;
+
+	// Write the last keyframe as soon as it is compressed
+	finishKeyframe(false);
+
+	if (isValid() && !finished && currentStep >= lastFlushStep + FLUSH_INTERVAL)
+		flushOrders();
 }
 
 void ReplayWriter::setCheckSum(Uint32 checksum)
@@ -103,78 +132,209 @@ void ReplayWriter::setCheckSum(Uint32 checksum)
 
 void ReplayWriter::pushOrder(boost::shared_ptr<Order> order)
 {
-	if (!isValid()) return;
+	if (!isValid() || finished) return;
 	if (order->getOrderType() == ORDER_VOICE_DATA || order->getOrderType() == ORDER_NULL) return;
 
 	// Write the number of steps since last order to this order (can be 0)
-	buffer->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
+	pending->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
 
-	// Write the Order to the file
-	writeOrder(buffer, order, checksum);
+	// Write the Order to the pending orders
+	writeOrder(pending, order, checksum);
 
 	stepsSinceLastOrder = 0;
+	numOrders++;
+
+	// Orders are written in a block every FLUSH_INTERVAL steps, unless there are a lot of them
+	if (pending->getPosition() >= MAX_PENDING_SIZE)
+		flushOrders();
+}
+
+bool ReplayWriter::writeOrdersBlock(GAGCore::OutputStream *stream, const char *data, size_t size)
+{
+	uLongf compressedSize = compressBound(size);
+	std::vector<Uint8> compressed(compressedSize);
+	if (compress2(&compressed[0], &compressedSize, reinterpret_cast<const Bytef *>(data), size, Z_DEFAULT_COMPRESSION) != Z_OK)
+		return false;
+
+	stream->writeUint8(ORDERS_BLOCK, "replayBlockType");
+	stream->writeUint32(size, "ordersUncompressedSize");
+	stream->writeUint32(compressedSize, "ordersCompressedSize");
+	stream->write(&compressed[0], compressedSize, "ordersData");
+	return true;
+}
+
+void ReplayWriter::flushOrders()
+{
+	lastFlushStep = currentStep;
 
-	// Don't flush the buffer. That is done when writing the last Order, in ReplayWriter::finish().
+	size_t size = pending->getPosition();
+	if (size == 0) return;
+
+	if (!writeOrdersBlock(buffer, pendingBackend->getBuffer(), size))
+	{
+		// Keep the orders, they will be part of the next block
+		std::cerr << "ReplayWriter::flushOrders : can't compress the orders of step " << currentStep << std::endl;
+		return;
+	}
+	buffer->flush();
+
+	flushedOrdersSize += size;
+	delete pending;
+	pendingBackend = new MemoryStreamBackend();
+	pending = new BinaryOutputStream(pendingBackend);
+}
+
+void ReplayWriter::addKeyframeIfNeeded(Game &game)
+{
+	if (!isValid() || finished) return;
+	if (lastKeyframeStep >= 0 && currentStep < lastKeyframeStep + KEYFRAME_INTERVAL) return;
+
+	// The previous keyframe goes first, so that the keyframes stay in the order of the game
+	finishKeyframe(true);
+	lastKeyframeStep = currentStep;
+
+	// Save the game in memory, this must be done here as the game goes on once we return
+	MemoryStreamBackend *snapshotBackend = new MemoryStreamBackend();
+	OutputStream *snapshot = new BinaryOutputStream(snapshotBackend);
+	game.save(snapshot, false, game.mapHeader.getMapName());
+	saveSyncRandState(snapshot);
+	snapshotBackend->seekFromEnd(0);
+
+	// The pending orders go first, so that the keyframe refers to orders already in blocks
+	flushOrders();
+
+	pendingKeyframe = new PendingKeyframe;
+	pendingKeyframe->step = currentStep;
+	pendingKeyframe->orderPosition = flushedOrdersSize;
+	pendingKeyframe->stepsSinceLastOrder = stepsSinceLastOrder;
+	pendingKeyframe->numOrders = numOrders;
+	pendingKeyframe->snapshot.assign(snapshotBackend->getBuffer(), snapshotBackend->getPosition());
+	delete snapshot;
+
+	// Compressing takes longer than saving, so it is done in a thread while the game goes on
+	keyframeThread = new boost::thread(boost::ref(*pendingKeyframe));
+}
+
+void ReplayWriter::PendingKeyframe::operator()()
+{
+	// Game snapshots are mostly map data and compress very well
+	uLongf compressedSize = compressBound(snapshot.size());
+	data.resize(compressedSize);
+	if (compress2(&data[0], &compressedSize, reinterpret_cast<const Bytef *>(snapshot.data()), snapshot.size(), Z_DEFAULT_COMPRESSION) == Z_OK)
+		data.resize(compressedSize);
+	else
+		data.clear();
+}
+
+bool ReplayWriter::finishKeyframe(bool wait)
+{
+	if (!keyframeThread) return true;
+
+	if (wait)
+		keyframeThread->join();
+	else if (!keyframeThread->timed_join(boost::posix_time::seconds(0)))
+		return false;
+	delete keyframeThread;
+	keyframeThread = NULL;
+
+	if (!pendingKeyframe->data.empty())
+	{
+		buffer->writeUint8(KEYFRAME_BLOCK, "replayBlockType");
+		buffer->writeUint32(pendingKeyframe->step, "keyframeStep");
+		buffer->writeUint32(pendingKeyframe->orderPosition, "keyframeOrderPosition");
+		buffer->writeUint16(pendingKeyframe->stepsSinceLastOrder, "keyframeStepsSinceLastOrder");
+		buffer->writeUint32(pendingKeyframe->numOrders, "keyframeNumOrders");
+		buffer->writeUint32(pendingKeyframe->snapshot.size(), "keyframeUncompressedSize");
+		buffer->writeUint32(pendingKeyframe->data.size(), "keyframeCompressedSize");
+		buffer->write(&pendingKeyframe->data[0], pendingKeyframe->data.size(), "keyframeData");
+		buffer->flush();
+	}
+	else
+	{
+		std::cerr << "ReplayWriter::finishKeyframe : can't compress the snapshot of step " << pendingKeyframe->step << std::endl;
+	}
+
+	delete pendingKeyframe;
+	pendingKeyframe = NULL;
+	return true;
 }
 
 void ReplayWriter::finish()
 {
-	if (!isValid()) return;
+	if (!isValid() || finished) return;
+
+	finishKeyframe(true);
 
 	// Write the number of steps since last order to the end of the replay
-	buffer->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
+	pending->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
 
 	// We write a NullOrder to mark the end of the replay (like terminating a string with \0)
-	writeOrder(buffer, boost::shared_ptr<Order>(new NullOrder()), 0);
+	writeOrder(pending, boost::shared_ptr<Order>(new NullOrder()), 0);
 
-	// Flush the buffer now
+	// Write the last orders and mark the end of the replay
+	flushOrders();
+	buffer->writeUint8(END_BLOCK, "replayBlockType");
 	buffer->flush();
 
 	stepsSinceLastOrder = 0;
+	finished = true;
 }
 
-bool ReplayWriter::write(const std::string &filename) const
+bool ReplayWriter::write(const std::string &filename)
 {
 	if (!isValid()) return false;
 	if (filename == "") return false;
 	
-	// Make sure the buffer is flushed
+	// Write the pending orders and keyframe, so that the copy has all of them
+	if (!finished)
+	{
+		finishKeyframe(true);
+		flushOrders();
+	}
 	buffer->flush();
 
 	// Open the file as a backend
 	StreamBackend* fileBackend = Toolkit::getFileManager()->openOutputStreamBackend(filename);
-	assert(fileBackend->isValid());
+	if (!fileBackend->isValid())
+	{
+		delete fileBackend;
+		return false;
+	}
 
 	// Open the file as an OutputStream
 	OutputStream* file = new BinaryOutputStream(fileBackend);
 
-	// Save the current position in the buffer
-	size_t pos = bufferBackend->getPosition();
-
-	// Go back to the beginning of the buffer
+	// Copy the replay to the file, a block at a time
+	bufferBackend->seekFromEnd(0);
+	size_t length = bufferBackend->getPosition();
 	bufferBackend->seekFromStart(0);
-
-	// Copy the buffer to the file
-	while (!bufferBackend->isEndOfStream())
+	std::vector<char> block(65536);
+	for (size_t pos = 0; pos < length; pos += block.size())
 	{
-		int c = bufferBackend->getChar();
-		if (bufferBackend->isEndOfStream()) break;
-		fileBackend->putc(c);
+		size_t size = std::min(block.size(), length - pos);
+		bufferBackend->read(&block[0], size);
+		fileBackend->write(&block[0], size);
 	}
 
-	// Write the number of steps since last order to the end of the replay
-	file->writeUint16(0, "replayStepsSinceLastOrder");
+	// Go back to the end of the buffer
+	bufferBackend->seekFromEnd(0);
 
-	// Write a NullOrder to the file to make sure it's a NullOrder-terminated replay
-	writeOrder(file, boost::shared_ptr<Order>(new NullOrder()), 0);
+	if (!finished)
+	{
+		// End the copy with a NullOrder-terminated block, without ending this replay
+		MemoryStreamBackend *lastOrdersBackend = new MemoryStreamBackend();
+		OutputStream *lastOrders = new BinaryOutputStream(lastOrdersBackend);
+		lastOrders->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
+		writeOrder(lastOrders, boost::shared_ptr<Order>(new NullOrder()), 0);
+		writeOrdersBlock(file, lastOrdersBackend->getBuffer(), lastOrders->getPosition());
+		file->writeUint8(END_BLOCK, "replayBlockType");
+		delete lastOrders;
+	}
 
 	// Flush the file
 	file->flush();
 	delete file;
 
-	// Go back to the right position in the buffer
-	buffer->seekFromStart(pos);
-
 	return true;
 }
 
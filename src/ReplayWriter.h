@@ -20,24 +20,54 @@
 #define __ReplayWriter_h
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <assert.h>
+#include <string>
+#include <vector>
 #include "Types.h"
 
 namespace GAGCore
 {
 	class OutputStream;
 	class StreamBackend;
+	class MemoryStreamBackend;
 }
 
+class Game;
 class GameGUI;
 class Order;
 
 /// This class is used for writing replays.
-/// ReplayWriter buffers a whole replay and then writes it to a file when you call write()
+/// ReplayWriter streams the replay to its backend as the game goes: after the header, the orders are written
+/// in zlib-compressed blocks, one every FLUSH_INTERVAL steps, so that its memory use doesn't grow with the game
+/// and a crash still leaves a replay that can be played up to the last block.
 /// You can optionally (though preferably) write checksums that will then be checked when reading back the replay.
+/// Every KEYFRAME_INTERVAL steps, a compressed snapshot of the game is written as a block as well, so that
+/// ReplayReader can jump to any point of the replay without simulating the whole game from the start.
+/// The snapshot is compressed in a thread, and its block written once it is done, so the game doesn't stall.
 class ReplayWriter
 {
 public:
+	/// The number of steps between two keyframes (one minute of game time)
+	static const Uint32 KEYFRAME_INTERVAL = 1500;
+
+	/// The number of steps between two blocks of orders (ten seconds of game time)
+	static const Uint32 FLUSH_INTERVAL = 250;
+
+	/// The size of the pending orders above which a block is written before FLUSH_INTERVAL steps have passed
+	static const size_t MAX_PENDING_SIZE = 65536;
+
+	/// The types of the blocks that follow the header in a replay
+	enum BlockType
+	{
+		/// Compressed orders, each preceded by the number of steps since the previous one
+		ORDERS_BLOCK = 'O',
+		/// A compressed snapshot of the game, and the state of the replay when it was taken
+		KEYFRAME_BLOCK = 'K',
+		/// The end of a finished replay
+		END_BLOCK = 'E'
+	};
+
 	/// Constructs the replay writer
 	ReplayWriter();
 
@@ -52,7 +82,7 @@ public:
 	/// Returns false if the writer isn't initialised or if the data does not make sense
 	bool isValid() const;
 
-	/// Increments the current step number and updates the checksum.
+	/// Increments the current step number, and writes the pending orders if FLUSH_INTERVAL steps have passed
 	void advanceStep();
 
 	/// If the checksum is 0, there won't be any checking if the checksums match for orders.
@@ -61,12 +91,16 @@ public:
 	/// Adds the order to the replay
 	void pushOrder(boost::shared_ptr<Order> order);
 
-	/// Marks the end of the replay
+	/// Stores a snapshot of the game if KEYFRAME_INTERVAL steps have passed since the last one.
+	/// Must be called between steps, after the game's syncStep and before the orders of the next step.
+	void addKeyframeIfNeeded(Game &game);
+
+	/// Marks the end of the replay, no more orders can be added afterwards
 	void finish();
 
-	/// Write this replay to the given file
+	/// Write a copy of this replay, ended at the current step, to the given file
 	/// Returns true if successful
-	bool write(const std::string &filename) const;
+	bool write(const std::string &filename);
 
 	/// Get the buffer, if for any reason you would need it
 	GAGCore::OutputStream* getBuffer() const;
@@ -78,15 +112,73 @@ private:
 	/// You shouldn't use assignment on this class
 	void operator=(const ReplayWriter &writer) { assert(false); };
 
-	/// The StreamBackend of the buffer
+	/// Compresses the pending orders and writes them as a block
+	void flushOrders();
+
+	/// Compresses the given orders and writes them as a block to the stream
+	static bool writeOrdersBlock(GAGCore::OutputStream *stream, const char *data, size_t size);
+
+	/// A keyframe whose snapshot is being compressed in keyframeThread
+	struct PendingKeyframe
+	{
+		/// The state of the replay when the snapshot was taken
+		Uint32 step;
+		Uint32 orderPosition;
+		Uint16 stepsSinceLastOrder;
+		Uint32 numOrders;
+
+		/// The snapshot of the game
+		std::string snapshot;
+		/// The compressed snapshot, empty if it couldn't be compressed
+		std::vector<Uint8> data;
+
+		/// Compresses the snapshot, run in keyframeThread
+		void operator()();
+	};
+
+	/// Writes the pending keyframe as a block once it is compressed, waiting for it if wait is true.
+	/// Returns false if wait is false and it is not compressed yet.
+	bool finishKeyframe(bool wait);
+
+	/// The StreamBackend of the replay
 	GAGCore::StreamBackend *bufferBackend;
 
-	/// The buffer OutputStream
+	/// The OutputStream of the replay
 	GAGCore::OutputStream *buffer;
 
+	/// The orders that haven't been written in a block yet
+	GAGCore::MemoryStreamBackend *pendingBackend;
+
+	/// The OutputStream of the pending orders
+	GAGCore::OutputStream *pending;
+
 	/// The number of steps since the last order
 	Uint16 stepsSinceLastOrder;
 
+	/// The number of steps since the start of the replay
+	Uint32 currentStep;
+
+	/// The number of orders written so far
+	Uint32 numOrders;
+
+	/// The size of the orders, once uncompressed, written in blocks so far
+	Uint32 flushedOrdersSize;
+
+	/// The step at which the pending orders were last written
+	Uint32 lastFlushStep;
+
+	/// The step of the last keyframe, or -1 if there is none yet
+	Sint32 lastKeyframeStep;
+
+	/// The keyframe being compressed, NULL if none is
+	PendingKeyframe *pendingKeyframe;
+
+	/// The thread compressing pendingKeyframe, NULL if none is running
+	boost::thread *keyframeThread;
+
+	/// True once finish() has been called
+	bool finished;
+
 	/// The game's current checksum (or 0 if it's not given)
 	Uint32 checksum;
 };
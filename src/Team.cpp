@@ -35,8 +35,51 @@
 #include "Utilities.h"
 #include "Player.h"
 
+WorkerCandidates::WorkerCandidates(bool onlyFilling)
+{
+	this->onlyFilling=onlyFilling;
+	busyCount=0;
+}
+
+
+
+void WorkerCandidates::clear(void)
+{
+	freeUnits.clear();
+	busyCount=0;
+	busyPerBuilding.clear();
+}
+
+
+
+void WorkerCandidates::add(Unit *unit)
+{
+	if (unit->activity==Unit::ACT_RANDOM && unit->medical==Unit::MED_FREE)
+	{
+		freeUnits.push_back(unit);
+	}
+	else
+	{
+		busyCount++;
+		if (unit->attachedBuilding && (!onlyFilling || unit->activity==Unit::ACT_FILLING))
+			busyPerBuilding[unit->attachedBuilding]++;
+	}
+}
+
+
+
+int WorkerCandidates::busyNotWorkingFor(Building *building) const
+{
+	std::map<Building *, int>::const_iterator i=busyPerBuilding.find(building);
+	if (i==busyPerBuilding.end())
+		return busyCount;
+	return busyCount-i->second;
+}
+
+
+
 Team::Team(Game *game)
-:BaseTeam()
+:BaseTeam(), harvestCandidates(true)
 {
 	logFile = globalContainer->logFileManager->getFile("Team.log");
 	assert(game);
@@ -49,7 +92,7 @@ Team::Team(Game *game)
 
 
 Team::Team(GAGCore::InputStream *stream, Game *game, Sint32 versionMinor)
-:BaseTeam()
+:BaseTeam(), harvestCandidates(true)
 {
 	logFile = globalContainer->logFileManager->getFile("Team.log");
 	assert(game);
@@ -564,16 +607,26 @@ Building *Team::findNearestHeal(Unit *unit)
 		Sint32 y = unit->posY;
 		Sint32 maxDist = unit->hungry / unit->race->hungryness + unit->hp;
 		Building *choosen = NULL;
+		int choosenRank = 0;
 		Sint32 bestDist2 = maxDist * maxDist;
-		for (std::list<Building *>::iterator bi=canHealUnit.begin(); bi!=canHealUnit.end(); ++bi)
+		// The nearest buildings come first, on a tie the first one of the list is taken
+		std::vector<BuildingList::Entry> near;
+		Sint32 nextDist2;
+		for (int ring=0; canHealUnit.getRing(map, x, y, ring, near, &nextDist2); ring++)
 		{
-			Building *b=(*bi);
-			Sint32 dist2 = map->warpDistSquare(x, y, b->posX, b->posY);
-			if (dist2 < bestDist2)
+			for (size_t i=0; i<near.size(); i++)
 			{
-				choosen = b;
-				bestDist2 = dist2;
+				Building *b=near[i].building;
+				Sint32 dist2 = map->warpDistSquare(x, y, b->posX, b->posY);
+				if (dist2 < bestDist2 || (dist2 == bestDist2 && choosen && near[i].rank < choosenRank))
+				{
+					choosen = b;
+					choosenRank = near[i].rank;
+					bestDist2 = dist2;
+				}
 			}
+			if (nextDist2 > bestDist2)
+				break;
 		}
 		return choosen;
 	}
@@ -704,15 +757,26 @@ Building *Team::findNearestFood(Unit *unit)
 	{
 		Sint32 bestDist = maxDist;
 		Building *choosenFood = NULL;
-		for (std::list<Building *>::iterator bi=canFeedUnit.begin(); bi!=canFeedUnit.end(); ++bi)
+		int choosenRank = 0;
+		// The nearest inns come first, on a tie the first one of the list is taken
+		std::vector<BuildingList::Entry> near;
+		Sint32 nextDist2;
+		for (int ring=0; canFeedUnit.getRing(map, unit->posX, unit->posY, ring, near, &nextDist2); ring++)
 		{
-			if ((*bi)->availableHappynessLevel() < bestEnemyHappyness)
-				continue;
-			Sint32 dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, (*bi)->posX, (*bi)->posY));
-			if (dist >= bestDist)
-				continue;
-			bestDist = dist;
-			choosenFood = *bi;
+			for (size_t i=0; i<near.size(); i++)
+			{
+				Building *b=near[i].building;
+				if (b->availableHappynessLevel() < bestEnemyHappyness)
+					continue;
+				Sint32 dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, b->posX, b->posY));
+				if (dist > bestDist || (dist == bestDist && (!choosenFood || near[i].rank > choosenRank)))
+					continue;
+				bestDist = dist;
+				choosenFood = b;
+				choosenRank = near[i].rank;
+			}
+			if (1 + (Sint32)sqrt(nextDist2) > bestDist)
+				break;
 		}
 		if (choosenFood)
 			return choosenFood;
@@ -762,23 +826,41 @@ Building *Team::findBestUpgrade(Unit *unit)
 			if (unit->verbose)
 				printf("guid=(%d) unit->canLearn[ability=%d]\n", unit->gid, ability);
 			int actLevel=unit->level[ability];
-			for (std::list<Building *>::iterator bi=upgrade[ability].begin(); bi!=upgrade[ability].end(); ++bi)
+			// The nearest buildings come first. As a building has at most maxUnitInside free places,
+			// the buildings of the next rings can't have a better score than the bound
+			Building *abilityChoosen=NULL;
+			int abilityRank=0;
+			Sint32 abilityScore=score;
+			int maxUnitInside=std::max(1, upgrade[ability].getMaxUnitInside(map));
+			std::vector<BuildingList::Entry> near;
+			Sint32 nextDist2;
+			for (int ring=0; upgrade[ability].getRing(map, x, y, ring, near, &nextDist2); ring++)
 			{
-				Building *b=(*bi);
-				if (unit->verbose)
-					printf("guid=(%d)  b->gid=%d, b->type->level=%d, actLevel=%d\n", unit->gid, b->gid, b->type->level, actLevel);
-				if (b->type->level >= actLevel)
+				for (size_t i=0; i<near.size(); i++)
 				{
-					Sint32 newScore=(map->warpDistSquare(b->posX, b->posY, x, y)<<8)/(b->maxUnitInside-b->unitsInside.size());
-					if (newScore<score)
+					Building *b=near[i].building;
+					if (unit->verbose)
+						printf("guid=(%d)  b->gid=%d, b->type->level=%d, actLevel=%d\n", unit->gid, b->gid, b->type->level, actLevel);
+					if (b->type->level >= actLevel)
 					{
-						unit->destinationPurprose=(Sint32)ability;
-						//fprintf(logFile, "[%d] score=%d, newScore=%d\n", unit->gid, score, newScore);
-						fprintf(logFile, "[%d] tdp6 destinationPurprose=%d\n", unit->gid, unit->destinationPurprose);
-						choosen=b;
-						score=newScore;
+						Sint32 newScore=(map->warpDistSquare(b->posX, b->posY, x, y)<<8)/(b->maxUnitInside-b->unitsInside.size());
+						if (newScore<abilityScore || (newScore==abilityScore && abilityChoosen && near[i].rank<abilityRank))
+						{
+							abilityChoosen=b;
+							abilityRank=near[i].rank;
+							abilityScore=newScore;
+						}
 					}
 				}
+				if ((nextDist2<<8)/maxUnitInside > abilityScore)
+					break;
+			}
+			if (abilityChoosen)
+			{
+				unit->destinationPurprose=(Sint32)ability;
+				fprintf(logFile, "[%d] tdp6 destinationPurprose=%d\n", unit->gid, unit->destinationPurprose);
+				choosen=abilityChoosen;
+				score=abilityScore;
 			}
 		}
 	}
@@ -859,6 +941,20 @@ void Team::remove_building_needing_work(Building* b, Sint32 priority)
 
 void Team::updateAllBuildingTasks()
 {
+	harvestCandidates.clear();
+	for (int t=0; t<NB_UNIT_TYPE; t++)
+		flagCandidates[t].clear();
+	for (int i=0; i<Unit::MAX_COUNT; i++)
+	{
+		Unit *unit=myUnits[i];
+		if (unit==NULL)
+			continue;
+		if (unit->performance[HARVEST])
+			harvestCandidates.add(unit);
+		if (unit->typeNum>=0 && unit->typeNum<NB_UNIT_TYPE)
+			flagCandidates[unit->typeNum].add(unit);
+	}
+
 	for(std::map<int, std::vector<Building*>, std::greater<int> >::iterator i = buildingsNeedingUnits.begin(); i!=buildingsNeedingUnits.end(); ++i)
 	{
 		std::sort(i->second.begin(), i->second.end(), Team::prioritize_building);
@@ -960,6 +1056,11 @@ void Team::syncStep(void)
 {
 	integrity();
 
+	for (int i=0; i<NB_ABILITY; i++)
+		upgrade[i].invalidate();
+	canFeedUnit.invalidate();
+	canHealUnit.invalidate();
+
 	if (noMoreBuildingSitesCountdown>0)
 		noMoreBuildingSitesCountdown--;
 
@@ -1216,6 +1317,7 @@ Uint32 Team::checkSum(std::vector<Uint32> *checkSumsVector, std::vector<Uint32>
 	if (checkSumsVector)
 		checkSumsVector->push_back(cs); // [1+t*20]
 
+	// Units and buildings change nearly every step, so unlike the map cases their checksums are recomputed
 	for (int i=0; i<Unit::MAX_COUNT; i++)
 		if (myUnits[i])
 	{
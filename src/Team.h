@@ -24,7 +24,9 @@
 
 #include <list>
 #include <algorithm>
+#include <map>
 #include <queue>
+#include <vector>
 
 #include "Race.h"
 #include "TeamStat.h"
@@ -33,6 +35,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "BaseTeam.h"
+#include "BuildingList.h"
 #include "WinningConditions.h"
 
 class Building;
@@ -42,6 +45,32 @@ class Unit;
 
 class Game;
 
+///The units of a team that its buildings may hire during a step. They are listed once per step by
+///Team::updateAllBuildingTasks, so that each building looking for a unit doesn't go over all the units
+///of the team. The units that are busy at the start of the step stay busy during it, so they are only counted.
+class WorkerCandidates
+{
+public:
+	///If onlyFilling is set, a busy unit is counted as working for the building it is attached to only if it is filling it
+	explicit WorkerCandidates(bool onlyFilling=false);
+	///Empties the list, at the start of a step
+	void clear(void);
+	///Adds a unit, in the order of myUnits
+	void add(Unit *unit);
+	///Returns the number of busy units that don't work for this building
+	int busyNotWorkingFor(Building *building) const;
+
+	///The units that were free, ACT_RANDOM and MED_FREE, at the start of the step, in the order of myUnits.
+	///Some may have been hired since.
+	std::vector<Unit *> freeUnits;
+
+private:
+	bool onlyFilling;
+	int busyCount;
+	///The number of busy units working for each building
+	std::map<Building *, int> busyPerBuilding;
+};
+
 class Team:public BaseTeam
 {
 	static const bool verbose = false;
@@ -123,6 +152,8 @@ public:
 	
 	//! Compute team checksum
 	Uint32 checkSum(std::vector<Uint32> *checkSumsVector=NULL, std::vector<Uint32> *checkSumsVectorForBuildings=NULL, std::vector<Uint32> *checkSumsVectorForUnits=NULL);
+	//! Number of values checkSum adds to its checkSumsVector, the second and third are the checksums once units and buildings are added
+	static const size_t CHECKSUM_VECTOR_SIZE=18;
 	
 	//! Return the name of the first player in the team
 	std::string getFirstPlayerName(void) const;
@@ -144,13 +175,16 @@ public:
 
 	///This stores the buildings that need units, listed into their hard priorities. They are sorted based on priority.
 	std::map<int, std::vector<Building*>, std::greater<int> > buildingsNeedingUnits;
+	///The units that can harvest, and the units of each type, that the buildings needing units may hire in this step
+	WorkerCandidates harvestCandidates;
+	WorkerCandidates flagCandidates[NB_UNIT_TYPE];
 
 	// thoses where the 4 "call-lists" (lists of flags or buildings for units to work on/in) :
-	std::list<Building *> upgrade[NB_ABILITY]; //to upgrade the units' abilities.
+	BuildingList upgrade[NB_ABILITY]; //to upgrade the units' abilities.
 	
 	// The list of building which have one specific ability.
-	std::list<Building *> canFeedUnit; // The buildings with not enough food are not in this list.
-	std::list<Building *> canHealUnit;
+	BuildingList canFeedUnit; // The buildings with not enough food are not in this list.
+	BuildingList canHealUnit;
 	std::list<Building *> canExchange;
 
 	// The lists of building which needs specials updates:
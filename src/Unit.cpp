@@ -2476,6 +2476,7 @@ void Unit::integrity()
 Uint32 Unit::checkSum(std::vector<Uint32> *checkSumsVector)
 {
 	Uint32 cs=0;
+	size_t vectorStart = checkSumsVector ? checkSumsVector->size() : 0;
 	
 	cs^=typeNum;
 	if (checkSumsVector)
@@ -2621,6 +2622,7 @@ Uint32 Unit::checkSum(std::vector<Uint32> *checkSumsVector)
 		checkSumsVector->push_back(0);// [38]
 	if (checkSumsVector)
 		checkSumsVector->push_back(0);// [39]
+	assert(!checkSumsVector || checkSumsVector->size() == vectorStart+CHECKSUM_VECTOR_SIZE);
 	
 	return cs;
 }
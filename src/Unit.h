@@ -278,6 +278,10 @@ public:
 public:
 	void integrity();
 	Uint32 checkSum(std::vector<Uint32> *checkSumsVector);
+	//! Number of values checkSum adds to its checkSumsVector
+	static const size_t CHECKSUM_VECTOR_SIZE=38;
+	//! Position of the gid in the values checkSum adds to its checkSumsVector
+	static const size_t CHECKSUM_VECTOR_GID=2;
     void setTargetBuilding(Building * b);
 	bool verbose;
 	
@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <Stream.h>
 #include <ctime>
+#include <sstream>
 
 #include "Utilities.h"
 #include "Game.h"
@@ -75,6 +76,28 @@ void setRandomSyncRandSeed()
 	randomGenerator.seed(time(NULL));
 }
 
+void saveSyncRandState(GAGCore::OutputStream *stream)
+{
+	std::ostringstream state;
+	state << randomGenerator;
+	stream->writeText(state.str(), "syncRandState");
+}
+
+bool loadSyncRandState(GAGCore::InputStream *stream, boost::mt19937 &generator)
+{
+	std::string text = stream->readText("syncRandState");
+	std::istringstream state(text);
+	boost::mt19937 loaded;
+	state >> loaded;
+	// The stream fails after the last number even when the state is read, so we check it reads back the same
+	std::ostringstream check;
+	check << loaded;
+	if (check.str() != text)
+		return false;
+	generator = loaded;
+	return true;
+}
+
 namespace Utilities
 {
 	bool ptInRect(int x, int y, SDL_Rect *r)
@@ -46,6 +46,10 @@ void setSyncRandSeed();
 void setSyncRandSeed(Uint32 seed);
 void setRandomSyncRandSeed();
 
+///Saves and loads the state of the sync random generator, for snapshots of a game that must go on exactly as it would have
+void saveSyncRandState(GAGCore::OutputStream *stream);
+bool loadSyncRandState(GAGCore::InputStream *stream, boost::mt19937 &generator = randomGenerator);
+
 int distSquare(int x1, int y1, int x2, int y2);
 #define SIGN(s) ((s) == 0 ? 0 : ((s)>0 ? 1 : -1) )
 
@@ -23,7 +23,7 @@
 // This is the version of map and savegame format, and all of the recorded datas on the server
 #define VERSION_MAJOR 0
 #define MINIMUM_VERSION_MINOR 58
-#define VERSION_MINOR 83
+#define VERSION_MINOR 86
 // version 10 adds script saved in game
 // version 11 the gamesfiles do saves which building has been seen under fog of war.
 // version 12 saves map name into SessionGame instead of BaseMap.
@@ -102,10 +102,13 @@
 //beta5:
 // version 82 integrated new map script system
 // version 83 added a description to campaigns
+// version 84 saves the cases of the map as one compressed block per plane instead of case by case
+// version 85 writes replays as compressed blocks of orders and keyframes, streamed to disk during the game
+// version 86 added thumbnailOffset to MapHeader, and a precomputed thumbnail at the end of saved games and maps
 
 //This must be updated when there are changes to YOG, MapHeader, GameHeader, BasePlayer, BaseTeam,
 //NetMessage, and the likes, in parrallel to change of the VERSION_MINOR above
-#define NET_PROTOCOL_VERSION 27
+#define NET_PROTOCOL_VERSION 30
 // version 21 changed OrderModifyWarFlag to more generic OrderModifyMinLevelToFlag
 // version 22 added ConfigCheckSum to check if all use has the same file config.
 // version 23 updated to allow custom prestige settings
@@ -113,5 +116,8 @@
 // version 25 changed YOGGameInfo to include game state information so that running games aren't shown
 // version 26 changed heavy updates to YOG in general
 // version 27 reordered the NetMessages so that reverse compatibility with future game versions can be done, added random seed in GameHeader
+// version 28 changed the heavy checksum of the map to a sum of checksums of cases, kept up to date as the cases change
+// version 29 added NetSendCheckSumHistory, and the gid of buildings in their checksum vectors
+// version 30 added thumbnailOffset to MapHeader
 
 #endif
@@ -276,6 +276,11 @@ void YOGClient::update()
 			if(joinedGame)
 				joinedGame->recieveMessage(message);
 		}
+		if(type==MNetSendCheckSumHistory)
+		{
+			if(joinedGame)
+				joinedGame->recieveMessage(message);
+		}
 		if(type==MNetRequestFile)
 		{
 			if(joinedGame)
@@ -388,6 +393,11 @@ void YOGClient::update()
 				if(joinedGame)
 					joinedGame->recieveMessage(message);
 			}
+			else if(type==MNetSendCheckSumHistory)
+			{
+				if(joinedGame)
+					joinedGame->recieveMessage(message);
+			}
 			message = gameConnection->getMessage();
 		}
 	}
@@ -62,6 +62,13 @@ void YOGServerRouterPlayer::update()
 				game->routeMessage(message, this);
 			}
 		}
+		else if(type==MNetSendCheckSumHistory)
+		{
+			if(game)
+			{
+				game->routeMessage(message, this);
+			}
+		}
 		else if(type==MNetSetGameInRouter)
 		{
 			shared_ptr<NetSetGameInRouter> info = static_pointer_cast<NetSetGameInRouter>(message);
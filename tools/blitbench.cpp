@@ -0,0 +1,122 @@
+/*
+  This file is part of Globulation 2, a free software real-time strategy game
+  http://www.globulation2.org
+  Copyright (C) 2001-2005 Stephane Magnenat & Luc-Olivier de Charriere and other contributors
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+// Micro-benchmark of the software blending kernels of libgag.
+// For each implementation supported by this CPU, checks that it produces
+// the same pixels as the scalar one and prints the time per pixel.
+
+#include <BlitKernels.h>
+#include <iostream>
+#include <vector>
+#include <ctime>
+#include <cstdlib>
+
+using namespace std;
+using namespace GAGCore;
+
+const int rowWidth = 1021; // not a multiple of the SIMD width, to run the tails too
+const int rowCount = 64;
+const int iterations = 400;
+
+enum Kernel
+{
+	BLEND_ROW = 0,
+	BLEND_COLOR_ROW,
+	BLEND_COLOR_ALPHA_ROW,
+	KERNEL_COUNT
+};
+
+const char *kernelNames[KERNEL_COUNT] = { "blendRow", "blendColorRow", "blendColorAlphaRow" };
+
+vector<Uint32> source(rowWidth * rowCount);
+vector<Uint8> alphas(rowWidth * rowCount);
+vector<Uint32> destination(rowWidth * rowCount);
+
+void runKernel(const BlitKernels *kernels, Kernel kernel, vector<Uint32> &dest)
+{
+	for (int y = 0; y < rowCount; y++)
+	{
+		Uint32 *row = &dest[y * rowWidth];
+		switch (kernel)
+		{
+			case BLEND_ROW:
+				kernels->blendRow(row, &source[y * rowWidth], rowWidth, 200);
+				break;
+			case BLEND_COLOR_ROW:
+				kernels->blendColorRow(row, rowWidth, 0xff4080c0, 100);
+				break;
+			case BLEND_COLOR_ALPHA_ROW:
+				kernels->blendColorAlphaRow(row, &alphas[y * rowWidth], rowWidth, 0xff4080c0);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+int main()
+{
+	srand(0);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		source[i] = (rand() & 0xffff) | ((rand() & 0xffff) << 16);
+		destination[i] = (rand() & 0xffff) | ((rand() & 0xffff) << 16);
+		alphas[i] = rand() & 0xff;
+	}
+
+	const BlitKernels *scalar = BlitKernels::get(BlitKernels::SCALAR);
+	double scalarTimes[KERNEL_COUNT];
+	bool allMatch = true;
+
+	cout << "best implementation for this CPU: " << BlitKernels::best()->name << "\n";
+	for (int i = 0; i < BlitKernels::IMPLEMENTATION_COUNT; i++)
+	{
+		const BlitKernels *kernels = BlitKernels::get(static_cast<BlitKernels::Implementation>(i));
+		if (!kernels)
+			continue;
+		for (int k = 0; k < KERNEL_COUNT; k++)
+		{
+			// check against the scalar implementation
+			vector<Uint32> reference(destination);
+			vector<Uint32> result(destination);
+			runKernel(scalar, static_cast<Kernel>(k), reference);
+			runKernel(kernels, static_cast<Kernel>(k), result);
+			bool match = (reference == result);
+			allMatch = allMatch && match;
+
+			// time it
+			vector<Uint32> dest(destination);
+			clock_t start = clock();
+			for (int it = 0; it < iterations; it++)
+				runKernel(kernels, static_cast<Kernel>(k), dest);
+			double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+			if (i == BlitKernels::SCALAR)
+				scalarTimes[k] = seconds;
+
+			double nsPerPixel = seconds * 1e9 / (static_cast<double>(rowWidth) * rowCount * iterations);
+			cout << kernels->name << "\t" << kernelNames[k] << "\t" << nsPerPixel << " ns/pixel";
+			if (seconds > 0)
+				cout << "\tx" << scalarTimes[k] / seconds;
+			cout << (match ? "" : "\tMISMATCH WITH SCALAR") << "\n";
+		}
+	}
+	return allMatch ? 0 : 1;
+}